@@ -44,4 +44,6 @@ class LumaAvConan(ConanFile):
 
     def package_info(self):
         self.cpp_info.libs = ["luma_av"]
+        if self.settings.os == "Linux":
+            self.cpp_info.system_libs = ["pthread"]
 
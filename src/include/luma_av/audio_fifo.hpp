@@ -0,0 +1,475 @@
+
+#ifndef LUMA_AV_AUDIO_FIFO_HPP
+#define LUMA_AV_AUDIO_FIFO_HPP
+
+extern "C" {
+#include <libavutil/audio_fifo.h>
+#include <libavutil/mathematics.h>
+}
+
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <system_error>
+
+#include <luma_av/frame.hpp>
+#include <luma_av/result.hpp>
+#include <luma_av/util.hpp>
+#include <luma_av/detail/ranges_config.hpp>
+
+namespace luma_av {
+
+/**
+ frame_size is the number of samples per output frame (AVCodecContext::frame_size of the encoder).
+ time_base is what the input and output pts are in, unset means 1/sample_rate i.e. pts counts samples
+*/
+class AudioFifoOpts {
+    public:
+    int frame_size() const noexcept {
+        return frame_size_;
+    }
+    auto& frame_size(int n) noexcept {
+        frame_size_ = n;
+        return *this;
+    }
+
+    std::optional<AVRational> time_base() const noexcept {
+        return time_base_;
+    }
+    auto& time_base(AVRational tb) noexcept {
+        time_base_ = tb;
+        return *this;
+    }
+
+    private:
+    int frame_size_{1024};
+    std::optional<AVRational> time_base_;
+};
+
+/**
+ collects audio of any frame size and hands it back out in frames of exactly frame_size samples.
+ the sample params are taken from the first frame written, later frames have to match
+ (put a SwrSession in front if they dont).
+ output pts are the pts of the first input frame plus the samples read so far, so gaps and
+ jumps in the input timestamps are not carried over.
+ the output frame is reused until downstream holds a ref, then a new one comes from a pool
+*/
+class AudioFifo {
+    struct FifoDeleter {
+        void operator()(AVAudioFifo* fifo) const noexcept {
+            av_audio_fifo_free(fifo);
+        }
+    };
+    using fifo_ptr = std::unique_ptr<AVAudioFifo, FifoDeleter>;
+
+    fifo_ptr fifo_;
+    AudioFifoOpts opts_;
+    std::optional<AudioParams> params_;
+    Frame out_frame_;
+    FramePool pool_;
+    // pts of the first sample written and how many samples have been read since
+    int64_t start_pts_{AV_NOPTS_VALUE};
+    int64_t samples_read_{};
+
+    AudioFifo(AudioFifoOpts const& opts, Frame out_frame, FramePool pool) noexcept
+        : opts_{opts}, out_frame_{std::move(out_frame)}, pool_{std::move(pool)} {
+
+    }
+
+    AVRational time_base() const noexcept {
+        return opts_.time_base().value_or(AVRational{1, params_->sample_rate()});
+    }
+
+    result<NotNull<Frame*>> ReadImpl(int nb_samples) noexcept {
+        LUMA_AV_ASSERT(params_);
+        auto par = *params_;
+        par.nb_samples(nb_samples);
+        LUMA_AV_OUTCOME_TRY(pool_.GetIfNotWritable(out_frame_, par));
+        auto* out = out_frame_.get();
+        const auto read = av_audio_fifo_read(fifo_.get(), reinterpret_cast<void**>(out->extended_data),
+                                             nb_samples);
+        LUMA_AV_OUTCOME_TRY(detail::as_result(read));
+        LUMA_AV_ASSERT(read == nb_samples);
+        out->pts = start_pts_ + av_rescale_q(samples_read_, AVRational{1, params_->sample_rate()},
+                                             this->time_base());
+        samples_read_ += read;
+        return std::addressof(out_frame_);
+    }
+
+    public:
+    static result<AudioFifo> make(AudioFifoOpts const& opts = {}) noexcept {
+        if (opts.frame_size() <= 0) {
+            return errc{AVERROR(EINVAL)};
+        }
+        LUMA_AV_OUTCOME_TRY(frame, Frame::make());
+        LUMA_AV_OUTCOME_TRY(pool, FramePool::make(1));
+        return AudioFifo{opts, std::move(frame), std::move(pool)};
+    }
+
+    int frame_size() const noexcept {
+        return opts_.frame_size();
+    }
+    /**
+     samples per channel waiting to be read
+    */
+    int size() const noexcept {
+        return fifo_ ? av_audio_fifo_size(fifo_.get()) : 0;
+    }
+    bool ready() const noexcept {
+        return this->size() >= this->frame_size();
+    }
+    std::optional<AudioParams> const& params() const noexcept {
+        return params_;
+    }
+
+    result<void> Write(Frame const& frame) noexcept {
+        if (!detail::holds_audio_buffer(frame.get())) {
+            return errc{AVERROR(EINVAL)};
+        }
+        auto par = frame.audio_params();
+        const auto nb_samples = par.nb_samples();
+        par.nb_samples(0);
+        if (!params_) {
+            if (par.sample_rate() <= 0) {
+                return errc{AVERROR(EINVAL)};
+            }
+            auto* fifo = av_audio_fifo_alloc(par.format(), par.channels(),
+                                             std::max(nb_samples, 2 * this->frame_size()));
+            if (!fifo) {
+                return luma_av::outcome::failure(errc::alloc_failure);
+            }
+            fifo_.reset(fifo);
+            params_ = par;
+        } else if (par != *params_) {
+            return errc{AVERROR(EINVAL)};
+        }
+        if (start_pts_ == AV_NOPTS_VALUE) {
+            start_pts_ = frame.get()->pts != AV_NOPTS_VALUE ? frame.get()->pts : 0;
+        }
+        // grows the fifo if needed, it never shrinks so steady state doesnt allocate
+        const auto written = av_audio_fifo_write(fifo_.get(),
+                                reinterpret_cast<void**>(frame.get()->extended_data), nb_samples);
+        LUMA_AV_OUTCOME_TRY(detail::as_result(written));
+        return luma_av::outcome::success();
+    }
+
+    /**
+     the next frame_size samples. errc::again until enough have been written
+    */
+    result<NotNull<Frame*>> Read() noexcept {
+        if (!this->ready()) {
+            return errc::again;
+        }
+        return this->ReadImpl(this->frame_size());
+    }
+
+    /**
+     whatever is left at the end of the stream as one short frame. errc::end once empty
+    */
+    result<NotNull<Frame*>> Flush() noexcept {
+        const auto left = this->size();
+        if (left == 0) {
+            return errc::end;
+        }
+        return this->ReadImpl(std::min(left, this->frame_size()));
+    }
+
+    /**
+     drops the buffered samples and restarts pts from the next frame written.
+     the sample params are kept
+    */
+    void Reset() noexcept {
+        if (fifo_) {
+            av_audio_fifo_reset(fifo_.get());
+        }
+        start_pts_ = AV_NOPTS_VALUE;
+        samples_read_ = 0;
+    }
+};
+
+struct AudioFifoWriteClosure {
+    AudioFifo& fifo;
+    result<void> operator()(result<NotNull<Frame*>> const& frame_res) noexcept {
+        LUMA_AV_OUTCOME_TRY(frame, frame_res);
+        return fifo.Write(*frame);
+    }
+    result<void> operator()(Frame const& frame) noexcept {
+        return fifo.Write(frame);
+    }
+};
+
+namespace detail {
+
+#ifdef LUMA_AV_ENABLE_RANGES
+
+template <std::ranges::view R>
+class rebatch_audio_view_impl : public std::ranges::view_interface<rebatch_audio_view_impl<R>> {
+public:
+rebatch_audio_view_impl() noexcept = default;
+/**
+ owner is set when the view made the fifo itself (rebatch_audio(frame_size)),
+ it keeps the fifo and the frames it yields alive as long as the view
+*/
+explicit rebatch_audio_view_impl(R base, AudioFifo& fifo, std::shared_ptr<AudioFifo> owner = nullptr)
+    : base_{std::move(base)}, fifo_{std::addressof(fifo)}, owner_{std::move(owner)} {
+
+}
+/**
+ the view could not make its fifo, it yields fifo_error once and ends without reading base
+*/
+explicit rebatch_audio_view_impl(R base, std::error_code fifo_error)
+    : base_{std::move(base)}, fifo_error_{fifo_error} {
+
+}
+
+auto base() const noexcept -> R {
+    return base_;
+}
+auto fifo() const noexcept -> AudioFifo& {
+    return *fifo_;
+}
+
+auto begin() {
+    return iterator<false>{*this};
+}
+
+auto end() {
+    return std::ranges::end(base_);
+}
+
+private:
+R base_{};
+AudioFifo* fifo_ = nullptr;
+std::shared_ptr<AudioFifo> owner_;
+std::error_code fifo_error_;
+
+template <bool is_const>
+class iterator;
+
+};
+
+template <std::ranges::viewable_range R>
+rebatch_audio_view_impl(R&&, AudioFifo&) -> rebatch_audio_view_impl<std::ranges::views::all_t<R>>;
+template <std::ranges::viewable_range R>
+rebatch_audio_view_impl(R&&, AudioFifo&, std::shared_ptr<AudioFifo>)
+    -> rebatch_audio_view_impl<std::ranges::views::all_t<R>>;
+template <std::ranges::viewable_range R>
+rebatch_audio_view_impl(R&&, std::error_code) -> rebatch_audio_view_impl<std::ranges::views::all_t<R>>;
+
+
+template <std::ranges::view R>
+template <bool is_const>
+class rebatch_audio_view_impl<R>::iterator {
+    using output_type = result<NotNull<Frame*>>;
+    using parent_t = detail::MaybeConst_t<is_const, rebatch_audio_view_impl<R>>;
+    using base_t = detail::MaybeConst_t<is_const, R>;
+    friend iterator<not is_const>;
+
+    parent_t* parent_ = nullptr;
+    mutable std::ranges::iterator_t<base_t> current_{};
+    mutable bool reached_end_ = false;
+    mutable std::ptrdiff_t skip_count_{0};
+    mutable std::optional<output_type> cached_frame_;
+
+public:
+
+using difference_type = std::ptrdiff_t;
+using value_type = output_type;
+
+iterator() = default;
+
+explicit iterator(parent_t& parent)
+ : parent_{std::addressof(parent)},
+    current_{std::ranges::begin(parent.base_)} {
+}
+
+std::ranges::iterator_t<base_t> base() const {
+    return current_;
+}
+
+/**
+ a frame of exactly frame_size samples whenever the fifo has enough,
+ then the short remainder once the input runs out
+*/
+output_type operator*() const {
+    LUMA_AV_ASSERT(!reached_end_);
+    LUMA_AV_ASSERT(skip_count_ >= -1);
+    if ((skip_count_== -1) && (cached_frame_)) {
+        return *cached_frame_;
+    }
+    if (!parent_->fifo_) {
+        if (skip_count_ == 0 && !cached_frame_) {
+            cached_frame_ = output_type{parent_->fifo_error_};
+            skip_count_ = -1;
+            return *cached_frame_;
+        }
+        reached_end_ = true;
+        return errc::detail_rebatch_range_end;
+    }
+    auto& fifo = parent_->fifo();
+    while (true) {
+        if (fifo.ready()) {
+            auto res = fifo.Read();
+            if (res && skip_count_ > 0) {
+                skip_count_ -= 1;
+                continue;
+            }
+            cached_frame_ = res;
+            skip_count_ = -1;
+            return res;
+        }
+        if (current_ == std::ranges::end(parent_->base_)) {
+            break;
+        }
+        auto write_res = AudioFifoWriteClosure{fifo}(*current_);
+        ++current_;
+        if (!write_res) {
+            auto out = output_type{write_res.error()};
+            cached_frame_ = out;
+            skip_count_ = -1;
+            return out;
+        }
+    }
+    while (true) {
+        auto res = fifo.Flush();
+        if (!res && res.error() == errc::end) {
+            break;
+        }
+        if (res && skip_count_ > 0) {
+            skip_count_ -= 1;
+            continue;
+        }
+        cached_frame_ = res;
+        skip_count_ = -1;
+        return res;
+    }
+    reached_end_ = true;
+    return errc::detail_rebatch_range_end;
+}
+
+iterator& operator++() {
+    skip_count_ += 1;
+    return *this;
+}
+
+void operator++(int) {
+    ++*this;
+}
+
+iterator operator++(int)
+requires std::ranges::forward_range<base_t> {
+    auto temp = *this;
+    ++*this;
+    return temp;
+}
+
+bool operator==(std::ranges::sentinel_t<base_t> const& other) const {
+    return reached_end_;
+}
+
+bool operator==(iterator const& other) const
+requires std::equality_comparable<std::ranges::iterator_t<base_t>> {
+    auto fifo_or_null = [](auto parent) -> AudioFifo* {
+        if (parent) {
+            return parent->fifo_;
+        } else {
+            return nullptr;
+        }
+    };
+    return fifo_or_null(parent_) == fifo_or_null(other.parent_) &&
+        current_ == other.current_ &&
+        reached_end_ == other.reached_end_ &&
+        skip_count_ == other.skip_count_ &&
+        cached_frame_.has_value() == other.cached_frame_.has_value();
+}
+
+};
+
+inline const auto rebatch_range_end_view = std::views::filter([](const auto& res){
+    if (res) {
+        return true;
+    } else if (res.error() == errc::detail_rebatch_range_end) {
+        return false;
+    } else {
+        return true;
+    }
+});
+
+class rebatch_audio_view_impl_range_adaptor_closure {
+    AudioFifo* fifo_ = nullptr;
+    // only set when the closure was given a frame size and has to own its fifo
+    std::shared_ptr<AudioFifo> owner_;
+    // why making that fifo failed, fifo_ is null then
+    std::error_code fifo_error_;
+    public:
+    explicit rebatch_audio_view_impl_range_adaptor_closure(AudioFifo& fifo)
+        : fifo_{std::addressof(fifo)} {
+
+    }
+    explicit rebatch_audio_view_impl_range_adaptor_closure(std::shared_ptr<AudioFifo> owner)
+        : fifo_{owner.get()}, owner_{std::move(owner)} {
+
+    }
+    explicit rebatch_audio_view_impl_range_adaptor_closure(std::error_code fifo_error)
+        : fifo_error_{fifo_error} {
+
+    }
+    template <std::ranges::viewable_range R>
+    auto operator()(R&& r) const {
+        if (!fifo_) {
+            return rebatch_audio_view_impl{std::views::all(std::forward<R>(r)), fifo_error_}
+                | rebatch_range_end_view;
+        }
+        return rebatch_audio_view_impl{std::views::all(std::forward<R>(r)), *fifo_, owner_}
+                | rebatch_range_end_view;
+    }
+};
+
+template <std::ranges::viewable_range R>
+decltype(auto) operator|(R&& r, rebatch_audio_view_impl_range_adaptor_closure const& closure) {
+    return closure(std::forward<R>(r));
+}
+
+class rebatch_audio_view_impl_fn {
+public:
+template <class R>
+auto operator()(R&& r, AudioFifo& fifo) const {
+    return rebatch_audio_view_impl_range_adaptor_closure{fifo}(std::forward<R>(r));
+}
+auto operator()(AudioFifo& fifo) const {
+    return rebatch_audio_view_impl_range_adaptor_closure{fifo};
+}
+/**
+ makes a fifo owned by the view. if that fails (frame_size <= 0, no memory)
+ the view yields the error as its only element
+*/
+auto operator()(int frame_size) const {
+    auto fifo = AudioFifo::make(AudioFifoOpts{}.frame_size(frame_size));
+    if (!fifo) {
+        return rebatch_audio_view_impl_range_adaptor_closure{fifo.error()};
+    }
+    return rebatch_audio_view_impl_range_adaptor_closure{
+        std::make_shared<AudioFifo>(std::move(fifo).value())};
+}
+};
+
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // detail
+
+#ifdef LUMA_AV_ENABLE_RANGES
+/**
+ frames | views::rebatch_audio(1024) or frames | views::rebatch_audio(fifo)
+ yields result<NotNull<Frame*>> with exactly frame_size samples each,
+ except the last one which has whatever was left
+*/
+inline const auto rebatch_audio_view = detail::rebatch_audio_view_impl_fn{};
+
+namespace views {
+inline const auto rebatch_audio = rebatch_audio_view;
+} // views
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // luma_av
+
+#endif // LUMA_AV_AUDIO_FIFO_HPP
@@ -183,6 +183,17 @@ class CodecContext {
         return CodecPar::make(ctx_.get());
     }
 
+    /**
+     trade throughput for latency: low delay flag and slice threading only
+     (frame threading holds back a frame per thread). call before opening.
+     meant for decoders fed by a live input (see LiveInputOpts)
+    */
+    CodecContext& EnableLowDelay() noexcept {
+        ctx_->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        ctx_->thread_type = FF_THREAD_SLICE;
+        return *this;
+    }
+
 
 
     CodecContext(const CodecContext&) = delete;
@@ -207,6 +218,7 @@ class CodecContext {
     "Do not mix this API with the legacy API (like avcodec_decode_video2())
         on the same AVCodecContext. It will return unexpected results
          now or in future libavcodec versions."
+    packets from Packet::new_buffer/reset_buffer_copy (and so the parser) are always padded
     */
     result<void> send_packet(const AVPacket* p) noexcept {
         auto ec = avcodec_send_packet(ctx_.get(), p);
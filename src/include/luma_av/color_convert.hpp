@@ -0,0 +1,579 @@
+
+#ifndef LUMA_AV_COLOR_CONVERT_HPP
+#define LUMA_AV_COLOR_CONVERT_HPP
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ranges>
+
+#include <luma_av/frame.hpp>
+#include <luma_av/result.hpp>
+#include <luma_av/thread_pool.hpp>
+#include <luma_av/util.hpp>
+#include <luma_av/detail/ranges_config.hpp>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define LUMA_AV_X86_DISPATCH 1
+#endif
+
+namespace luma_av {
+
+/**
+ yuv -> rgb matrix. frames tagged bt709 use bt709, everything else is treated as bt601 like swscale does
+*/
+enum class ColorMatrix {
+    bt601,
+    bt709
+};
+
+/**
+ limited is the usual 16-235/16-240 video range, full is 0-255 (the yuvj formats)
+*/
+enum class ColorRange {
+    limited,
+    full
+};
+
+/**
+ instruction sets the conversion kernels are built for. the best one the cpu supports
+ is picked at runtime, every level gives bit identical 8 bit output
+*/
+enum class SimdLevel {
+    generic,
+    sse41,
+    avx2,
+    avx512
+};
+
+namespace detail {
+
+inline SimdLevel DetectSimdLevel() noexcept {
+#ifdef LUMA_AV_X86_DISPATCH
+    static const auto level = []{
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+            return SimdLevel::avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::avx2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return SimdLevel::sse41;
+        }
+        return SimdLevel::generic;
+    }();
+    return level;
+#else
+    return SimdLevel::generic;
+#endif
+}
+
+/**
+ Q16 fixed point coefficients for the 8 bit outputs and the same in float for the float output.
+ r = y_mul * (y - y_off) + rv * (v - 128)
+ g = y_mul * (y - y_off) - gu * (u - 128) - gv * (v - 128)
+ b = y_mul * (y - y_off) + bu * (u - 128)
+*/
+struct YuvCoeffs {
+    int32_t y_off{};
+    int32_t y_mul{};
+    int32_t rv{};
+    int32_t gu{};
+    int32_t gv{};
+    int32_t bu{};
+    float fy_mul{};
+    float frv{};
+    float fgu{};
+    float fgv{};
+    float fbu{};
+};
+
+inline YuvCoeffs MakeYuvCoeffs(ColorMatrix matrix, ColorRange range) noexcept {
+    const auto kr = matrix == ColorMatrix::bt709 ? 0.2126 : 0.299;
+    const auto kb = matrix == ColorMatrix::bt709 ? 0.0722 : 0.114;
+    const auto kg = 1.0 - kr - kb;
+    const auto y_scale = range == ColorRange::full ? 1.0 : 255.0 / 219.0;
+    const auto c_scale = range == ColorRange::full ? 1.0 : 255.0 / 224.0;
+    const auto rv = 2.0 * (1.0 - kr) * c_scale;
+    const auto bu = 2.0 * (1.0 - kb) * c_scale;
+    const auto gu = 2.0 * (1.0 - kb) * kb / kg * c_scale;
+    const auto gv = 2.0 * (1.0 - kr) * kr / kg * c_scale;
+    const auto fixed = [](double c) { return static_cast<int32_t>(std::lround(c * 65536.0)); };
+    return YuvCoeffs{
+        .y_off = range == ColorRange::full ? 0 : 16,
+        .y_mul = fixed(y_scale), .rv = fixed(rv), .gu = fixed(gu), .gv = fixed(gv), .bu = fixed(bu),
+        .fy_mul = static_cast<float>(y_scale / 255.0), .frv = static_cast<float>(rv / 255.0),
+        .fgu = static_cast<float>(gu / 255.0), .fgv = static_cast<float>(gv / 255.0),
+        .fbu = static_cast<float>(bu / 255.0)};
+}
+
+// yuv420p/yuv422p style separate u and v planes, or nv12 style interleaved uv
+enum class ChromaLayout {
+    planar,
+    interleaved
+};
+
+enum class RgbLayout {
+    rgb24,
+    bgra,
+    // planar float in [0, 1], ffmpeg orders the planes g, b, r
+    gbrpf32
+};
+
+struct ConvertRowArgs {
+    const uint8_t* y;
+    // for interleaved chroma u points at the uv row and v is unused
+    const uint8_t* u;
+    const uint8_t* v;
+    int width;
+    uint8_t* dst[3];
+    const YuvCoeffs* k;
+};
+
+// pixels per block, the per block chroma terms live on the stack
+inline constexpr auto convert_block = 64;
+
+[[gnu::always_inline]] inline int32_t Clamp8(int32_t v) noexcept {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+[[gnu::always_inline]] inline float ClampUnit(float v) noexcept {
+    return v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+}
+
+/**
+ exactly convert_block pixels. every loop has a fixed trip count so the compiler vectorizes
+ them without tails, the per isa entry points below just compile this same code for wider registers
+*/
+template <ChromaLayout C, RgbLayout D>
+[[gnu::always_inline]] inline void ConvertBlock(const uint8_t* src_y, const uint8_t* src_u, 
+                                                const uint8_t* src_v, uint8_t* dst0, uint8_t* dst1,
+                                                uint8_t* dst2, YuvCoeffs const& k) noexcept {
+    using term_t = std::conditional_t<D == RgbLayout::gbrpf32, float, int32_t>;
+    constexpr auto nc = convert_block / 2;
+    term_t rt[convert_block];
+    term_t gt[convert_block];
+    term_t bt[convert_block];
+    for (auto i = 0; i < nc; ++i) {
+        int32_t cu;
+        int32_t cv;
+        if constexpr (C == ChromaLayout::planar) {
+            cu = src_u[i] - 128;
+            cv = src_v[i] - 128;
+        } else {
+            cu = src_u[2 * i] - 128;
+            cv = src_u[2 * i + 1] - 128;
+        }
+        term_t r;
+        term_t g;
+        term_t b;
+        if constexpr (D == RgbLayout::gbrpf32) {
+            r = k.frv * static_cast<float>(cv);
+            g = -k.fgu * static_cast<float>(cu) - k.fgv * static_cast<float>(cv);
+            b = k.fbu * static_cast<float>(cu);
+        } else {
+            // rounding folded into the chroma term
+            r = k.rv * cv + (1 << 15);
+            g = (1 << 15) - k.gu * cu - k.gv * cv;
+            b = k.bu * cu + (1 << 15);
+        }
+        rt[2 * i] = r;
+        rt[2 * i + 1] = r;
+        gt[2 * i] = g;
+        gt[2 * i + 1] = g;
+        bt[2 * i] = b;
+        bt[2 * i + 1] = b;
+    }
+    for (auto i = 0; i < convert_block; ++i) {
+        const auto luma = static_cast<int32_t>(src_y[i]) - k.y_off;
+        if constexpr (D == RgbLayout::gbrpf32) {
+            const auto yy = k.fy_mul * static_cast<float>(luma);
+            const auto g = ClampUnit(yy + gt[i]);
+            const auto b = ClampUnit(yy + bt[i]);
+            const auto r = ClampUnit(yy + rt[i]);
+            std::memcpy(dst0 + 4 * i, &g, sizeof(g));
+            std::memcpy(dst1 + 4 * i, &b, sizeof(b));
+            std::memcpy(dst2 + 4 * i, &r, sizeof(r));
+        } else {
+            const auto yy = k.y_mul * luma;
+            const auto r = static_cast<uint8_t>(Clamp8((yy + rt[i]) >> 16));
+            const auto g = static_cast<uint8_t>(Clamp8((yy + gt[i]) >> 16));
+            const auto b = static_cast<uint8_t>(Clamp8((yy + bt[i]) >> 16));
+            if constexpr (D == RgbLayout::rgb24) {
+                dst0[3 * i] = r;
+                dst0[3 * i + 1] = g;
+                dst0[3 * i + 2] = b;
+            } else if constexpr (std::endian::native == std::endian::little) {
+                const auto bgra = static_cast<uint32_t>(b) | (static_cast<uint32_t>(g) << 8)
+                                  | (static_cast<uint32_t>(r) << 16) | 0xFF000000u;
+                std::memcpy(dst0 + 4 * i, &bgra, sizeof(bgra));
+            } else {
+                dst0[4 * i] = b;
+                dst0[4 * i + 1] = g;
+                dst0[4 * i + 2] = r;
+                dst0[4 * i + 3] = 0xFF;
+            }
+        }
+    }
+}
+
+/**
+ one row of pixels, whole blocks in place and the last partial block through a padded copy on the stack
+*/
+template <ChromaLayout C, RgbLayout D>
+[[gnu::always_inline]] inline void ConvertRow(ConvertRowArgs const& a) noexcept {
+    constexpr auto dst_px_bytes = D == RgbLayout::rgb24 ? 3 : 4;
+    // interleaved chroma has 2 bytes per chroma sample, so the same number of bytes as luma
+    constexpr auto u_px_div = C == ChromaLayout::planar ? 2 : 1;
+    // local copy, byte stores into dst could alias anything reached through a
+    const auto k = *a.k;
+    const auto full = a.width - a.width % convert_block;
+    for (auto x0 = 0; x0 < full; x0 += convert_block) {
+        detail::ConvertBlock<C, D>(a.y + x0, a.u + x0 / u_px_div, 
+                                   C == ChromaLayout::planar ? a.v + x0 / 2 : nullptr,
+                                   a.dst[0] + dst_px_bytes * x0, 
+                                   D == RgbLayout::gbrpf32 ? a.dst[1] + 4 * x0 : nullptr,
+                                   D == RgbLayout::gbrpf32 ? a.dst[2] + 4 * x0 : nullptr, k);
+    }
+    const auto n = a.width - full;
+    if (n == 0) {
+        return;
+    }
+    const auto nc = (n + 1) / 2;
+    uint8_t y[convert_block] = {};
+    uint8_t u[convert_block] = {};
+    uint8_t v[convert_block / 2] = {};
+    uint8_t out[3][convert_block * 4];
+    std::memcpy(y, a.y + full, static_cast<std::size_t>(n));
+    if constexpr (C == ChromaLayout::planar) {
+        std::memcpy(u, a.u + full / 2, static_cast<std::size_t>(nc));
+        std::memcpy(v, a.v + full / 2, static_cast<std::size_t>(nc));
+    } else {
+        std::memcpy(u, a.u + full, static_cast<std::size_t>(2 * nc));
+    }
+    detail::ConvertBlock<C, D>(y, u, v, out[0], out[1], out[2], k);
+    const auto nb_dst = D == RgbLayout::gbrpf32 ? 3 : 1;
+    for (auto p = 0; p < nb_dst; ++p) {
+        std::memcpy(a.dst[p] + dst_px_bytes * full, out[p], static_cast<std::size_t>(dst_px_bytes * n));
+    }
+}
+
+using ConvertRowFn = void (*)(ConvertRowArgs const&) noexcept;
+
+template <ChromaLayout C, RgbLayout D>
+void ConvertRowGeneric(ConvertRowArgs const& a) noexcept {
+    detail::ConvertRow<C, D>(a);
+}
+
+#ifdef LUMA_AV_X86_DISPATCH
+template <ChromaLayout C, RgbLayout D>
+[[gnu::target("sse4.1")]] void ConvertRowSse41(ConvertRowArgs const& a) noexcept {
+    detail::ConvertRow<C, D>(a);
+}
+template <ChromaLayout C, RgbLayout D>
+[[gnu::target("avx2")]] void ConvertRowAvx2(ConvertRowArgs const& a) noexcept {
+    detail::ConvertRow<C, D>(a);
+}
+template <ChromaLayout C, RgbLayout D>
+[[gnu::target("avx512f,avx512bw")]] void ConvertRowAvx512(ConvertRowArgs const& a) noexcept {
+    detail::ConvertRow<C, D>(a);
+}
+#endif // LUMA_AV_X86_DISPATCH
+
+template <ChromaLayout C, RgbLayout D>
+ConvertRowFn SelectConvertRow(SimdLevel level) noexcept {
+#ifdef LUMA_AV_X86_DISPATCH
+    switch (level) {
+        case SimdLevel::avx512:
+            return &ConvertRowAvx512<C, D>;
+        case SimdLevel::avx2:
+            return &ConvertRowAvx2<C, D>;
+        case SimdLevel::sse41:
+            return &ConvertRowSse41<C, D>;
+        case SimdLevel::generic:
+            break;
+    }
+#endif // LUMA_AV_X86_DISPATCH
+    static_cast<void>(level);
+    return &ConvertRowGeneric<C, D>;
+}
+
+template <ChromaLayout C>
+ConvertRowFn SelectConvertRow(RgbLayout dst, SimdLevel level) noexcept {
+    switch (dst) {
+        case RgbLayout::rgb24:
+            return detail::SelectConvertRow<C, RgbLayout::rgb24>(level);
+        case RgbLayout::bgra:
+            return detail::SelectConvertRow<C, RgbLayout::bgra>(level);
+        case RgbLayout::gbrpf32:
+            return detail::SelectConvertRow<C, RgbLayout::gbrpf32>(level);
+    }
+    return nullptr;
+}
+
+/**
+ source formats the kernels handle. log2_chroma_h is 1 for 4:2:0 and 0 for 4:2:2
+*/
+struct YuvSrcFormat {
+    ChromaLayout chroma;
+    int log2_chroma_h;
+    // yuvj formats are full range unless the frame says otherwise
+    bool full_range;
+};
+
+inline std::optional<YuvSrcFormat> GetYuvSrcFormat(AVPixelFormat fmt) noexcept {
+    switch (fmt) {
+        case AV_PIX_FMT_YUV420P:
+            return YuvSrcFormat{ChromaLayout::planar, 1, false};
+        case AV_PIX_FMT_YUVJ420P:
+            return YuvSrcFormat{ChromaLayout::planar, 1, true};
+        case AV_PIX_FMT_YUV422P:
+            return YuvSrcFormat{ChromaLayout::planar, 0, false};
+        case AV_PIX_FMT_YUVJ422P:
+            return YuvSrcFormat{ChromaLayout::planar, 0, true};
+        case AV_PIX_FMT_NV12:
+            return YuvSrcFormat{ChromaLayout::interleaved, 1, false};
+        default:
+            return std::nullopt;
+    }
+}
+
+inline std::optional<RgbLayout> GetRgbDstLayout(AVPixelFormat fmt) noexcept {
+    switch (fmt) {
+        case AV_PIX_FMT_RGB24:
+            return RgbLayout::rgb24;
+        case AV_PIX_FMT_BGRA:
+            return RgbLayout::bgra;
+        case AV_PIX_FMT_GBRPF32:
+            return RgbLayout::gbrpf32;
+        default:
+            return std::nullopt;
+    }
+}
+
+} // detail
+
+class ColorConvertOpts {
+    public:
+    static constexpr auto default_min_band_rows = int{32};
+
+    AVPixelFormat dst_format() const noexcept {
+        return dst_format_;
+    }
+    /**
+     AV_PIX_FMT_RGB24, AV_PIX_FMT_BGRA or AV_PIX_FMT_GBRPF32 (planar float, 0 to 1)
+    */
+    auto& dst_format(AVPixelFormat fmt) noexcept {
+        dst_format_ = fmt;
+        return *this;
+    }
+
+    std::optional<ColorMatrix> matrix() const noexcept {
+        return matrix_;
+    }
+    /**
+     unset takes the matrix from the frames colorspace
+    */
+    auto& matrix(ColorMatrix m) noexcept {
+        matrix_ = m;
+        return *this;
+    }
+
+    std::optional<ColorRange> range() const noexcept {
+        return range_;
+    }
+    /**
+     unset takes the range from the frames color_range (or the yuvj pixel format)
+    */
+    auto& range(ColorRange r) noexcept {
+        range_ = r;
+        return *this;
+    }
+
+    SimdLevel max_simd() const noexcept {
+        return max_simd_;
+    }
+    /**
+     cap the kernel level, the default is whatever the cpu supports
+    */
+    auto& max_simd(SimdLevel level) noexcept {
+        max_simd_ = level;
+        return *this;
+    }
+
+    ThreadPool* pool() const noexcept {
+        return pool_;
+    }
+    /**
+     convert bands of rows in parallel on the pool
+    */
+    auto& pool(ThreadPool& p) noexcept {
+        pool_ = std::addressof(p);
+        return *this;
+    }
+
+    int min_band_rows() const noexcept {
+        return min_band_rows_;
+    }
+    auto& min_band_rows(int rows) noexcept {
+        min_band_rows_ = rows;
+        return *this;
+    }
+
+    private:
+    AVPixelFormat dst_format_ = AV_PIX_FMT_RGB24;
+    std::optional<ColorMatrix> matrix_;
+    std::optional<ColorRange> range_;
+    SimdLevel max_simd_ = SimdLevel::avx512;
+    ThreadPool* pool_ = nullptr;
+    int min_band_rows_ = default_min_band_rows;
+};
+
+/**
+ same size yuv -> rgb conversion without going through swscale.
+ sources: yuv420p, yuvj420p, yuv422p, yuvj422p, nv12 (8 bit).
+ chroma is upsampled by repeating samples, same as swscales unscaled converters.
+ 8 bit outputs are within 1 of swscale with SWS_ACCURATE_RND
+*/
+class ColorConvert {
+    ColorConvertOpts opts_;
+    SimdLevel level_;
+    detail::RgbLayout dst_layout_;
+    Frame out_frame_;
+    FramePool pool_;
+
+    ColorConvert(ColorConvertOpts const& opts, SimdLevel level, detail::RgbLayout dst_layout,
+                 Frame out_frame, FramePool pool) noexcept
+        : opts_{opts}, level_{level}, dst_layout_{dst_layout},
+          out_frame_{std::move(out_frame)}, pool_{std::move(pool)} {}
+
+    public:
+    static bool Supports(AVPixelFormat src, AVPixelFormat dst) noexcept {
+        return detail::GetYuvSrcFormat(src).has_value() && detail::GetRgbDstLayout(dst).has_value();
+    }
+
+    static SimdLevel DetectedSimdLevel() noexcept {
+        return detail::DetectSimdLevel();
+    }
+
+    static result<ColorConvert> make(ColorConvertOpts const& opts = {}) noexcept {
+        const auto dst_layout = detail::GetRgbDstLayout(opts.dst_format());
+        if (!dst_layout) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto level = std::min(opts.max_simd(), detail::DetectSimdLevel());
+        LUMA_AV_OUTCOME_TRY(frame, Frame::make());
+        LUMA_AV_OUTCOME_TRY(pool, FramePool::make(1));
+        return ColorConvert{opts, level, *dst_layout, std::move(frame), std::move(pool)};
+    }
+
+    SimdLevel simd_level() const noexcept {
+        return level_;
+    }
+
+    /**
+     convert into dst, which has to hold a writable buffer of the same size in the dst format
+    */
+    result<void> Convert(Frame const& src, Frame& dst) noexcept {
+        const auto* s = src.get();
+        auto* d = dst.get();
+        const auto src_fmt = detail::GetYuvSrcFormat(static_cast<AVPixelFormat>(s->format));
+        if (!src_fmt || !s->data[0] || s->width <= 0 || s->height <= 0) {
+            return errc{AVERROR(EINVAL)};
+        }
+        if (!d->data[0] || d->format != opts_.dst_format()
+            || d->width != s->width || d->height != s->height) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto matrix = opts_.matrix().value_or(
+            s->colorspace == AVCOL_SPC_BT709 ? ColorMatrix::bt709 : ColorMatrix::bt601);
+        const auto frame_range = s->color_range == AVCOL_RANGE_JPEG
+                                 || (s->color_range == AVCOL_RANGE_UNSPECIFIED && src_fmt->full_range)
+                                 ? ColorRange::full : ColorRange::limited;
+        const auto coeffs = detail::MakeYuvCoeffs(matrix, opts_.range().value_or(frame_range));
+        const auto row_fn = src_fmt->chroma == detail::ChromaLayout::planar
+            ? detail::SelectConvertRow<detail::ChromaLayout::planar>(dst_layout_, level_)
+            : detail::SelectConvertRow<detail::ChromaLayout::interleaved>(dst_layout_, level_);
+
+        const auto convert_rows = [&](int first, int last) noexcept {
+            for (auto y = first; y < last; ++y) {
+                const auto cy = y >> src_fmt->log2_chroma_h;
+                auto args = detail::ConvertRowArgs{
+                    .y = s->data[0] + static_cast<std::ptrdiff_t>(y) * s->linesize[0],
+                    .u = s->data[1] + static_cast<std::ptrdiff_t>(cy) * s->linesize[1],
+                    .v = src_fmt->chroma == detail::ChromaLayout::planar
+                         ? s->data[2] + static_cast<std::ptrdiff_t>(cy) * s->linesize[2] : nullptr,
+                    .width = s->width,
+                    .dst = {},
+                    .k = &coeffs};
+                const auto nb_dst = dst_layout_ == detail::RgbLayout::gbrpf32 ? 3 : 1;
+                for (auto p = 0; p < nb_dst; ++p) {
+                    args.dst[p] = d->data[p] + static_cast<std::ptrdiff_t>(y) * d->linesize[p];
+                }
+                row_fn(args);
+            }
+        };
+
+        if (!opts_.pool()) {
+            convert_rows(0, s->height);
+            return luma_av::outcome::success();
+        }
+        const auto min_rows = std::max(opts_.min_band_rows(), 1);
+        const auto num_bands = std::clamp(s->height / min_rows, 1,
+                                          static_cast<int>(opts_.pool()->size()) + 1);
+        const auto rows_per_band = (s->height + num_bands - 1) / num_bands;
+        opts_.pool()->ParallelFor(num_bands, [&](int band) noexcept {
+            const auto first = band * rows_per_band;
+            convert_rows(first, std::min(first + rows_per_band, s->height));
+        });
+        return luma_av::outcome::success();
+    }
+
+    /**
+     convert into an internally owned frame. like ScaleSession a new pooled buffer
+     is only taken when the previous output is still referenced
+    */
+    result<NotNull<Frame*>> Convert(Frame const& src) noexcept {
+        LUMA_AV_OUTCOME_TRY(pool_.GetIfNotWritable(out_frame_, VideoParams{.width_ = src.width(),
+                                                                           .height_ = src.height(),
+                                                                           .format_ = opts_.dst_format()}));
+        LUMA_AV_OUTCOME_TRY(this->Convert(src, out_frame_));
+        return std::addressof(out_frame_);
+    }
+};
+
+struct ConvertClosure {
+    ColorConvert& conv;
+    result<NotNull<Frame*>> operator()(
+            result<NotNull<Frame*>> const& frame_res) noexcept {
+        LUMA_AV_OUTCOME_TRY(frame, frame_res);
+        return conv.Convert(*frame);
+    }
+    result<NotNull<Frame*>> operator()(Frame const& frame) noexcept {
+        return conv.Convert(frame);
+    }
+};
+
+#ifdef LUMA_AV_ENABLE_RANGES
+const auto convert_view = [](ColorConvert& conv){
+    return std::views::transform([&](const auto& frame) {
+        return ConvertClosure{conv}(frame);
+    });
+};
+
+namespace views {
+const auto convert = convert_view;
+} // views
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // luma_av
+
+#endif // LUMA_AV_COLOR_CONVERT_HPP
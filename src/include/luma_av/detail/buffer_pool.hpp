@@ -0,0 +1,104 @@
+
+#ifndef LUMA_AV_DETAIL_BUFFER_POOL_HPP
+#define LUMA_AV_DETAIL_BUFFER_POOL_HPP
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/mem.h>
+}
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include <luma_av/result.hpp>
+
+namespace luma_av {
+
+namespace detail {
+
+/**
+ shared by every AVBufferPool of one FramePool/PacketBufferPool for the stats
+*/
+struct BufferPoolCounters {
+    std::atomic<std::size_t> buffers{0};
+    std::atomic<std::size_t> bytes{0};
+    std::atomic<std::size_t> high_water_bytes{0};
+};
+
+/**
+ opaque for a single AVBufferPool. buffers can be released on any thread and can 
+ outlive the pool wrapper (FramePool, PacketBufferPool) so ffmpeg owns this and frees it
+ with pool_free once the pool is uninit and every buffer has come back
+*/
+struct BufferPoolState {
+    std::shared_ptr<BufferPoolCounters> counters;
+    std::size_t buffer_size{};
+
+    static void FreeBuffer(void* opaque, uint8_t* data) noexcept {
+        auto state = reinterpret_cast<BufferPoolState*>(opaque);
+        av_free(data);
+        state->counters->buffers -= 1;
+        state->counters->bytes -= state->buffer_size;
+    }
+    static AVBufferRef* AllocBuffer(void* opaque, int size) noexcept {
+        auto state = reinterpret_cast<BufferPoolState*>(opaque);
+        auto data = static_cast<uint8_t*>(av_malloc(static_cast<std::size_t>(size)));
+        if (!data) {
+            return nullptr;
+        }
+        auto buf = av_buffer_create(data, size, &BufferPoolState::FreeBuffer, state, 0);
+        if (!buf) {
+            av_free(data);
+            return nullptr;
+        }
+        auto& counters = *state->counters;
+        counters.buffers += 1;
+        const auto bytes = counters.bytes += static_cast<std::size_t>(size);
+        auto high_water = counters.high_water_bytes.load();
+        while (bytes > high_water && 
+               !counters.high_water_bytes.compare_exchange_weak(high_water, bytes)) {
+        }
+        return buf;
+    }
+    static void FreePool(void* opaque) noexcept {
+        delete reinterpret_cast<BufferPoolState*>(opaque);
+    }
+};
+
+struct BufferRefDeleter {
+    void operator()(AVBufferRef* buf) const noexcept {
+        av_buffer_unref(&buf);
+    }
+};
+using unique_buffer_ref = std::unique_ptr<AVBufferRef, BufferRefDeleter>;
+
+struct BufferPoolDeleter {
+    void operator()(AVBufferPool* pool) const noexcept {
+        av_buffer_pool_uninit(&pool);
+    }
+};
+using unique_buffer_pool = std::unique_ptr<AVBufferPool, BufferPoolDeleter>;
+
+/**
+ AVBufferPool of size byte buffers that counts its allocations in counters
+*/
+inline result<unique_buffer_pool> MakeCountedBufferPool(std::shared_ptr<BufferPoolCounters> const& counters,
+                                                        std::size_t size) noexcept {
+    auto state = std::make_unique<BufferPoolState>(counters, size);
+    auto pool = av_buffer_pool_init2(static_cast<int>(size), state.get(),
+                                     &BufferPoolState::AllocBuffer,
+                                     &BufferPoolState::FreePool);
+    if (!pool) {
+        return luma_av::outcome::failure(errc::alloc_failure);
+    }
+    // the pool owns the state now
+    static_cast<void>(state.release());
+    return unique_buffer_pool{pool};
+}
+
+} // detail
+
+} // luma_av
+
+#endif // LUMA_AV_DETAIL_BUFFER_POOL_HPP
@@ -13,11 +13,20 @@ extern "C" {
 #include <libavutil/opt.h>
 }
 
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <optional>
+#include <ranges>
+#include <sstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <luma_av/frame.hpp>
 #include <luma_av/result.hpp>
+#include <luma_av/thread_pool.hpp>
 #include <luma_av/util.hpp>
 #include <luma_av/detail/ranges_config.hpp>
 
@@ -48,6 +57,34 @@ class FilterGraphArgs {
         s << aspect_ratio.num << "/" << aspect_ratio.den;
         return SetPair("pixel_aspect", std::move(s).str());
     }
+    /**
+     abuffer args. time_base defaults to 1/sample_rate there
+    */
+    FilterGraphArgs& SampleRate(int sample_rate) noexcept {
+        return SetPair("sample_rate", std::to_string(sample_rate));
+    }
+    FilterGraphArgs& SampleFormat(AVSampleFormat fmt) noexcept {
+        return SetPair("sample_fmt", std::to_string(static_cast<int>(fmt)));
+    }
+    FilterGraphArgs& ChannelLayout(uint64_t layout) noexcept {
+        std::stringstream s;
+        s << "0x" << std::hex << layout;
+        return SetPair("channel_layout", std::move(s).str());
+    }
+    FilterGraphArgs& Channels(int channels) noexcept {
+        return SetPair("channels", std::to_string(channels));
+    }
+    /**
+     sample rate, format and layout of par. set Channels yourself for an unknown layout
+    */
+    FilterGraphArgs& Audio(AudioParams const& par) noexcept {
+        SampleRate(par.sample_rate());
+        SampleFormat(par.format());
+        if (par.channel_layout()) {
+            ChannelLayout(par.channel_layout());
+        }
+        return *this;
+    }
     FilterGraphArgs& SetPair(std::string_view key, std::string_view val) noexcept {
         arg_pairs_.insert_or_assign(std::string{key}, std::string{val});
         return *this;
@@ -62,11 +99,15 @@ class FilterGraphArgs {
 
 template <std::ranges::range ArgPairs>
 std::string FormatFilterArgs(ArgPairs const& args) noexcept {
-    std::stringstream ss;
+    auto size = std::size_t{0};
+    for (auto const& [key, val] : args) {
+        size += key.size() + val.size() + 2;
+    }
+    std::string str;
+    str.reserve(size);
     for (auto const& [key, val] : args) {
-        ss << key << "=" << val << ":";
+        str.append(key).append(1, '=').append(val).append(1, ':');
     }
-    auto str = std::move(ss).str();
     if (!str.empty()) {
         // remove the last :
         str.pop_back();
@@ -111,6 +152,79 @@ inline result<const AVFilter*> FindFilter(const cstr_view name) noexcept {
     }
 }
 
+/**
+ threading for a FilterGraph. filters that support it split each frame into slices.
+ by default ffmpeg starts its own worker threads for every graph, 
+ with pool the slices run on a ThreadPool instead so many graphs can share one.
+ the pool has to outlive the graph
+*/
+class FilterGraphOpts {
+    public:
+    int threads() const noexcept {
+        return threads_;
+    }
+    /**
+     max slices per filter call. 0 is ffmpegs default (the cpu count, or pool size + 1 with a pool), 
+     1 turns threading off
+    */
+    auto& threads(int n) noexcept {
+        threads_ = n;
+        return *this;
+    }
+
+    bool slice_threads() const noexcept {
+        return slice_threads_;
+    }
+    auto& slice_threads(bool enable) noexcept {
+        slice_threads_ = enable;
+        return *this;
+    }
+
+    ThreadPool* pool() const noexcept {
+        return pool_;
+    }
+    /**
+     run slices on the pool (AVFilterGraph::execute) instead of ffmpegs own threads
+    */
+    auto& pool(ThreadPool& p) noexcept {
+        pool_ = std::addressof(p);
+        return *this;
+    }
+
+    private:
+    int threads_ = 0;
+    bool slice_threads_ = true;
+    ThreadPool* pool_ = nullptr;
+};
+
+namespace detail {
+
+/**
+ AVFilterGraph::execute for FilterGraphOpts::pool. the pool rides in the graphs opaque
+*/
+inline int ExecuteOnThreadPool(AVFilterContext* ctx, avfilter_action_func* func, void* arg, 
+                               int* ret, int nb_jobs) noexcept {
+    auto pool = static_cast<ThreadPool*>(ctx->graph->opaque);
+    pool->ParallelFor(nb_jobs, [&](int job) noexcept {
+        const auto r = func(ctx, arg, job, nb_jobs);
+        if (ret) {
+            ret[job] = r;
+        }
+    });
+    return 0;
+}
+
+} // detail
+
+/**
+ a filter graph with any number of named sources (buffer/abuffer) and sinks (buffersink/abuffersink).
+ the name a source/sink is created with is also its label in the graph description, e.g. 
+ two sources "in0" and "in1" and sinks "out0" and "out1" for 
+   "[in0][in1]overlay,split[out0][out1]"
+ the labels can only be left off like ffmpeg allows if the source is named "in" and the sink "out",
+ ffmpeg fills in exactly those names for an unlabeled first input and last output.
+ sources and sinks are numbered in the order they were created
+*/
 class FilterGraph {
 
     struct FilterGraphDeleter {
@@ -130,8 +244,40 @@ class FilterGraph {
         }
     }
 
-    AVFilterContext* buffersink_ctx_ = nullptr;
-    AVFilterContext* buffersrc_ctx_ = nullptr;
+    struct Pad {
+        std::string name;
+        AVFilterContext* ctx = nullptr;
+    };
+
+    /**
+     the AVFilterInOut list avfilter_graph_parse_ptr links the description against
+    */
+    static result<detail::unique_filter_inout> MakeInOutList(std::span<const Pad> pads) noexcept {
+        auto head = detail::unique_filter_inout{};
+        for (auto it = pads.rbegin(); it != pads.rend(); ++it) {
+            LUMA_AV_OUTCOME_TRY(iof, detail::AllocFilterInOut());
+            iof->name = av_strdup(it->name.c_str());
+            if (!iof->name) {
+                return errc::alloc_failure;
+            }
+            iof->filter_ctx = it->ctx;
+            iof->pad_idx = 0;
+            iof->next = head.release();
+            head = std::move(iof);
+        }
+        return std::move(head);
+    }
+
+    static result<std::size_t> FindPad(std::span<const Pad> pads, const cstr_view name) noexcept {
+        const auto it = std::ranges::find(pads, std::string_view{name.c_str()}, &Pad::name);
+        if (it == pads.end()) {
+            return errc::filter_not_found;
+        }
+        return static_cast<std::size_t>(it - pads.begin());
+    }
+
+    std::vector<Pad> srcs_;
+    std::vector<Pad> sinks_;
     unique_filter_graph fg_;
     FilterGraph(AVFilterGraph* fg) : fg_{fg} {}
     public:
@@ -140,118 +286,537 @@ class FilterGraph {
         LUMA_AV_OUTCOME_TRY(fg, AllocFilterGraph());
         return FilterGraph{fg.release()};
     }
+    static result<FilterGraph> make(FilterGraphOpts const& opts) noexcept {
+        if (opts.threads() < 0) {
+            return errc{AVERROR(EINVAL)};
+        }
+        LUMA_AV_OUTCOME_TRY(fg, AllocFilterGraph());
+        // has to happen before the first filter is created, thats when ffmpeg sets up threading
+        fg->thread_type = opts.slice_threads() ? AVFILTER_THREAD_SLICE : 0;
+        fg->nb_threads = opts.threads();
+        if (auto pool = opts.pool()) {
+            fg->opaque = pool;
+            fg->execute = &detail::ExecuteOnThreadPool;
+            if (fg->nb_threads == 0) {
+                // ffmpeg only picks a default for its own threads, 0 would mean 0 slices here
+                fg->nb_threads = static_cast<int>(pool->size()) + 1;
+            }
+        }
+        return FilterGraph{fg.release()};
+    }
 
     result<void> CreateSrcFilter(NotNull<const AVFilter*> filter, const cstr_view name, 
                                  FilterGraphArgs const& args = FilterGraphArgs{}) noexcept {
-        auto arg_str = luma_av::FormatFilterArgs(args.container());
-        LUMA_AV_OUTCOME_TRY_FF(avfilter_graph_create_filter(&buffersrc_ctx_, filter, name.c_str(),
-                                       detail::null_if_empty(arg_str), nullptr, fg_.get())); 
+        return this->CreateSrcFilter(filter, name, luma_av::FormatFilterArgs(args.container()));
+    }
+    /**
+     args already formatted like FormatFilterArgs does, empty for none
+    */
+    result<void> CreateSrcFilter(NotNull<const AVFilter*> filter, const cstr_view name, 
+                                 std::string const& args) noexcept {
+        AVFilterContext* ctx = nullptr;
+        LUMA_AV_OUTCOME_TRY_FF(avfilter_graph_create_filter(&ctx, filter, name.c_str(),
+                                       detail::null_if_empty(args), nullptr, fg_.get())); 
+        srcs_.push_back(Pad{name.c_str(), ctx});
         return luma_av::outcome::success();
     }
     result<void> CreateSinkFilter(NotNull<const AVFilter*> filter, const cstr_view name, 
                                  FilterGraphArgs const& args = FilterGraphArgs{}) noexcept {
-        auto arg_str = luma_av::FormatFilterArgs(args.container());
-        LUMA_AV_OUTCOME_TRY_FF(avfilter_graph_create_filter(&buffersink_ctx_, filter, name.c_str(),
-                                       detail::null_if_empty(arg_str), nullptr, fg_.get())); 
+        return this->CreateSinkFilter(filter, name, luma_av::FormatFilterArgs(args.container()));
+    }
+    result<void> CreateSinkFilter(NotNull<const AVFilter*> filter, const cstr_view name, 
+                                 std::string const& args) noexcept {
+        AVFilterContext* ctx = nullptr;
+        LUMA_AV_OUTCOME_TRY_FF(avfilter_graph_create_filter(&ctx, filter, name.c_str(),
+                                       detail::null_if_empty(args), nullptr, fg_.get())); 
+        sinks_.push_back(Pad{name.c_str(), ctx});
         return luma_av::outcome::success();
     }
 
+    /**
+     restrict what every sink created so far accepts
+    */
     result<void> SetSinkFilterFormats(std::span<const AVPixelFormat> fmts) {
-        LUMA_AV_OUTCOME_TRY_FF(av_opt_set_int_list(buffersink_ctx_, "pix_fmts", fmts.data(),
+        for (std::size_t i = 0; i < sinks_.size(); ++i) {
+            LUMA_AV_OUTCOME_TRY(this->SetSinkFilterFormats(i, fmts));
+        }
+        return luma_av::outcome::success();
+    }
+    result<void> SetSinkFilterFormats(std::size_t sink, std::span<const AVPixelFormat> fmts) {
+        LUMA_AV_OUTCOME_TRY(ctx, this->sink_context(sink));
+        LUMA_AV_OUTCOME_TRY_FF(av_opt_set_int_list(ctx, "pix_fmts", fmts.data(),
                                                    AV_PIX_FMT_NONE, AV_OPT_SEARCH_CHILDREN));
         return luma_av::outcome::success();
     }
 
+    /**
+     abuffersink constraints, before FinalizeConfig. like the pixel formats the lists
+     end in AV_SAMPLE_FMT_NONE or -1
+    */
+    result<void> SetSinkSampleFormats(std::size_t sink, std::span<const AVSampleFormat> fmts) {
+        LUMA_AV_OUTCOME_TRY(ctx, this->sink_context(sink));
+        LUMA_AV_OUTCOME_TRY_FF(av_opt_set_int_list(ctx, "sample_fmts", fmts.data(),
+                                                   AV_SAMPLE_FMT_NONE, AV_OPT_SEARCH_CHILDREN));
+        return luma_av::outcome::success();
+    }
+    result<void> SetSinkSampleRates(std::size_t sink, std::span<const int> rates) {
+        LUMA_AV_OUTCOME_TRY(ctx, this->sink_context(sink));
+        LUMA_AV_OUTCOME_TRY_FF(av_opt_set_int_list(ctx, "sample_rates", rates.data(),
+                                                   -1, AV_OPT_SEARCH_CHILDREN));
+        return luma_av::outcome::success();
+    }
+    result<void> SetSinkChannelLayouts(std::size_t sink, std::span<const int64_t> layouts) {
+        LUMA_AV_OUTCOME_TRY(ctx, this->sink_context(sink));
+        LUMA_AV_OUTCOME_TRY_FF(av_opt_set_int_list(ctx, "channel_layouts", layouts.data(),
+                                                   -1, AV_OPT_SEARCH_CHILDREN));
+        return luma_av::outcome::success();
+    }
+
+    /**
+     every frame out of an audio sink has exactly nb_samples (the last one may be short), 
+     saves rebatching after the graph. the sinks input only exists after FinalizeConfig
+    */
+    result<void> SetSinkFrameSize(std::size_t sink, unsigned nb_samples) noexcept {
+        LUMA_AV_OUTCOME_TRY(ctx, this->sink_context(sink));
+        if (ctx->nb_inputs == 0 || !ctx->inputs[0] || ctx->inputs[0]->type != AVMEDIA_TYPE_AUDIO
+            || nb_samples == 0) {
+            return errc{AVERROR(EINVAL)};
+        }
+        av_buffersink_set_frame_size(ctx, nb_samples);
+        return luma_av::outcome::success();
+    }
+
+    /**
+     parse filters_descr into the graph, linking its labels to the sources and sinks
+     by name, and configure the whole thing
+    */
     result<void> FinalizeConfig(const cstr_view filters_descr) noexcept {
-        LUMA_AV_OUTCOME_TRY(inputs, detail::AllocFilterInOut());
-        LUMA_AV_OUTCOME_TRY(outputs, detail::AllocFilterInOut());
-        
-        outputs->name       = av_strdup("in");
-        outputs->filter_ctx = buffersrc_ctx_;
-        outputs->pad_idx    = 0;
-        outputs->next       = nullptr;
-
-        inputs->name       = av_strdup("out");
-        inputs->filter_ctx = buffersink_ctx_;
-        inputs->pad_idx    = 0;
-        inputs->next       = nullptr;
+        // sources are open outputs of the graph so far, sinks are open inputs
+        LUMA_AV_OUTCOME_TRY(outputs, MakeInOutList(srcs_));
+        LUMA_AV_OUTCOME_TRY(inputs, MakeInOutList(sinks_));
 
         // the parse call may take ownership
         auto iptr = inputs.release();
         auto optr = outputs.release();
-        LUMA_AV_OUTCOME_TRY_FF(avfilter_graph_parse_ptr(fg_.get(), filters_descr.c_str(),
-                                    &iptr, &optr, nullptr));
+        const auto ec = avfilter_graph_parse_ptr(fg_.get(), filters_descr.c_str(),
+                                    &iptr, &optr, nullptr);
         // the parse call may reseat these to something we have to free
         inputs.reset(iptr);
         outputs.reset(optr);
+        LUMA_AV_OUTCOME_TRY_FF(ec);
 
         LUMA_AV_OUTCOME_TRY_FF(avfilter_graph_config(fg_.get(), nullptr));
 
         return luma_av::outcome::success();
     }
 
-    AVFilterContext* src_context() noexcept {
-        return buffersrc_ctx_;
+    std::size_t nb_srcs() const noexcept {
+        return srcs_.size();
+    }
+    std::size_t nb_sinks() const noexcept {
+        return sinks_.size();
+    }
+    std::string_view src_name(std::size_t src) const noexcept {
+        LUMA_AV_ASSERT(src < srcs_.size());
+        return srcs_[src].name;
+    }
+    std::string_view sink_name(std::size_t sink) const noexcept {
+        LUMA_AV_ASSERT(sink < sinks_.size());
+        return sinks_[sink].name;
+    }
+    result<std::size_t> src_index(const cstr_view name) const noexcept {
+        return FindPad(srcs_, name);
+    }
+    result<std::size_t> sink_index(const cstr_view name) const noexcept {
+        return FindPad(sinks_, name);
     }
 
+    /**
+     the first source/sink, nullptr if there is none
+    */
+    AVFilterContext* src_context() noexcept {
+        return srcs_.empty() ? nullptr : srcs_.front().ctx;
+    }
     AVFilterContext* sink_context() noexcept {
-        return buffersink_ctx_;
+        return sinks_.empty() ? nullptr : sinks_.front().ctx;
     }
 
+    result<NotNull<AVFilterContext*>> src_context(std::size_t src) noexcept {
+        if (src >= srcs_.size()) {
+            return errc{AVERROR(EINVAL)};
+        }
+        return srcs_[src].ctx;
+    }
+    result<NotNull<AVFilterContext*>> sink_context(std::size_t sink) noexcept {
+        if (sink >= sinks_.size()) {
+            return errc{AVERROR(EINVAL)};
+        }
+        return sinks_[sink].ctx;
+    }
+
+    AVFilterGraph* get() noexcept {
+        return fg_.get();
+    }
+    const AVFilterGraph* get() const noexcept {
+        return fg_.get();
+    }
+
+};
+
+/**
+ a source or sink of a FilterGraphTemplate. args are fixed for every graph, 
+ for sources the per graph FilterGraphArgs come after them
+*/
+struct FilterPadSpec {
+    std::string name;
+    const AVFilter* filter = nullptr;
+    FilterGraphArgs args{};
+    /**
+     sinks only, what the sink accepts. empty for anything
+    */
+    std::vector<AVPixelFormat> pix_fmts{};
+    std::vector<AVSampleFormat> sample_fmts{};
+    /**
+     sinks only, fixed audio frame size. 0 for whatever the graph gives
+    */
+    unsigned frame_size = 0;
+};
+
+/**
+ one filter description shared by many graphs, e.g. the same chain for thousands of streams.
+ make parses the description once to check it and that its labels match the pads, 
+ and formats the fixed pad args once. thats all it saves:
+ ffmpeg has no way to copy a configured graph and a used one keeps state (eof, pts, history),
+ so every Instantiate still parses and configures a new graph.
+ Instantiate is const, so threads can share one template
+*/
+class FilterGraphTemplate {
+    struct Pad {
+        std::string name;
+        NotNull<const AVFilter*> filter;
+        std::string args;
+        std::vector<AVPixelFormat> pix_fmts;
+        std::vector<AVSampleFormat> sample_fmts;
+        unsigned frame_size;
+    };
+
+    std::string description_;
+    std::vector<Pad> srcs_;
+    std::vector<Pad> sinks_;
+
+    FilterGraphTemplate(std::string description, std::vector<Pad> srcs, std::vector<Pad> sinks) noexcept 
+        : description_{std::move(description)}, srcs_{std::move(srcs)}, sinks_{std::move(sinks)} {}
+
+    static result<std::vector<Pad>> MakePads(std::span<const FilterPadSpec> specs) noexcept {
+        auto pads = std::vector<Pad>{};
+        pads.reserve(specs.size());
+        for (auto const& spec : specs) {
+            if (!spec.filter || spec.name.empty()) {
+                return errc{AVERROR(EINVAL)};
+            }
+            // the sinks read the lists up to these
+            auto pix_fmts = spec.pix_fmts;
+            if (!pix_fmts.empty() && pix_fmts.back() != AV_PIX_FMT_NONE) {
+                pix_fmts.push_back(AV_PIX_FMT_NONE);
+            }
+            auto sample_fmts = spec.sample_fmts;
+            if (!sample_fmts.empty() && sample_fmts.back() != AV_SAMPLE_FMT_NONE) {
+                sample_fmts.push_back(AV_SAMPLE_FMT_NONE);
+            }
+            pads.push_back(Pad{spec.name, spec.filter, 
+                               luma_av::FormatFilterArgs(spec.args.container()), 
+                               std::move(pix_fmts), std::move(sample_fmts), spec.frame_size});
+        }
+        return std::move(pads);
+    }
+
+    /**
+     the open pads of the parsed description have to be our pads. 
+     an unlabeled one is linked to the pad named default_label like ffmpeg does
+    */
+    static result<void> CheckOpenPads(AVFilterInOut const* open, std::span<const Pad> pads, 
+                                      const std::string_view default_label) noexcept {
+        auto count = std::size_t{0};
+        for (; open; open = open->next) {
+            const auto name = open->name ? std::string_view{open->name} : default_label;
+            if (std::ranges::find(pads, name, &Pad::name) == pads.end()) {
+                return errc::filter_not_found;
+            }
+            ++count;
+        }
+        if (count != pads.size()) {
+            return errc{AVERROR(EINVAL)};
+        }
+        return luma_av::outcome::success();
+    }
+
+    static result<void> Validate(const char* description, std::span<const Pad> srcs, 
+                                 std::span<const Pad> sinks) noexcept {
+        LUMA_AV_OUTCOME_TRY(scratch, FilterGraph::make());
+        AVFilterInOut* iptr = nullptr;
+        AVFilterInOut* optr = nullptr;
+        const auto ec = avfilter_graph_parse2(scratch.get(), description, &iptr, &optr);
+        auto inputs = detail::unique_filter_inout{iptr};
+        auto outputs = detail::unique_filter_inout{optr};
+        LUMA_AV_OUTCOME_TRY_FF(ec);
+        // open inputs of the description are fed by our sources, open outputs go to our sinks
+        LUMA_AV_OUTCOME_TRY(CheckOpenPads(inputs.get(), srcs, "in"));
+        LUMA_AV_OUTCOME_TRY(CheckOpenPads(outputs.get(), sinks, "out"));
+        return luma_av::outcome::success();
+    }
+
+    result<FilterGraph> Build(std::span<const std::string> src_args, FilterGraphOpts const& opts) const noexcept {
+        LUMA_AV_OUTCOME_TRY(graph, FilterGraph::make(opts));
+        for (std::size_t i = 0; i < srcs_.size(); ++i) {
+            auto const& src = srcs_[i];
+            auto args = src.args;
+            if (!args.empty() && !src_args[i].empty()) {
+                args += ':';
+            }
+            args += src_args[i];
+            LUMA_AV_OUTCOME_TRY(graph.CreateSrcFilter(src.filter, cstr_view{src.name.c_str()}, args));
+        }
+        for (std::size_t i = 0; i < sinks_.size(); ++i) {
+            auto const& sink = sinks_[i];
+            LUMA_AV_OUTCOME_TRY(graph.CreateSinkFilter(sink.filter, cstr_view{sink.name.c_str()}, sink.args));
+            if (!sink.pix_fmts.empty()) {
+                LUMA_AV_OUTCOME_TRY(graph.SetSinkFilterFormats(i, sink.pix_fmts));
+            }
+            if (!sink.sample_fmts.empty()) {
+                LUMA_AV_OUTCOME_TRY(graph.SetSinkSampleFormats(i, sink.sample_fmts));
+            }
+        }
+        LUMA_AV_OUTCOME_TRY(graph.FinalizeConfig(cstr_view{description_.c_str()}));
+        for (std::size_t i = 0; i < sinks_.size(); ++i) {
+            if (sinks_[i].frame_size) {
+                LUMA_AV_OUTCOME_TRY(graph.SetSinkFrameSize(i, sinks_[i].frame_size));
+            }
+        }
+        return std::move(graph);
+    }
+
+    public:
+    static result<FilterGraphTemplate> make(std::string description, std::span<const FilterPadSpec> srcs,
+                                            std::span<const FilterPadSpec> sinks) noexcept {
+        LUMA_AV_OUTCOME_TRY(src_pads, MakePads(srcs));
+        LUMA_AV_OUTCOME_TRY(sink_pads, MakePads(sinks));
+        LUMA_AV_OUTCOME_TRY(Validate(description.c_str(), src_pads, sink_pads));
+        return FilterGraphTemplate{std::move(description), std::move(src_pads), std::move(sink_pads)};
+    }
+
+    FilterGraphTemplate(FilterGraphTemplate&&) noexcept = default;
+    FilterGraphTemplate& operator=(FilterGraphTemplate&&) noexcept = default;
+
+    /**
+     a configured graph for the given per source args (one per source, in order)
+    */
+    result<FilterGraph> Instantiate(std::span<const FilterGraphArgs> src_args, 
+                                    FilterGraphOpts const& opts = FilterGraphOpts{}) const noexcept {
+        if (src_args.size() != srcs_.size()) {
+            return errc{AVERROR(EINVAL)};
+        }
+        auto args = std::vector<std::string>{};
+        args.reserve(src_args.size());
+        for (auto const& a : src_args) {
+            args.push_back(luma_av::FormatFilterArgs(a.container()));
+        }
+        return this->Build(args, opts);
+    }
+    result<FilterGraph> Instantiate(FilterGraphArgs const& src_args, 
+                                    FilterGraphOpts const& opts = FilterGraphOpts{}) const noexcept {
+        return this->Instantiate(std::span<const FilterGraphArgs>{&src_args, 1}, opts);
+    }
+
+    std::string_view description() const noexcept {
+        return description_;
+    }
+    std::size_t nb_srcs() const noexcept {
+        return srcs_.size();
+    }
+    std::size_t nb_sinks() const noexcept {
+        return sinks_.size();
+    }
 };
 
+/**
+ pushes frames through a FilterGraph. keeps one output frame per sink, 
+ GetSinkFrame hands out a pointer to it which is valid until the next GetSinkFrame for that sink.
+ the overloads without a source/sink use the first one
+*/
 class FilterSession {
     public:
 
     static result<FilterSession> make(FilterGraph graph) noexcept {
-        LUMA_AV_OUTCOME_TRY(frame, Frame::make());
-        return FilterSession{std::move(frame), std::move(graph)};
+        auto frames = std::vector<Frame>{};
+        frames.reserve(std::max<std::size_t>(graph.nb_sinks(), 1));
+        for (std::size_t i = 0; i < std::max<std::size_t>(graph.nb_sinks(), 1); ++i) {
+            LUMA_AV_OUTCOME_TRY(frame, Frame::make());
+            frames.push_back(std::move(frame));
+        }
+        return FilterSession{std::move(frames), std::move(graph)};
     }
 
+    /**
+     the graph takes a new ref to frames data, frame is left as is
+    */
     result<void> AddSrcFrame(Frame& frame) noexcept {
-        // assert that we have buffers. calling without buffers is a bug afaik
-        LUMA_AV_OUTCOME_TRY_FF(av_buffersrc_add_frame_flags(graph_.src_context(),
-                                             frame.get(), AV_BUFFERSRC_FLAG_KEEP_REF));
-        return luma_av::outcome::success();
+        return this->AddSrcFrame(0, frame);
+    } 
+    result<void> AddSrcFrame(std::size_t src, Frame& frame) noexcept {
+        return this->AddSrcFrameImpl(src, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
+    } 
+    result<void> AddSrcFrame(const cstr_view src, Frame& frame) noexcept {
+        LUMA_AV_OUTCOME_TRY(idx, graph_.src_index(src));
+        return this->AddSrcFrame(idx, frame);
     } 
 
+    /**
+     the graph takes over frames buffers instead of adding a ref, frame is left blank. 
+     saves a ref and lets buffersrc skip copying data it isnt allowed to keep
+    */
+    result<void> AddSrcFrame(Frame&& frame) noexcept {
+        return this->AddSrcFrame(0, std::move(frame));
+    } 
+    result<void> AddSrcFrame(std::size_t src, Frame&& frame) noexcept {
+        return this->AddSrcFrameImpl(src, frame, 0);
+    } 
+    result<void> AddSrcFrame(const cstr_view src, Frame&& frame) noexcept {
+        LUMA_AV_OUTCOME_TRY(idx, graph_.src_index(src));
+        return this->AddSrcFrame(idx, std::move(frame));
+    } 
+
+    bool fixed_src_params() const noexcept {
+        return fixed_src_params_;
+    }
+    /**
+     promise that every frame matches the args its source was created with, 
+     buffersrc then skips checking each frame for size/format changes (AV_BUFFERSRC_FLAG_NO_CHECK_FORMAT).
+     a frame that doesnt match is undefined behaviour inside the graph
+    */
+    auto& fixed_src_params(bool fixed) noexcept {
+        fixed_src_params_ = fixed;
+        return *this;
+    }
+
+    /**
+     end of input on every source
+    */
     result<void> MarkEOF() noexcept {
-        LUMA_AV_OUTCOME_TRY_FF(av_buffersrc_add_frame_flags(graph_.src_context(),
-                                             nullptr, AV_BUFFERSRC_FLAG_KEEP_REF));
+        for (std::size_t i = 0; i < graph_.nb_srcs(); ++i) {
+            LUMA_AV_OUTCOME_TRY(this->MarkEOF(i));
+        }
+        return luma_av::outcome::success();
+    } 
+    result<void> MarkEOF(std::size_t src) noexcept {
+        LUMA_AV_OUTCOME_TRY(ctx, graph_.src_context(src));
+        LUMA_AV_OUTCOME_TRY_FF(av_buffersrc_add_frame_flags(ctx, nullptr, AV_BUFFERSRC_FLAG_KEEP_REF));
         return luma_av::outcome::success();
     } 
+    result<void> MarkEOF(const cstr_view src) noexcept {
+        LUMA_AV_OUTCOME_TRY(idx, graph_.src_index(src));
+        return this->MarkEOF(idx);
+    } 
 
     result<NotNull<Frame*>> GetSinkFrame() noexcept {
-        LUMA_AV_OUTCOME_TRY_FF(av_buffersink_get_frame(graph_.sink_context(), frame_.get()));
-        return std::addressof(frame_);
+        return this->GetSinkFrame(0);
+    }  
+    result<NotNull<Frame*>> GetSinkFrame(std::size_t sink) noexcept {
+        LUMA_AV_OUTCOME_TRY(ctx, graph_.sink_context(sink));
+        auto& frame = frames_[sink];
+        // the sink moves its frame in without unrefing what was there
+        av_frame_unref(frame.get());
+        LUMA_AV_OUTCOME_TRY_FF(av_buffersink_get_frame(ctx, frame.get()));
+        return std::addressof(frame);
+    }  
+    result<NotNull<Frame*>> GetSinkFrame(const cstr_view sink) noexcept {
+        LUMA_AV_OUTCOME_TRY(idx, graph_.sink_index(sink));
+        return this->GetSinkFrame(idx);
     }  
 
+    FilterGraph& graph() noexcept {
+        return graph_;
+    }
+    FilterGraph const& graph() const noexcept {
+        return graph_;
+    }
+
     private:
-    FilterSession(Frame frame, FilterGraph graph) noexcept
-        : frame_{std::move(frame)}, graph_{std::move(graph)} {}
-    Frame frame_;
+    FilterSession(std::vector<Frame> frames, FilterGraph graph) noexcept
+        : frames_{std::move(frames)}, graph_{std::move(graph)} {}
+
+    result<void> AddSrcFrameImpl(std::size_t src, Frame& frame, int flags) noexcept {
+        LUMA_AV_OUTCOME_TRY(ctx, graph_.src_context(src));
+        if (fixed_src_params_) {
+            flags |= AV_BUFFERSRC_FLAG_NO_CHECK_FORMAT;
+        }
+        // assert that we have buffers. calling without buffers is a bug afaik
+        LUMA_AV_OUTCOME_TRY_FF(av_buffersrc_add_frame_flags(ctx, frame.get(), flags));
+        return luma_av::outcome::success();
+    }
+
+    std::vector<Frame> frames_;
     FilterGraph graph_;
+    bool fixed_src_params_ = false;
+};
+
+/**
+ one frame out of a multi output graph and the sink it came out of
+*/
+struct FilterOutput {
+    std::size_t sink{};
+    NotNull<Frame*> frame;
+};
+
+/**
+ what the filter views do with frames they only get a pointer to (NotNull<Frame*>, result<NotNull<Frame*>>).
+ ref by default, the pointer can be to a frame the caller still holds (a vector under views::process,
+ a transform over held frames). move only when u know the input is some stage's workspace frame
+ that gets refilled on the next step anyway, then the graph takes its buffers instead of a new ref
+*/
+enum class FrameHandoff {
+    ref,
+    move,
 };
 
 namespace detail {
 
 // overloads for all of the different types of frames we support 
 //  from the input range
+// rvalue frames are moved into the graph, pointers are moved only if the view was told to, 
+//  everything else is ref'd
 struct AddFrameClosure {
     FilterSession& filter_;
+    FrameHandoff handoff_ = FrameHandoff::ref;
     result<void> operator()(NotNull<Frame*> frame) noexcept {
-        return filter_.AddSrcFrame(*frame);
+        return AddPointee(*frame);
     }
     result<void> operator()(Frame& frame) noexcept {
         return filter_.AddSrcFrame(frame);
     }
+    result<void> operator()(Frame&& frame) noexcept {
+        return filter_.AddSrcFrame(std::move(frame));
+    }
     result<void> operator()(result<Frame>& frame_res) noexcept {
         LUMA_AV_OUTCOME_TRY(frame, frame_res);
         return filter_.AddSrcFrame(frame);
     }
+    result<void> operator()(result<Frame>&& frame_res) noexcept {
+        if (!frame_res) {
+            return frame_res.error();
+        }
+        return filter_.AddSrcFrame(std::move(frame_res).value());
+    }
     result<void> operator()(result<NotNull<Frame*>> const& frame_res) noexcept {
         LUMA_AV_OUTCOME_TRY(frame, frame_res);
-        return filter_.AddSrcFrame(*frame);
+        return AddPointee(*frame);
+    }
+
+    private:
+    result<void> AddPointee(Frame& frame) noexcept {
+        if (handoff_ == FrameHandoff::move) {
+            return filter_.AddSrcFrame(std::move(frame));
+        }
+        return filter_.AddSrcFrame(frame);
     }
 };
 
@@ -262,8 +827,9 @@ template <std::ranges::view R>
 class filter_graph_view_impl : public std::ranges::view_interface<filter_graph_view_impl<R>> {
 public:
 filter_graph_view_impl() noexcept = default;
-explicit filter_graph_view_impl(R base, FilterSession& filter) 
-    : base_{std::move(base)}, filter_{std::addressof(filter)} {
+explicit filter_graph_view_impl(R base, FilterSession& filter, bool drain_me = false, 
+                                FrameHandoff handoff = FrameHandoff::ref) 
+    : base_{std::move(base)}, filter_{std::addressof(filter)}, drain_me_{drain_me}, handoff_{handoff} {
 
 }
 
@@ -297,6 +863,8 @@ auto end() {
 private:
 R base_{};
 FilterSession* filter_ = nullptr;
+bool drain_me_ = false;
+FrameHandoff handoff_ = FrameHandoff::ref;
 
 template <bool is_const>
 class iterator;
@@ -307,6 +875,10 @@ class iterator;
 //  also ofc we dont want to generate a bunch of classes for all the different forwarding refs so we strip that
 template <std::ranges::viewable_range R>
 filter_graph_view_impl(R&&, FilterSession&) -> filter_graph_view_impl<std::ranges::views::all_t<R>>;
+template <std::ranges::viewable_range R>
+filter_graph_view_impl(R&&, FilterSession&, bool) -> filter_graph_view_impl<std::ranges::views::all_t<R>>;
+template <std::ranges::viewable_range R>
+filter_graph_view_impl(R&&, FilterSession&, bool, FrameHandoff) -> filter_graph_view_impl<std::ranges::views::all_t<R>>;
 
 
 template <std::ranges::view R>
@@ -322,6 +894,9 @@ class filter_graph_view_impl<R>::iterator {
     mutable bool reached_eof_ = false;
     mutable std::ptrdiff_t skip_count_{0};
     mutable std::optional<output_type> cached_frame_;
+    // the sink may still have frames from the last push (fps, tile, telecine etc give several)
+    mutable bool polling_ = false;
+    mutable bool eof_sent_ = false;
 
 public:
 
@@ -361,28 +936,42 @@ output_type operator*() const {
         return *cached_frame_;
     }
     auto& filt = parent_->filter();
-    for(;current_!=std::ranges::end(parent_->base_); ++current_) {
-        LUMA_AV_OUTCOME_TRY(detail::AddFrameClosure{filt}(*current_));
-        if (auto res = filt.GetSinkFrame()) {
-            if (skip_count_ <= 0) {
+    while (true) {
+        // everything the sink has before pushing anything else
+        while (polling_) {
+            auto res = filt.GetSinkFrame();
+            if (res) {
+                if (skip_count_ > 0) {
+                    skip_count_ -= 1;
+                    continue;
+                }
                 auto out = output_type{res.value()};
                 cached_frame_ = out;
                 skip_count_ = -1;
-                ++current_;
                 return out;
+            } else if (res.error().value() == AVERROR(EAGAIN) || 
+                       res.error().value() == AVERROR_EOF) {
+                polling_ = false;
             } else {
-                skip_count_ -= 1;
-                continue;
+                reached_eof_ = true;
+                return res.error();
             }
-        } else if (res.error().value() == AVERROR(EAGAIN)) {
-            continue;
+        }
+        if (current_ != std::ranges::end(parent_->base_)) {
+            auto res = detail::AddFrameClosure{filt, parent_->handoff_}(*current_);
+            ++current_;
+            if (!res) {
+                return res.error();
+            }
+        } else if (parent_->drain_me_ && !eof_sent_) {
+            eof_sent_ = true;
+            LUMA_AV_OUTCOME_TRY(filt.MarkEOF());
         } else {
             reached_eof_ = true;
-            return res.error();
+            return errc::detail_filter_range_end;
         }
+        polling_ = true;
     }
-    reached_eof_ = true;
-    return errc::detail_filter_range_end;
 }
 
 iterator& operator++() {
@@ -421,6 +1010,7 @@ requires std::equality_comparable<std::ranges::iterator_t<base_t>> {
         current_ == other.current_ &&
         reached_eof_ == other.reached_eof_ &&
         skip_count_ == other.skip_count_ &&
+        polling_ == other.polling_ &&
         cached_frame_.has_value() == other.cached_frame_.has_value();
 }
 
@@ -443,19 +1033,21 @@ template <class F>
 class filter_graph_view_impl_range_adaptor_closure {
     F f_;
     FilterSession* filter_;
+    FrameHandoff handoff_;
     public:
-    filter_graph_view_impl_range_adaptor_closure(F f, FilterSession& filt) 
-        : f_{std::move(f)}, filter_{std::addressof(filt)} {
+    filter_graph_view_impl_range_adaptor_closure(F f, FilterSession& filt, 
+                                                 FrameHandoff handoff = FrameHandoff::ref) 
+        : f_{std::move(f)}, filter_{std::addressof(filt)}, handoff_{handoff} {
 
     }
     template <std::ranges::viewable_range R>
     decltype(auto) operator()(R&& r) {
-        return std::invoke(f_, std::forward<R>(r), *filter_);
+        return std::invoke(f_, std::forward<R>(r), *filter_, handoff_);
     }
 
     template <std::ranges::viewable_range R>
     decltype(auto) operator()(R&& r) const {
-         return std::invoke(f_, std::forward<R>(r), *filter_);
+         return std::invoke(f_, std::forward<R>(r), *filter_, handoff_);
     }
 };
 
@@ -465,17 +1057,220 @@ decltype(auto) operator|(R&& r, filter_graph_view_impl_range_adaptor_closure<F>
 }
 
 
+template <bool drain_me>
 class filter_graph_view_impl_fn {
 public:
 template <class R>
-auto operator()(R&& r, FilterSession& filt) const {
+auto operator()(R&& r, FilterSession& filt, FrameHandoff handoff = FrameHandoff::ref) const {
     // idk why the deduction guide doesnt work 
     return filter_graph_view_impl{
-        std::views::all(std::forward<R>(r)), filt} | filter_range_end;
+        std::views::all(std::forward<R>(r)), filt, drain_me, handoff} | filter_range_end;
 }
-auto operator()(FilterSession& filt) const {
+auto operator()(FilterSession& filt, FrameHandoff handoff = FrameHandoff::ref) const {
     return filter_graph_view_impl_range_adaptor_closure<
-            filter_graph_view_impl_fn>{filter_graph_view_impl_fn{}, filt};
+            filter_graph_view_impl_fn>{filter_graph_view_impl_fn{}, filt, handoff};
+}
+};
+
+/**
+ pushes each input frame into the first source and then takes everything every sink has,
+ so a graph that splits into several outputs produces them all in one pass over the input
+*/
+template <std::ranges::view R>
+class filter_graph_outputs_view_impl : public std::ranges::view_interface<filter_graph_outputs_view_impl<R>> {
+public:
+filter_graph_outputs_view_impl() noexcept = default;
+explicit filter_graph_outputs_view_impl(R base, FilterSession& filter, bool drain_me, 
+                                        FrameHandoff handoff = FrameHandoff::ref) 
+    : base_{std::move(base)}, filter_{std::addressof(filter)}, drain_me_{drain_me}, handoff_{handoff} {
+
+}
+
+auto base() const noexcept -> R {
+    return base_;
+}
+auto filter() const noexcept -> FilterSession& {
+    return *filter_;
+}
+
+auto begin() {
+    return iterator<false>{*this};
+}
+
+auto end() {
+    return std::ranges::end(base_);
+}
+
+private:
+R base_{};
+FilterSession* filter_ = nullptr;
+bool drain_me_ = false;
+FrameHandoff handoff_ = FrameHandoff::ref;
+
+template <bool is_const>
+class iterator;
+
+};
+
+template <std::ranges::viewable_range R>
+filter_graph_outputs_view_impl(R&&, FilterSession&, bool) -> filter_graph_outputs_view_impl<std::ranges::views::all_t<R>>;
+template <std::ranges::viewable_range R>
+filter_graph_outputs_view_impl(R&&, FilterSession&, bool, FrameHandoff) -> filter_graph_outputs_view_impl<std::ranges::views::all_t<R>>;
+
+
+template <std::ranges::view R>
+template <bool is_const>
+class filter_graph_outputs_view_impl<R>::iterator {
+    using output_type = result<FilterOutput>;
+    using parent_t = detail::MaybeConst_t<is_const, filter_graph_outputs_view_impl<R>>;
+    using base_t = detail::MaybeConst_t<is_const, R>;
+    friend iterator<not is_const>;
+
+    parent_t* parent_ = nullptr;
+    mutable std::ranges::iterator_t<base_t> current_{};
+    mutable bool reached_end_ = false;
+    mutable std::ptrdiff_t skip_count_{0};
+    mutable std::optional<output_type> cached_frame_;
+    // taking output from sinks [next_sink_, nb_sinks) after the last push
+    mutable bool polling_ = false;
+    mutable std::size_t next_sink_{0};
+    mutable bool eof_sent_ = false;
+
+public:
+
+using difference_type = std::ptrdiff_t;
+using value_type = output_type;
+
+iterator() = default;
+
+explicit iterator(parent_t& parent) 
+ : parent_{std::addressof(parent)},
+    current_{std::ranges::begin(parent.base_)} {
+}
+
+std::ranges::iterator_t<base_t> base() const {
+    return current_;
+}
+
+output_type operator*() const {
+    LUMA_AV_ASSERT(!reached_end_);
+    LUMA_AV_ASSERT(skip_count_ >= -1);
+    if ((skip_count_== -1) && (cached_frame_)) {
+        return *cached_frame_;
+    }
+    auto& filt = parent_->filter();
+    const auto nb_sinks = filt.graph().nb_sinks();
+    while (true) {
+        // each sink until it runs dry (or hits eof after draining)
+        while (polling_ && next_sink_ < nb_sinks) {
+            auto res = filt.GetSinkFrame(next_sink_);
+            if (res) {
+                if (skip_count_ > 0) {
+                    skip_count_ -= 1;
+                    continue;
+                }
+                auto out = output_type{FilterOutput{next_sink_, res.value()}};
+                cached_frame_ = out;
+                skip_count_ = -1;
+                return out;
+            } else if (res.error().value() == AVERROR(EAGAIN) || 
+                       res.error().value() == AVERROR_EOF) {
+                next_sink_ += 1;
+            } else {
+                reached_end_ = true;
+                return res.error();
+            }
+        }
+        polling_ = false;
+        if (current_ != std::ranges::end(parent_->base_)) {
+            auto res = detail::AddFrameClosure{filt, parent_->handoff_}(*current_);
+            ++current_;
+            if (!res) {
+                return res.error();
+            }
+        } else if (parent_->drain_me_ && !eof_sent_) {
+            eof_sent_ = true;
+            LUMA_AV_OUTCOME_TRY(filt.MarkEOF());
+        } else {
+            reached_end_ = true;
+            return errc::detail_filter_range_end;
+        }
+        polling_ = true;
+        next_sink_ = 0;
+    }
+}
+
+iterator& operator++() {
+    skip_count_ += 1;
+    return *this;
+}
+
+void operator++(int) {
+    ++*this;
+}
+
+iterator operator++(int) 
+requires std::ranges::forward_range<base_t> {
+    auto temp = *this;
+    ++*this;
+    return temp;
+}
+
+bool operator==(std::ranges::sentinel_t<base_t> const& other) const {
+    return reached_end_;
+}
+
+bool operator==(iterator const& other) const 
+requires std::equality_comparable<std::ranges::iterator_t<base_t>> {
+    auto filter_or_null = [](auto parent) -> FilterSession* {
+        if (parent) {
+            return parent->filter_;
+        } else {
+            return nullptr;
+        }
+    };
+    return filter_or_null(parent_) == filter_or_null(other.parent_) &&
+        current_ == other.current_ &&
+        reached_end_ == other.reached_end_ &&
+        skip_count_ == other.skip_count_ &&
+        next_sink_ == other.next_sink_ &&
+        cached_frame_.has_value() == other.cached_frame_.has_value();
+}
+
+};
+
+class filter_graph_outputs_range_adaptor_closure {
+    FilterSession* filter_;
+    bool drain_me_;
+    FrameHandoff handoff_;
+    public:
+    filter_graph_outputs_range_adaptor_closure(FilterSession& filt, bool drain_me, 
+                                               FrameHandoff handoff = FrameHandoff::ref) 
+        : filter_{std::addressof(filt)}, drain_me_{drain_me}, handoff_{handoff} {
+
+    }
+    template <std::ranges::viewable_range R>
+    auto operator()(R&& r) const {
+        return filter_graph_outputs_view_impl{std::views::all(std::forward<R>(r)), *filter_, 
+                                              drain_me_, handoff_}
+                | filter_range_end;
+    }
+};
+
+template <std::ranges::viewable_range R>
+decltype(auto) operator|(R&& r, filter_graph_outputs_range_adaptor_closure const& closure) {
+    return closure(std::forward<R>(r));
+}
+
+template <bool drain_me>
+class filter_graph_outputs_view_fn {
+public:
+template <class R>
+auto operator()(R&& r, FilterSession& filt, FrameHandoff handoff = FrameHandoff::ref) const {
+    return filter_graph_outputs_range_adaptor_closure{filt, drain_me, handoff}(std::forward<R>(r));
+}
+auto operator()(FilterSession& filt, FrameHandoff handoff = FrameHandoff::ref) const {
+    return filter_graph_outputs_range_adaptor_closure{filt, drain_me, handoff};
 }
 };
 
@@ -484,10 +1279,29 @@ auto operator()(FilterSession& filt) const {
 } // detail
 
 #ifdef LUMA_AV_ENABLE_RANGES
-inline const auto filter_graph_view = detail::filter_graph_view_impl_fn{};
+/**
+ frames | views::filter_graph(session) pushes each frame into the first source and yields 
+ every frame the first sink has after it. the _drain variant marks eof on the sources once 
+ the input ends and yields what the graph still had buffered.
+ views::filter_graph(session, FrameHandoff::move) moves pointed to input frames into the graph
+ instead of ref'ing them, only for inputs nobody else holds on to
+*/
+inline const auto filter_graph_view = detail::filter_graph_view_impl_fn<false>{};
+inline const auto filter_graph_drain_view = detail::filter_graph_view_impl_fn<true>{};
+
+/**
+ frames | views::filter_graph_outputs(session) yields result<FilterOutput> for every frame any
+ sink produces. the _drain variant marks eof on the sources once the input ends and
+ yields what the graph still had buffered
+*/
+inline const auto filter_graph_outputs_view = detail::filter_graph_outputs_view_fn<false>{};
+inline const auto filter_graph_outputs_drain_view = detail::filter_graph_outputs_view_fn<true>{};
 
 namespace views {
 inline const auto filter_graph = filter_graph_view;
+inline const auto filter_graph_drain = filter_graph_drain_view;
+inline const auto filter_graph_outputs = filter_graph_outputs_view;
+inline const auto filter_graph_outputs_drain = filter_graph_outputs_drain_view;
 } // views
 #endif  // LUMA_AV_ENABLE_RANGES
 
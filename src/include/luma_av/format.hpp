@@ -12,9 +12,16 @@ extern "C" {
 }
 
 #include <luma_av/packet.hpp>
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <climits>
+#include <cstdio>
 #include <map>
+#include <new>
 #include <ranges>
 #include <span>
+#include <vector>
 // we only need the buffer but its not in its own header yet
 #include <luma_av/frame.hpp>
 #include <luma_av/result.hpp>
@@ -23,23 +30,25 @@ extern "C" {
 
 namespace luma_av {
 
+/**
+ read only view of a whole file through av_file_map. the mapping is refcounted, packets made
+ with Packet::WrapMapped(buff.region(), ...) (or a Parser made with the region) keep it alive 
+ after the MappedFileBuff is gone
+*/
 class MappedFileBuff {
     struct BuffInfo {
         uint8_t* buff = nullptr;
         std::size_t size{};
     };
-    struct UnmapDeleter {
-        void operator()(BuffInfo* buff) noexcept {
-            if (!buff) {
-                return;
-            }
-            av_file_unmap(buff->buff, buff->size);
-            delete buff;
-        }
-    };
-    using unique_mapbuff = std::unique_ptr<BuffInfo, UnmapDeleter>;
-    unique_mapbuff buff_{};
-    MappedFileBuff(BuffInfo* buff) noexcept :  buff_{buff} {
+    static void Unmap(void* opaque, uint8_t*) noexcept {
+        auto info = reinterpret_cast<BuffInfo*>(opaque);
+        av_file_unmap(info->buff, info->size);
+        delete info;
+    }
+    detail::unique_buffer_ref buff_{};
+    // AVBufferRef sizes are int so the real one lives here
+    std::size_t size_{};
+    MappedFileBuff(AVBufferRef* buff, std::size_t size) noexcept :  buff_{buff}, size_{size} {
 
     }
     public:
@@ -47,29 +56,48 @@ class MappedFileBuff {
         uint8_t* buff = nullptr;
         std::size_t size{};
         LUMA_AV_OUTCOME_TRY_FF(av_file_map(filename.c_str(), &buff, &size, 0, NULL));
-        return MappedFileBuff(new BuffInfo{buff, size});
+        auto info = new(std::nothrow) BuffInfo{buff, size};
+        if (!info) {
+            av_file_unmap(buff, size);
+            return luma_av::outcome::failure(errc::alloc_failure);
+        }
+        const auto ref_size = static_cast<int>(std::min<std::size_t>(size, INT_MAX));
+        auto ref = av_buffer_create(buff, ref_size, &MappedFileBuff::Unmap, info, 
+                                    AV_BUFFER_FLAG_READONLY);
+        if (!ref) {
+            Unmap(info, buff);
+            return luma_av::outcome::failure(errc::alloc_failure);
+        }
+        return MappedFileBuff(ref, size);
     }
 
+    /**
+     the file is mapped copy on write, but packets wrapping the mapping see writes through here
+    */
     std::span<uint8_t> span() noexcept {
-        return {buff_->buff, buff_->size};
+        return {buff_->data, size_};
     }
     std::span<const uint8_t> span() const noexcept {
-        return {buff_->buff, buff_->size};
+        return {buff_->data, size_};
     }
 
     uint8_t* data() noexcept {
-        return buff_->buff;
+        return buff_->data;
     }
     const uint8_t* data() const noexcept {
-        return buff_->buff;
+        return buff_->data;
     }
 
     std::size_t size() const noexcept {
-        return buff_->size;
+        return size_;
     }
 
     int ssize() const noexcept {
-        return static_cast<int>(buff_->size);
+        return static_cast<int>(size_);
+    }
+
+    MappedRegion region() const noexcept {
+        return MappedRegion{buff_.get(), this->span()};
     }
 };
 
@@ -175,16 +203,22 @@ inline auto CustomSeekPtr(CustomIOFunctions const& iof) noexcept -> int64_t(*)(v
 } // detail
 
 
-class IOContext {
-    struct AVIOCDeleter {
-        void operator()(AVIOContext* s) noexcept {
-            if (s) {
-                av_freep(&s->buffer);
-            }
-            avio_context_free(&s);	
+namespace detail {
+// the avio buffer can be reallocated by ffmpeg so we always free whatever
+//  the context currently points to rather than what we originally gave it
+struct AVIOCDeleter {
+    void operator()(AVIOContext* s) noexcept {
+        if (s) {
+            av_freep(&s->buffer);
         }
-    };
-    using unique_ioc = std::unique_ptr<AVIOContext, AVIOCDeleter>;
+        avio_context_free(&s);	
+    }
+};
+using unique_ioc = std::unique_ptr<AVIOContext, AVIOCDeleter>;
+} // detail
+
+class IOContext {
+    using unique_ioc = detail::unique_ioc;
 
     static result<unique_ioc> InitIOC(unsigned char* buffer, int buffer_size, int write_flag, void* opaque, 
                                int(*read_packet)(void *opaque, uint8_t *buf, int buf_size),
@@ -230,13 +264,433 @@ class IOContext {
 
 
     AVIOContext* get() noexcept {
-        ioc_.get();
+        return ioc_.get();
+    }
+    const AVIOContext* get() const noexcept {
+        return ioc_.get();
+    }
+};
+
+/**
+ growable output storage made of fixed size chunks allocated with av_malloc.
+ growing only ever adds a chunk so data already written is never moved or copied.
+ the write position can be moved anywhere (including past the end, the gap is zero filled
+ on the next write) which is what muxers need to go back and patch headers.
+ Reset() keeps the chunks so the same memory can be reused for the next segment
+*/
+class MemoryArena {
+    public:
+    static constexpr auto default_chunk_size = std::size_t{1024 * 1024};
+
+    /**
+     chunk_size is the size of every allocation the arena makes.
+     reserve_size bytes worth of chunks are allocated up front
+    */
+    static result<MemoryArena> make(std::size_t chunk_size = default_chunk_size, 
+                                    std::size_t reserve_size = 0) noexcept {
+        LUMA_AV_ASSERT(chunk_size > 0);
+        auto arena = MemoryArena{chunk_size};
+        LUMA_AV_OUTCOME_TRY(arena.Reserve(reserve_size));
+        return std::move(arena);
+    }
+
+    MemoryArena(MemoryArena const&) = delete;
+    MemoryArena& operator=(MemoryArena const&) = delete;
+    MemoryArena(MemoryArena&&) noexcept = default;
+    MemoryArena& operator=(MemoryArena&&) noexcept = default;
+
+    /**
+     make sure at least `size` bytes are backed by chunks
+    */
+    result<void> Reserve(std::size_t size) noexcept {
+        while (capacity() < size) {
+            LUMA_AV_OUTCOME_TRY(chunk, Buffer::make(chunk_size_));
+            chunks_.push_back(std::move(chunk));
+        }
+        return luma_av::outcome::success();
+    }
+
+    /**
+     write at the current position, overwriting any existing data and growing as needed
+    */
+    result<void> Write(std::span<const uint8_t> data) noexcept {
+        LUMA_AV_OUTCOME_TRY(Reserve(pos_ + data.size()));
+        if (pos_ > size_) {
+            this->Fill(size_, pos_ - size_, 0);
+        }
+        auto offset = pos_;
+        while (!data.empty()) {
+            auto& chunk = chunks_[offset / chunk_size_];
+            const auto chunk_offset = offset % chunk_size_;
+            const auto n = std::min(data.size(), chunk_size_ - chunk_offset);
+            std::copy_n(data.data(), n, chunk.data() + chunk_offset);
+            data = data.subspan(n);
+            offset += n;
+        }
+        pos_ = offset;
+        size_ = std::max(size_, pos_);
+        return luma_av::outcome::success();
+    }
+
+    /**
+     move the write position. nothing is allocated until the next write
+    */
+    void SeekTo(std::size_t pos) noexcept {
+        pos_ = pos;
+    }
+    std::size_t tell() const noexcept {
+        return pos_;
+    }
+
+    /**
+     number of bytes written (including any zero filled gaps)
+    */
+    std::size_t size() const noexcept {
+        return size_;
+    }
+    std::size_t capacity() const noexcept {
+        return chunks_.size() * chunk_size_;
+    }
+    std::size_t chunk_size() const noexcept {
+        return chunk_size_;
+    }
+
+    /**
+     views of the written data in order. the last span may be shorter than chunk_size.
+     the spans are invalidated by Reset or ShrinkToFit but not by further writes
+    */
+    std::vector<std::span<const uint8_t>> Chunks() const {
+        std::vector<std::span<const uint8_t>> out;
+        auto remaining = size_;
+        for (auto const& chunk : chunks_) {
+            if (remaining == 0) {
+                break;
+            }
+            const auto n = std::min(remaining, chunk_size_);
+            out.push_back(chunk.view().first(n));
+            remaining -= n;
+        }
+        return out;
+    }
+
+    /**
+     forget the written data but keep the chunks for reuse
+    */
+    void Reset() noexcept {
+        size_ = 0;
+        pos_ = 0;
+    }
+
+    /**
+     free any chunks that arent holding written data
+    */
+    void ShrinkToFit() noexcept {
+        const auto needed = (size_ + chunk_size_ - 1) / chunk_size_;
+        chunks_.erase(chunks_.begin() + static_cast<std::ptrdiff_t>(needed), chunks_.end());
+    }
+
+    private:
+    explicit MemoryArena(std::size_t chunk_size) noexcept : chunk_size_{chunk_size} {}
+
+    // caller makes sure the range is already reserved
+    void Fill(std::size_t offset, std::size_t count, uint8_t val) noexcept {
+        while (count > 0) {
+            auto& chunk = chunks_[offset / chunk_size_];
+            const auto chunk_offset = offset % chunk_size_;
+            const auto n = std::min(count, chunk_size_ - chunk_offset);
+            std::fill_n(chunk.data() + chunk_offset, n, val);
+            count -= n;
+            offset += n;
+        }
+    }
+
+    std::size_t chunk_size_;
+    std::vector<Buffer> chunks_;
+    std::size_t size_{};
+    std::size_t pos_{};
+};
+
+namespace detail {
+
+struct MemoryArenaFptrCaller {
+    static int WritePacket(void *opaque, uint8_t *buf, int buf_size) {
+        auto arena = reinterpret_cast<MemoryArena*>(opaque);
+        const auto size = static_cast<std::size_t>(buf_size);
+        if (auto res = arena->Write({buf, size}); !res) {
+            return res.error().value();
+        }
+        return buf_size;
+    }
+    static int64_t Seek(void *opaque, int64_t offset, int whence) {
+        auto arena = reinterpret_cast<MemoryArena*>(opaque);
+        if (whence & AVSEEK_SIZE) {
+            return static_cast<int64_t>(arena->size());
+        }
+        auto base = int64_t{};
+        switch (whence & ~AVSEEK_FORCE) {
+            case SEEK_SET:
+                base = 0;
+                break;
+            case SEEK_CUR:
+                base = static_cast<int64_t>(arena->tell());
+                break;
+            case SEEK_END:
+                base = static_cast<int64_t>(arena->size());
+                break;
+            default:
+                return AVERROR(EINVAL);
+        }
+        const auto pos = base + offset;
+        if (pos < 0) {
+            return AVERROR(EINVAL);
+        }
+        arena->SeekTo(static_cast<std::size_t>(pos));
+        return pos;
+    }
+};
+
+} // detail
+
+/**
+ write only, seekable io context that muxes into a MemoryArena instead of a file.
+ after writing the trailer the output is available with Chunks() without any copies.
+ Recycle() makes the context ready for the next segment while keeping the arena memory
+*/
+class MemoryOutputIOContext {
+    public:
+    static constexpr auto default_buffer_size = int{32 * 1024};
+
+    static result<MemoryOutputIOContext> make(MemoryArena arena, 
+                                              int buffer_size = default_buffer_size) noexcept {
+        LUMA_AV_OUTCOME_TRY(buff, Buffer::make(static_cast<std::size_t>(buffer_size)));
+        auto arena_ptr = std::make_unique<MemoryArena>(std::move(arena));
+        auto ioc = avio_alloc_context(buff.data(), buffer_size, 1, arena_ptr.get(), nullptr,
+                                      &detail::MemoryArenaFptrCaller::WritePacket,
+                                      &detail::MemoryArenaFptrCaller::Seek);
+        if (!ioc) {
+            return errc::alloc_failure;
+        }
+        // the ioc owns the buffer now
+        static_cast<void>(buff.release());
+        return MemoryOutputIOContext{std::move(arena_ptr), ioc};
+    }
+    static result<MemoryOutputIOContext> make(
+                std::size_t chunk_size = MemoryArena::default_chunk_size) noexcept {
+        LUMA_AV_OUTCOME_TRY(arena, MemoryArena::make(chunk_size));
+        return MemoryOutputIOContext::make(std::move(arena));
+    }
+
+    /**
+     write any data still sitting in the avio buffer into the arena
+    */
+    result<void> Flush() noexcept {
+        avio_flush(ioc_.get());
+        LUMA_AV_OUTCOME_TRY_FF(ioc_->error);
+        return luma_av::outcome::success();
+    }
+
+    /**
+     flushes and returns views of everything written so far. see MemoryArena::Chunks
+    */
+    result<std::vector<std::span<const uint8_t>>> Chunks() noexcept {
+        LUMA_AV_OUTCOME_TRY(this->Flush());
+        return arena_->Chunks();
+    }
+    result<std::size_t> size() noexcept {
+        LUMA_AV_OUTCOME_TRY(this->Flush());
+        return arena_->size();
+    }
+
+    /**
+     drop the written data and rewind to the start so the context can be
+     given to the next muxer. the arena keeps its chunks
+    */
+    result<void> Recycle() noexcept {
+        LUMA_AV_OUTCOME_TRY(this->Flush());
+        arena_->Reset();
+        const auto ret = avio_seek(ioc_.get(), 0, SEEK_SET);
+        if (ret < 0) {
+            return errc{static_cast<int>(ret)};
+        }
+        return luma_av::outcome::success();
+    }
+
+    MemoryArena const& arena() const noexcept {
+        return *arena_;
+    }
+
+    /**
+     take the arena back e.g. to hand the data off. any unflushed data is lost
+     so flush first
+    */
+    MemoryArena ReleaseArena() && noexcept {
+        ioc_.reset();
+        return std::move(*arena_);
+    }
+
+    AVIOContext* get() noexcept {
+        return ioc_.get();
     }
     const AVIOContext* get() const noexcept {
         return ioc_.get();
     }
+
+    private:
+    MemoryOutputIOContext(std::unique_ptr<MemoryArena> arena, AVIOContext* ioc) noexcept
+        : arena_{std::move(arena)}, ioc_{ioc} {}
+    // the avio callbacks point at the arena so it needs a stable address
+    std::unique_ptr<MemoryArena> arena_;
+    detail::unique_ioc ioc_;
 };
 
+/**
+ one mode for live inputs (ts/flv over pipes, fifos, sockets) that gives up probing
+ and buffering in exchange for latency:
+    - demuxer: nobuffer, the minimal probe and no stream analysis
+    - io: direct (unbuffered) avio for urls, small avio buffers for custom io
+    - reads: nonblocking demuxer reads (av_read_frame may return EAGAIN) and an
+      interrupt callback that fires on a user condition or when a read takes longer
+      than read_timeout. note ffmpeg only checks the interrupt between transfers so
+      a protocol sitting in a blocking syscall still has to return first
+ decoders fed by a live input should also be opened with CodecContext::EnableLowDelay
+*/
+class LiveInputOpts {
+    public:
+    // smallest probe ffmpeg accepts
+    static constexpr auto default_probe_size = int64_t{32};
+    // 7 ts packets. same as a typical udp payload
+    static constexpr auto default_io_buffer_size = int{7 * 188};
+    // smallest nonzero analysis, zero would hand it back to ffmpeg's default (5s, more for ts/flv)
+    static constexpr auto default_analyze_duration = std::chrono::microseconds{1};
+
+    LiveInputOpts() noexcept = default;
+
+    int64_t probe_size() const noexcept {
+        return probe_size_;
+    }
+    auto& probe_size(int64_t size) noexcept {
+        probe_size_ = size;
+        return *this;
+    }
+
+    std::chrono::microseconds analyze_duration() const noexcept {
+        return analyze_duration_;
+    }
+    // zero asks for ffmpeg's own default
+    auto& analyze_duration(std::chrono::microseconds dur) noexcept {
+        analyze_duration_ = dur;
+        return *this;
+    }
+
+    int io_buffer_size() const noexcept {
+        return io_buffer_size_;
+    }
+    auto& io_buffer_size(int size) noexcept {
+        io_buffer_size_ = size;
+        return *this;
+    }
+
+    bool direct_io() const noexcept {
+        return direct_io_;
+    }
+    auto& direct_io(bool direct) noexcept {
+        direct_io_ = direct;
+        return *this;
+    }
+
+    bool nonblocking() const noexcept {
+        return nonblocking_;
+    }
+    auto& nonblocking(bool nonblock) noexcept {
+        nonblocking_ = nonblock;
+        return *this;
+    }
+
+    // zero means reads never time out
+    std::chrono::microseconds read_timeout() const noexcept {
+        return read_timeout_;
+    }
+    auto& read_timeout(std::chrono::microseconds timeout) noexcept {
+        read_timeout_ = timeout;
+        return *this;
+    }
+
+    // return true to abort whatever blocking call the format context is in
+    auto const& interrupt() const noexcept {
+        return interrupt_;
+    }
+    template <class F>
+    requires std::convertible_to<std::invoke_result_t<F>, bool>
+    auto& interrupt(F&& f) noexcept {
+        interrupt_ = std::forward<F>(f);
+        return *this;
+    }
+
+    private:
+    int64_t probe_size_ = default_probe_size;
+    std::chrono::microseconds analyze_duration_ = default_analyze_duration;
+    int io_buffer_size_ = default_io_buffer_size;
+    bool direct_io_ = true;
+    bool nonblocking_ = true;
+    std::chrono::microseconds read_timeout_{0};
+    std::function<bool()> interrupt_;
+};
+
+namespace detail {
+
+/**
+ state behind AVFormatContext::interrupt_callback. needs a stable address
+ so the format context holds it by unique_ptr
+*/
+class LiveInterrupt {
+    using clock = std::chrono::steady_clock;
+    public:
+    LiveInterrupt(std::function<bool()> interrupt, std::chrono::microseconds timeout) noexcept
+        : interrupt_{std::move(interrupt)}, timeout_{timeout} {}
+
+    // start the timeout for the next blocking call
+    void Arm() noexcept {
+        if (timeout_.count() > 0) {
+            deadline_ = clock::now() + timeout_;
+        }
+    }
+
+    bool Interrupted() const {
+        if (interrupt_ && std::invoke(interrupt_)) {
+            return true;
+        }
+        return (timeout_.count() > 0) && (clock::now() > deadline_);
+    }
+
+    AVIOInterruptCB callback() noexcept {
+        return AVIOInterruptCB{&LiveInterrupt::Callback, this};
+    }
+
+    private:
+    static int Callback(void* opaque) {
+        return reinterpret_cast<LiveInterrupt*>(opaque)->Interrupted() ? 1 : 0;
+    }
+    std::function<bool()> interrupt_;
+    std::chrono::microseconds timeout_;
+    clock::time_point deadline_{};
+};
+
+inline void ApplyLiveOpts(NotNull<AVFormatContext*> fctx, LiveInputOpts const& opts,
+                          LiveInterrupt& interrupt) noexcept {
+    fctx->flags |= AVFMT_FLAG_NOBUFFER;
+    if (opts.nonblocking()) {
+        fctx->flags |= AVFMT_FLAG_NONBLOCK;
+    }
+    if (opts.direct_io()) {
+        fctx->avio_flags |= AVIO_FLAG_DIRECT;
+    }
+    fctx->probesize = opts.probe_size();
+    fctx->max_analyze_duration = opts.analyze_duration().count();
+    fctx->interrupt_callback = interrupt.callback();
+}
+
+} // detail
+
 /*
 Most importantly an AVFormatContext contains:
     the input or output format. It is either autodetected or set by user for input;
@@ -321,6 +775,8 @@ class format_context {
         AVFormatContext* parent_ctx_;
         std::map<AVMediaType, StreamInfo> streams_infos_;
     };
+    // declared first so its destroyed after fctx_ which may still call it on close
+    std::unique_ptr<detail::LiveInterrupt> interrupt_;
     unique_fctx fctx_{};
     StreamInfoMap streams_;
     std::optional<IOContext> ioc_;
@@ -334,6 +790,27 @@ class format_context {
         : fctx_{ctx}, streams_{ctx}, ioc_{std::move(ioc)} {
 
     }
+    format_context(AVFormatContext* ctx, std::optional<IOContext> ioc,
+                   std::unique_ptr<detail::LiveInterrupt> interrupt) noexcept
+        : interrupt_{std::move(interrupt)}, fctx_{ctx}, streams_{ctx}, ioc_{std::move(ioc)} {
+
+    }
+
+    static result<format_context> open_live_input(const char* url, std::optional<IOContext> ioc,
+                                                  LiveInputOpts const& opts) noexcept {
+        LUMA_AV_OUTCOME_TRY(fctx, alloc_format_ctx());
+        auto interrupt = std::make_unique<detail::LiveInterrupt>(opts.interrupt(),
+                                                                 opts.read_timeout());
+        detail::ApplyLiveOpts(fctx.get(), opts, *interrupt);
+        if (ioc) {
+            fctx->pb = ioc->get();
+        }
+        interrupt->Arm();
+        // note: open_input needs ownership of fctx cause it will free on failure :/
+        auto fptr = fctx.release();
+        LUMA_AV_OUTCOME_TRY_FF(avformat_open_input(&fptr, url, nullptr, nullptr));
+        return format_context{fptr, std::move(ioc), std::move(interrupt)};
+    }
 
 
     public:
@@ -364,7 +841,22 @@ class format_context {
         return format_context{fptr, std::move(ioc)};
     }
 
+    /**
+     open a live input in low latency mode. see LiveInputOpts
+    */
+    static result<format_context> open_input(const cstr_view url, 
+                                             LiveInputOpts const& opts) noexcept {
+        return format_context::open_live_input(url.c_str(), std::nullopt, opts);
+    }
+    static result<format_context> open_input(IOContext ioc, 
+                                             LiveInputOpts const& opts) noexcept {
+        return format_context::open_live_input(nullptr, std::move(ioc), opts);
+    }
+
     result<void> FindStreamInfo(AVDictionary** options = nullptr) noexcept {
+        if (interrupt_) {
+            interrupt_->Arm();
+        }
         LUMA_AV_OUTCOME_TRY_FF(avformat_find_stream_info(fctx_.get(), options));
         return luma_av::outcome::success();
     }
@@ -402,6 +894,9 @@ class format_context {
 
     // lighest weight easiest to misuse
     result<void> read_frame(AVPacket* pkt) noexcept {
+        if (interrupt_) {
+            interrupt_->Arm();
+        }
         return detail::ffmpeg_code_to_result(av_read_frame(fctx_.get(), pkt));
     }
     // if the user wants to manage the packet themselves
@@ -438,6 +933,23 @@ class Reader {
         LUMA_AV_OUTCOME_TRY(pkt, Packet::make());
         return Reader{std::move(fctx), std::move(pkt)};
     }
+    /**
+     live input in low latency mode. see LiveInputOpts.
+     ReadFrame may return EAGAIN when opts.nonblocking() is set
+    */
+    static result<Reader> make(const cstr_view url, LiveInputOpts const& opts) noexcept {
+        LUMA_AV_OUTCOME_TRY(fctx, format_context::open_input(url, opts));
+        LUMA_AV_OUTCOME_TRY(fctx.FindStreamInfo());
+        LUMA_AV_OUTCOME_TRY(pkt, Packet::make());
+        return Reader{std::move(fctx), std::move(pkt)};
+    }
+    static result<Reader> make(CustomIOFunctions io_functions, LiveInputOpts const& opts) noexcept {
+        LUMA_AV_OUTCOME_TRY(ioc, IOContext::make(opts.io_buffer_size(), std::move(io_functions)));
+        LUMA_AV_OUTCOME_TRY(fctx, format_context::open_input(std::move(ioc), opts));
+        LUMA_AV_OUTCOME_TRY(fctx.FindStreamInfo());
+        LUMA_AV_OUTCOME_TRY(pkt, Packet::make());
+        return Reader{std::move(fctx), std::move(pkt)};
+    }
     result<void> ReadFrameInPlace() noexcept {
         return fctx_.read_frame(reader_packet_);
     }
@@ -466,15 +978,25 @@ class Reader {
 
 };
 
+/**
+ what views::read_input reads from. Reader, or anything else that hands out packets the same way
+ (e.g. PacketLogReader), with AVERROR_EOF at the end
+*/
+template <class T>
+concept PacketSource = requires (T& src) {
+    { src.ReadFrameInPlace() } -> std::same_as<result<void>>;
+    { src.view_packet() } -> std::same_as<Packet&>;
+};
+
 #ifdef LUMA_AV_ENABLE_RANGES
 namespace detail {
 // i dont understand why these specific concepts
-template <std::ranges::view R>
-class input_reader_view : public std::ranges::view_interface<input_reader_view<R>> {
+template <std::ranges::view R, PacketSource ReaderT = Reader>
+class input_reader_view : public std::ranges::view_interface<input_reader_view<R, ReaderT>> {
 public:
 
 input_reader_view() noexcept = default;
-explicit input_reader_view(R base, Reader& reader) 
+explicit input_reader_view(R base, ReaderT& reader) 
     : base_{std::move(base)}, reader_{std::addressof(reader)} {
 
 }
@@ -483,7 +1005,7 @@ explicit input_reader_view(R base, Reader& reader)
 auto base() const noexcept -> R {
     return base_;
 }
-auto reader() const noexcept -> Reader& {
+auto reader() const noexcept -> ReaderT& {
     return *reader_;
 }
 
@@ -508,7 +1030,7 @@ auto end() {
 
 private:
 R base_{};
-Reader* reader_ = nullptr;
+ReaderT* reader_ = nullptr;
 
 template <bool is_const>
 class iterator;
@@ -516,15 +1038,15 @@ class iterator;
 };
 
 
-template <std::ranges::viewable_range R>
-input_reader_view(R&&, Reader&) -> input_reader_view<std::ranges::views::all_t<R>>;
+template <std::ranges::viewable_range R, PacketSource ReaderT>
+input_reader_view(R&&, ReaderT&) -> input_reader_view<std::ranges::views::all_t<R>, ReaderT>;
 
 
-template <std::ranges::view R>
+template <std::ranges::view R, PacketSource ReaderT>
 template <bool is_const>
-class input_reader_view<R>::iterator {
+class input_reader_view<R, ReaderT>::iterator {
     using output_type = result<NotNull<Packet*>>;
-    using parent_t = detail::MaybeConst_t<is_const, input_reader_view<R>>;
+    using parent_t = detail::MaybeConst_t<is_const, input_reader_view<R, ReaderT>>;
     using base_t = detail::MaybeConst_t<is_const, R>;
     friend iterator<not is_const>;
 
@@ -617,7 +1139,7 @@ bool operator==(std::ranges::sentinel_t<base_t> const& other) const {
 
 bool operator==(iterator const& other) const 
 requires std::equality_comparable<std::ranges::iterator_t<base_t>> {
-    auto reader_or_null = [](auto parent) -> Reader* {
+    auto reader_or_null = [](auto parent) -> ReaderT* {
         if (parent) {
             return parent->reader_;
         } else {
@@ -647,7 +1169,8 @@ inline const auto filter_reader_uwu = filter_reader_uwu_view;
 
 class input_reader_view_fn {
 public:
-auto operator()(Reader& reader) const {
+template <PacketSource ReaderT>
+auto operator()(ReaderT& reader) const {
     return input_reader_view{std::views::single(0), reader} | filter_reader_uwu;
 }
 };
@@ -3,17 +3,35 @@
 #define LUMA_AV_FRAME_HPP
 
 extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/channel_layout.h>
 #include <libavutil/frame.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/samplefmt.h>
 }
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <new>
 #include <optional>
 #include <span>
+#include <type_traits>
 #include <variant>
+#include <vector>
 
 #include <luma_av/result.hpp>
+#include <luma_av/thread_pool.hpp>
 #include <luma_av/util.hpp>
+#include <luma_av/detail/buffer_pool.hpp>
 
 namespace luma_av {
 
@@ -23,7 +41,7 @@ namespace luma_av {
 class Buffer {
     struct AVBuffDeleter {
         void operator()(uint8_t* av_ptr) {
-            av_free(&av_ptr);
+            av_free(av_ptr);
         }
     };
     using buffer_ptr = std::unique_ptr<uint8_t, AVBuffDeleter>;
@@ -103,11 +121,14 @@ struct VideoParams {
         return *this;
     }
 
+    friend bool operator==(VideoParams const&, VideoParams const&) = default;
 };
 
 struct AudioParams {
     int nb_samples_{};
     uint64_t channel_layout_{};
+    AVSampleFormat format_{};
+    int sample_rate_{};
 
     int nb_samples() const noexcept {
         return nb_samples_;
@@ -124,10 +145,45 @@ struct AudioParams {
         channel_layout_ = c;
         return *this;
     }
+
+    AVSampleFormat format() const noexcept {
+        return format_;
+    }
+    auto& format(AVSampleFormat fmt) noexcept {
+        format_ = fmt;
+        return *this;
+    }
+
+    // doesnt affect the buffer size, but it is part of what the samples mean
+    int sample_rate() const noexcept {
+        return sample_rate_;
+    }
+    auto& sample_rate(int rate) noexcept {
+        sample_rate_ = rate;
+        return *this;
+    }
+
+    int channels() const noexcept {
+        return av_get_channel_layout_nb_channels(channel_layout_);
+    }
+
+    friend bool operator==(AudioParams const&, AudioParams const&) = default;
 };
 
 using FrameBufferParams = std::variant<VideoParams, AudioParams>;
 
+/**
+ rectangle in pixels of an image, x/y is the top left corner
+*/
+struct ImageRect {
+    int x{};
+    int y{};
+    int width{};
+    int height{};
+
+    friend bool operator==(ImageRect const&, ImageRect const&) = default;
+};
+
 namespace detail {
 inline void ApplyParams(NotNull<AVFrame*> frame, VideoParams const& par) noexcept {
     frame->width = par.width();
@@ -138,6 +194,9 @@ inline void ApplyParams(NotNull<AVFrame*> frame, VideoParams const& par) noexcep
 inline void ApplyParams(NotNull<AVFrame*> frame, AudioParams const& par) noexcept {
     frame->nb_samples = par.nb_samples();
     frame->channel_layout = par.channel_layout();
+    frame->channels = av_get_channel_layout_nb_channels(par.channel_layout());
+    frame->format = par.format();
+    frame->sample_rate = par.sample_rate();
 }
 
 inline void ApplyParams(NotNull<AVFrame*> frame, FrameBufferParams const& par) noexcept {
@@ -151,12 +210,12 @@ inline void ApplyParams(NotNull<AVFrame*> frame, FrameBufferParams const& par) n
 */
 inline std::optional<FrameBufferParams> get_buffer_params(AVFrame const* frame) noexcept {
     // a buffer is always a requirement
-    if (!frame->data) {
+    if (!frame->data[0]) {
         return std::nullopt;
     }
 
-    // video frame
-    if (frame->linesize) {
+    // video frame. data and linesize are arrays so they cant tell audio and video apart
+    if (frame->nb_samples == 0) {
         // its gona be callers bug if width/height/format arent set but buffers are.
         //  i cant rly safely work with those buffers without that info
         LUMA_AV_ASSERT(frame->width != 0);
@@ -170,7 +229,9 @@ inline std::optional<FrameBufferParams> get_buffer_params(AVFrame const* frame)
         LUMA_AV_ASSERT(frame->channel_layout != 0);
         return AudioParams{
                 .nb_samples_ = frame->nb_samples,
-                .channel_layout_ = frame->channel_layout};
+                .channel_layout_ = frame->channel_layout,
+                .format_ = static_cast<AVSampleFormat>(frame->format),
+                .sample_rate_ = frame->sample_rate};
     }
 }
 
@@ -220,6 +281,380 @@ inline void MoveFrameRefImpl(NotNull<AVFrame*> dst, NotNull<AVFrame*> src) noexc
     av_frame_move_ref(dst, src);
     detail::ApplyParams(dst, src_buff.value());
 }
+
+/**
+ opaque of the AVBuffer backing a wrapped frame. ffmpeg calls Free when the last 
+ ref to the buffer drops, on whatever thread that happens on
+*/
+struct WrappedFrameRelease {
+    std::function<void()> release;
+
+    static void Free(void* opaque, uint8_t*) noexcept {
+        auto state = reinterpret_cast<WrappedFrameRelease*>(opaque);
+        if (state->release) {
+            state->release();
+        }
+        delete state;
+    }
+};
+
+/**
+ checks the callers planes can hold an image of par, returns the number of planes
+*/
+inline result<int> CheckWrapPlanes(VideoParams const& par, std::span<uint8_t* const> planes, 
+                                   std::span<const int> strides) noexcept {
+    const auto* desc = av_pix_fmt_desc_get(par.format());
+    if (!desc || par.width() <= 0 || par.height() <= 0) {
+        return errc{AVERROR(EINVAL)};
+    }
+    // palette and hw frames need more than plain plane pointers
+    if (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM)) {
+        return errc{AVERROR(EINVAL)};
+    }
+    const auto nb_planes = av_pix_fmt_count_planes(par.format());
+    if (nb_planes < 0) {
+        return errc{nb_planes};
+    }
+    if (planes.size() < static_cast<std::size_t>(nb_planes) || 
+        strides.size() < static_cast<std::size_t>(nb_planes)) {
+        return errc{AVERROR(EINVAL)};
+    }
+    for (auto i = 0; i < nb_planes; ++i) {
+        const auto row_bytes = av_image_get_linesize(par.format(), par.width(), i);
+        if (row_bytes < 0) {
+            return errc{row_bytes};
+        }
+        if (!planes[i] || std::abs(strides[i]) < row_bytes) {
+            return errc{AVERROR(EINVAL)};
+        }
+    }
+    return nb_planes;
+}
+} // detail
+
+/**
+ 2d view of one image plane. each row is contiguous, rows are stride bytes apart. the
+ stride can be larger than a row (alignment padding) or negative (vertically flipped image).
+ width is in elements of T, not pixels. rows come out as spans so plain loops over them vectorize.
+ doesnt own the pixels, the frame has to outlive the view.
+*/
+template <class T>
+class PlaneView {
+    using byte_type = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+    public:
+    using element_type = T;
+
+    class RowIterator {
+        public:
+        using value_type = std::span<T>;
+        using difference_type = std::ptrdiff_t;
+
+        RowIterator() noexcept = default;
+        RowIterator(byte_type* row, int width, std::ptrdiff_t stride) noexcept 
+            : row_{row}, width_{width}, stride_{stride} {}
+
+        std::span<T> operator*() const noexcept {
+            return {reinterpret_cast<T*>(row_), static_cast<std::size_t>(width_)};
+        }
+        RowIterator& operator++() noexcept {
+            row_ += stride_;
+            return *this;
+        }
+        RowIterator operator++(int) noexcept {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        friend bool operator==(RowIterator const& lhs, RowIterator const& rhs) noexcept {
+            return lhs.row_ == rhs.row_;
+        }
+
+        private:
+        byte_type* row_{};
+        int width_{};
+        std::ptrdiff_t stride_{};
+    };
+
+    struct Rows {
+        RowIterator first;
+        RowIterator last;
+        RowIterator begin() const noexcept {
+            return first;
+        }
+        RowIterator end() const noexcept {
+            return last;
+        }
+    };
+
+    constexpr PlaneView() noexcept = default;
+    constexpr PlaneView(T* data, int width, int height, std::ptrdiff_t stride) noexcept
+        : data_{data}, width_{width}, height_{height}, stride_{stride} {}
+
+    constexpr T* data() const noexcept {
+        return data_;
+    }
+    constexpr int width() const noexcept {
+        return width_;
+    }
+    constexpr int height() const noexcept {
+        return height_;
+    }
+    // in bytes
+    constexpr std::ptrdiff_t stride() const noexcept {
+        return stride_;
+    }
+    constexpr bool empty() const noexcept {
+        return width_ == 0 || height_ == 0;
+    }
+
+    std::span<T> row(int y) const noexcept {
+        LUMA_AV_ASSERT(y >= 0 && y < height_);
+        return {reinterpret_cast<T*>(this->row_bytes(y)), static_cast<std::size_t>(width_)};
+    }
+    T& operator()(int x, int y) const noexcept {
+        LUMA_AV_ASSERT(x >= 0 && x < width_);
+        return this->row(y)[static_cast<std::size_t>(x)];
+    }
+
+    /**
+     for (auto row : plane.rows()) { for (auto& px : row) {...} }
+    */
+    Rows rows() const noexcept {
+        return Rows{RowIterator{this->row_bytes(0), width_, stride_},
+                    RowIterator{this->row_bytes(height_), width_, stride_}};
+    }
+
+    /**
+     sub rectangle of the plane. no copy, shares the same memory and stride
+    */
+    PlaneView Crop(int x, int y, int width, int height) const noexcept {
+        LUMA_AV_ASSERT(x >= 0 && y >= 0 && width >= 0 && height >= 0);
+        LUMA_AV_ASSERT(x + width <= width_ && y + height <= height_);
+        return PlaneView{reinterpret_cast<T*>(this->row_bytes(y)) + x, width, height, stride_};
+    }
+
+    operator PlaneView<const T>() const noexcept {
+        return PlaneView<const T>{data_, width_, height_, stride_};
+    }
+
+    private:
+    byte_type* row_bytes(int y) const noexcept {
+        return reinterpret_cast<byte_type*>(data_) + static_cast<std::ptrdiff_t>(y) * stride_;
+    }
+
+    T* data_{};
+    int width_{};
+    int height_{};
+    std::ptrdiff_t stride_{};
+};
+
+namespace detail {
+
+/**
+ size of one plane of an image in pixels, and the bytes per pixel in that plane
+*/
+struct PlaneLayout {
+    int width{};
+    int height{};
+    int pixel_step{};
+};
+
+inline result<PlaneLayout> GetPlaneLayout(VideoParams const& par, int plane) noexcept {
+    const auto* desc = av_pix_fmt_desc_get(par.format());
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+        return errc{AVERROR(EINVAL)};
+    }
+    if (plane < 0 || plane >= av_pix_fmt_count_planes(par.format())) {
+        return errc{AVERROR(EINVAL)};
+    }
+    int max_step[4] = {};
+    int max_step_comp[4] = {};
+    av_image_fill_max_pixsteps(max_step, max_step_comp, desc);
+    // same rules av_image_fill_linesizes uses for subsampled chroma
+    const auto chroma_comp = max_step_comp[plane] == 1 || max_step_comp[plane] == 2;
+    const auto chroma_plane = plane == 1 || plane == 2;
+    return PlaneLayout{
+        .width = AV_CEIL_RSHIFT(par.width(), chroma_comp ? desc->log2_chroma_w : 0),
+        .height = AV_CEIL_RSHIFT(par.height(), chroma_plane ? desc->log2_chroma_h : 0),
+        .pixel_step = max_step[plane]};
+}
+
+/**
+ T has to tile the planes pixels. e.g. uint8_t or a 3 byte struct for rgb24, uint16_t for yuv420p10
+*/
+template <class T>
+result<PlaneView<T>> MakePlaneView(T* data, int linesize, PlaneLayout const& layout) noexcept {
+    if (layout.pixel_step % static_cast<int>(sizeof(T)) != 0) {
+        return errc{AVERROR(EINVAL)};
+    }
+    const auto width = layout.width * (layout.pixel_step / static_cast<int>(sizeof(T)));
+    return PlaneView<T>{data, width, layout.height, linesize};
+}
+
+/**
+ subsampled chroma cant start halfway through a chroma sample, so crops of 
+ those formats have to start on a multiple of these
+*/
+inline result<ImageRect> GetChromaAlignment(AVPixelFormat format) noexcept {
+    const auto* desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_PAL))) {
+        return errc{AVERROR(EINVAL)};
+    }
+    return ImageRect{.width = 1 << desc->log2_chroma_w, .height = 1 << desc->log2_chroma_h};
+}
+
+/**
+ refs src into dst and moves dsts plane pointers to the top left of rect. 
+ no pixels are copied, dst shares srcs buffers
+*/
+inline result<void> CropFrameImpl(NotNull<AVFrame*> dst, NotNull<AVFrame const*> src, 
+                                  ImageRect const& rect) noexcept {
+    const auto src_par = std::get<VideoParams>(detail::get_buffer_params(src).value());
+    LUMA_AV_OUTCOME_TRY(align, detail::GetChromaAlignment(src_par.format()));
+    if (rect.x < 0 || rect.y < 0 || rect.width <= 0 || rect.height <= 0 || 
+        rect.x > src_par.width() - rect.width || rect.y > src_par.height() - rect.height) {
+        return errc{AVERROR(EINVAL)};
+    }
+    if (rect.x % align.width != 0 || rect.y % align.height != 0) {
+        return errc{AVERROR(EINVAL)};
+    }
+    LUMA_AV_OUTCOME_TRY(detail::RefFrameImpl(dst, src));
+    const auto nb_planes = av_pix_fmt_count_planes(src_par.format());
+    for (auto i = 0; i < nb_planes; ++i) {
+        // linesize of x pixels is the byte offset of column x, chroma subsampling included
+        const auto x_bytes = rect.x ? av_image_get_linesize(src_par.format(), rect.x, i) : 0;
+        const auto y_rows = (i == 1 || i == 2) ? rect.y / align.height : rect.y;
+        dst->data[i] += static_cast<std::ptrdiff_t>(y_rows) * dst->linesize[i] + x_bytes;
+    }
+    dst->extended_data = dst->data;
+    dst->width = rect.width;
+    dst->height = rect.height;
+    // the frame is already cropped, dont let anything downstream apply it again
+    dst->crop_top = dst->crop_bottom = dst->crop_left = dst->crop_right = 0;
+    return luma_av::outcome::success();
+}
+
+/**
+ splits n pixels into count chroma aligned spans, the last span takes the remainder
+*/
+inline result<std::vector<int>> TileEdges(int n, int count, int align) noexcept {
+    if (count <= 0 || count > n / align) {
+        return errc{AVERROR(EINVAL)};
+    }
+    auto edges = std::vector<int>(static_cast<std::size_t>(count) + 1);
+    for (auto i = 0; i < count; ++i) {
+        const auto edge = static_cast<int>(static_cast<int64_t>(i) * n / count);
+        edges[i] = edge - edge % align;
+    }
+    edges.back() = n;
+    return std::move(edges);
+}
+} // detail
+
+/**
+ how CopyToImageBuffer lays out the image in the callers storage and how the copy is done.
+ align is the row alignment of the destination (1 for tightly packed rows, which is what most
+ ml runtimes want). with a pool the planes are split into bands of rows copied in parallel
+*/
+class ImageCopyOpts {
+    public:
+    static constexpr auto default_align = int{32};
+    static constexpr auto default_min_band_rows = int{64};
+
+    int align() const noexcept {
+        return align_;
+    }
+    auto& align(int a) noexcept {
+        align_ = a;
+        return *this;
+    }
+
+    ThreadPool* pool() const noexcept {
+        return pool_;
+    }
+    auto& pool(ThreadPool& p) noexcept {
+        pool_ = std::addressof(p);
+        return *this;
+    }
+
+    /**
+     bands smaller than this arent worth a task
+    */
+    int min_band_rows() const noexcept {
+        return min_band_rows_;
+    }
+    auto& min_band_rows(int rows) noexcept {
+        min_band_rows_ = rows;
+        return *this;
+    }
+
+    private:
+    int align_ = default_align;
+    ThreadPool* pool_ = nullptr;
+    int min_band_rows_ = default_min_band_rows;
+};
+
+namespace detail {
+/**
+ av_image_copy_to_buffer split into row bands run on the pool. falls back to 
+ av_image_copy_to_buffer for palette/bitstream/hw formats. dst must already be big enough
+*/
+inline result<void> CopyImageToBuffer(std::span<uint8_t> dst, const uint8_t* const src_data[4], 
+                                      const int src_linesize[4], VideoParams const& par,
+                                      ImageCopyOpts const& opts) noexcept {
+    const auto* desc = av_pix_fmt_desc_get(par.format());
+    if (!desc) {
+        return errc{AVERROR(EINVAL)};
+    }
+    constexpr auto serial_flags = AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL;
+    if (!opts.pool() || (desc->flags & serial_flags)) {
+        LUMA_AV_OUTCOME_TRY_FF(av_image_copy_to_buffer(
+            dst.data(), static_cast<int>(dst.size()), src_data, src_linesize,
+            par.format(), par.width(), par.height(), opts.align()));
+        return luma_av::outcome::success();
+    }
+
+    uint8_t* dst_data[4] = {};
+    int dst_linesize[4] = {};
+    LUMA_AV_OUTCOME_TRY_FF(av_image_fill_arrays(dst_data, dst_linesize, dst.data(), 
+                                                par.format(), par.width(), par.height(), opts.align()));
+    struct Band {
+        int plane;
+        int first_row;
+        int num_rows;
+        int row_bytes;
+    };
+    // at most 4 planes, the pool size bounds the bands per plane
+    auto bands = std::vector<Band>{};
+    const auto nb_planes = av_pix_fmt_count_planes(par.format());
+    const auto bands_per_plane = static_cast<int>(opts.pool()->size()) + 1;
+    try {
+        bands.reserve(static_cast<std::size_t>(nb_planes * bands_per_plane));
+    } catch (...) {
+        return errc::alloc_failure;
+    }
+    for (auto plane = 0; plane < nb_planes; ++plane) {
+        LUMA_AV_OUTCOME_TRY(layout, detail::GetPlaneLayout(par, plane));
+        const auto row_bytes = av_image_get_linesize(par.format(), par.width(), plane);
+        if (row_bytes < 0) {
+            return errc{row_bytes};
+        }
+        const auto min_rows = std::max(opts.min_band_rows(), 1);
+        const auto num_bands = std::clamp(layout.height / min_rows, 1, bands_per_plane);
+        const auto rows_per_band = (layout.height + num_bands - 1) / num_bands;
+        for (auto row = 0; row < layout.height; row += rows_per_band) {
+            bands.push_back(Band{plane, row, std::min(rows_per_band, layout.height - row), row_bytes});
+        }
+    }
+    opts.pool()->ParallelFor(static_cast<int>(bands.size()), [&](int i) noexcept {
+        auto const& b = bands[static_cast<std::size_t>(i)];
+        av_image_copy_plane(dst_data[b.plane] + static_cast<std::ptrdiff_t>(b.first_row) * dst_linesize[b.plane], 
+                            dst_linesize[b.plane],
+                            src_data[b.plane] + static_cast<std::ptrdiff_t>(b.first_row) * src_linesize[b.plane],
+                            src_linesize[b.plane], b.row_bytes, b.num_rows);
+    });
+    return luma_av::outcome::success();
+}
 } // detail
 
 /**
@@ -264,8 +699,9 @@ class Frame {
 
     // https://ffmpeg.org/doxygen/trunk/group__lavu__picture.html#ga5b6ead346a70342ae8a303c16d2b3629
     result<void> alloc_buffer(FrameBufferParams const& par) noexcept {
-        detail::ApplyParams(frame_.get(), par);
+        // unref resets the frame fields so the params have to go on after
         av_frame_unref(frame_.get());
+        detail::ApplyParams(frame_.get(), par);
         LUMA_AV_OUTCOME_TRY_FF(av_frame_get_buffer(frame_.get(), default_alignment));
         return luma_av::outcome::success();
     }
@@ -297,12 +733,53 @@ class Frame {
         return std::move(frame);
     }
 
+    /**
+     wrap memory the caller already owns (shared memory, a camera ring buffer, a tensor)
+     as a refcounted frame without copying. planes and strides need one entry per plane 
+     of the pixel format, strides are in bytes and can be negative. 
+     the frame, its refs (RefTo, filter graphs, encoders that hold on to input) all share one 
+     AVBuffer, release is called exactly once when the last of them drops, possibly on 
+     another thread. the memory has to stay valid until then.
+     on error release is never called and the caller still owns the memory.
+     wrapped frames are writable while there is a single ref, set read_only if the memory 
+     mustnt be written to (MakeWritable will then copy)
+    */
+    static result<Frame> Wrap(VideoParams const& par, std::span<uint8_t* const> planes, 
+                              std::span<const int> strides, std::function<void()> release, 
+                              bool read_only = false) noexcept {
+        LUMA_AV_OUTCOME_TRY(nb_planes, detail::CheckWrapPlanes(par, planes, strides));
+        LUMA_AV_OUTCOME_TRY(frame, Frame::make());
+        auto state = new (std::nothrow) detail::WrappedFrameRelease{std::move(release)};
+        if (!state) {
+            return luma_av::outcome::failure(errc::alloc_failure);
+        }
+        // the buffer only tracks ownership. its size is informational, the planes dont have to 
+        //  be contiguous
+        const auto plane0_bytes = static_cast<int64_t>(std::abs(strides[0])) * par.height();
+        const auto flags = read_only ? AV_BUFFER_FLAG_READONLY : 0;
+        auto* buf = av_buffer_create(planes[0], static_cast<int>(std::min<int64_t>(plane0_bytes, INT_MAX)), 
+                                     &detail::WrappedFrameRelease::Free, state, flags);
+        if (!buf) {
+            delete state;
+            return luma_av::outcome::failure(errc::alloc_failure);
+        }
+        auto* f = frame.get();
+        f->buf[0] = buf;
+        for (auto i = 0; i < nb_planes; ++i) {
+            f->data[i] = planes[i];
+            f->linesize[i] = strides[i];
+        }
+        f->extended_data = f->data;
+        detail::ApplyParams(f, par);
+        return std::move(frame);
+    }
+
     // https://ffmpeg.org/doxygen/trunk/group__lavu__picture.html#ga5b6ead346a70342ae8a303c16d2b3629
     // not sure of the size type yet
-    result<std::size_t> ImageBufferSize() const noexcept {
+    result<std::size_t> ImageBufferSize(int align = default_alignment) const noexcept {
         const auto video_params = this->video_params();
         auto buff_size =  av_image_get_buffer_size(video_params.format(), 
-                                video_params.width(), video_params.height(), default_alignment);
+                                video_params.width(), video_params.height(), align);
         if (buff_size < 0) {
             return luma_av::errc{buff_size};
         }
@@ -312,15 +789,23 @@ class Frame {
     result<Buffer> CopyToImageBuffer() const noexcept {
         LUMA_AV_OUTCOME_TRY(size, ImageBufferSize());
         LUMA_AV_OUTCOME_TRY(buff, Buffer::make(size));
-        const auto video_params = this->video_params();
-        LUMA_AV_OUTCOME_TRY_FF(av_image_copy_to_buffer(
-            buff.data(), buff.ssize(), frame_->data, frame_->linesize,
-            video_params.format(), video_params.width(), video_params.height(),
-            default_alignment
-        ));
+        LUMA_AV_OUTCOME_TRY(this->CopyToImageBuffer(buff.view()));
         return std::move(buff);
     }
 
+    /**
+     copy the image into caller owned storage, no allocation (other than the band list 
+     when copying in parallel). dst needs at least ImageBufferSize(opts.align()) bytes
+    */
+    result<void> CopyToImageBuffer(std::span<uint8_t> dst, ImageCopyOpts const& opts = {}) const noexcept {
+        LUMA_AV_OUTCOME_TRY(size, ImageBufferSize(opts.align()));
+        if (dst.size() < size) {
+            return errc{AVERROR(EINVAL)};
+        }
+        return detail::CopyImageToBuffer(dst, frame_->data, frame_->linesize, 
+                                         this->video_params(), opts);
+    }
+
     /**
       av_frame_ref with memory safety checks
      */
@@ -391,6 +876,64 @@ class Frame {
         return this->video_params().format();
     }
 
+    /**
+     typed 2d view of a video plane. checks the format on every call, 
+     hold on to the view (or use VideoFrame) in hot loops
+    */
+    template <class T>
+    result<PlaneView<T>> Plane(int plane) noexcept {
+        LUMA_AV_ASSERT(holds_video_buffer(frame_.get()));
+        LUMA_AV_OUTCOME_TRY(layout, detail::GetPlaneLayout(this->video_params(), plane));
+        return detail::MakePlaneView(reinterpret_cast<T*>(frame_->data[plane]), 
+                                     frame_->linesize[plane], layout);
+    }
+    template <class T>
+    result<PlaneView<const T>> Plane(int plane) const noexcept {
+        LUMA_AV_ASSERT(holds_video_buffer(frame_.get()));
+        LUMA_AV_OUTCOME_TRY(layout, detail::GetPlaneLayout(this->video_params(), plane));
+        return detail::MakePlaneView(reinterpret_cast<const T*>(frame_->data[plane]), 
+                                     frame_->linesize[plane], layout);
+    }
+
+    /**
+     new ref to a region of the image. shares the buffers, only the plane pointers and 
+     dimensions change, so nothing is copied. x and y have to land on a chroma sample 
+     (even for yuv420p/nv12, any for rgb). like any other ref neither frame is writable 
+     while the other is alive, MakeWritable copies just the region
+    */
+    result<Frame> Crop(ImageRect const& rect) const noexcept {
+        LUMA_AV_ASSERT(holds_video_buffer(frame_.get()));
+        LUMA_AV_OUTCOME_TRY(out, Frame::make());
+        LUMA_AV_OUTCOME_TRY(detail::CropFrameImpl(out.get(), frame_.get(), rect));
+        return std::move(out);
+    }
+    result<Frame> Crop(int x, int y, int width, int height) const noexcept {
+        return this->Crop(ImageRect{x, y, width, height});
+    }
+
+    /**
+     splits the image into a nx by ny grid of zero copy crops, in row major order. 
+     edges are rounded down to the chroma alignment and the last row/column takes the 
+     remainder, so tiles can differ in size by a few pixels
+    */
+    result<std::vector<Frame>> Tiles(int nx, int ny) const noexcept {
+        LUMA_AV_ASSERT(holds_video_buffer(frame_.get()));
+        const auto par = this->video_params();
+        LUMA_AV_OUTCOME_TRY(align, detail::GetChromaAlignment(par.format()));
+        LUMA_AV_OUTCOME_TRY(xs, detail::TileEdges(par.width(), nx, align.width));
+        LUMA_AV_OUTCOME_TRY(ys, detail::TileEdges(par.height(), ny, align.height));
+        auto tiles = std::vector<Frame>{};
+        tiles.reserve(static_cast<std::size_t>(nx) * ny);
+        for (auto j = 0; j < ny; ++j) {
+            for (auto i = 0; i < nx; ++i) {
+                LUMA_AV_OUTCOME_TRY(tile, this->Crop(ImageRect{xs[i], ys[j], 
+                                                               xs[i + 1] - xs[i], ys[j + 1] - ys[j]}));
+                tiles.push_back(std::move(tile));
+            }
+        }
+        return std::move(tiles);
+    }
+
     // dont depend on specific behavior if called on an audio frame
     VideoParams video_params() const noexcept {
         return std::get<VideoParams>(detail::get_buffer_params(frame_.get()).value());
@@ -413,6 +956,501 @@ class Frame {
 
 };
 
+namespace detail {
+
+/**
+ where the planes of a frame live in its pooled buffers.
+ follows the same layout av_frame_get_buffer uses so pooled frames are 
+ interchangeable with normally allocated ones
+*/
+struct FrameBufferLayout {
+    std::array<int, 4> linesize{};
+    // video: number of planes and the offset of each plane in the single buffer
+    std::size_t nb_planes{};
+    std::array<std::size_t, 4> offset{};
+    // number of pooled buffers per frame. 1 for video and packed audio, channels for planar audio
+    int nb_buffers{};
+    std::size_t buffer_size{};
+};
+
+inline result<FrameBufferLayout> ComputeBufferLayout(VideoParams const& par, int align) noexcept {
+    if (par.width() <= 0 || par.height() <= 0) {
+        return errc{AVERROR(EINVAL)};
+    }
+    auto linesize = std::array<int, 4>{};
+    // smallest power of 2 width alignment that gives an aligned first linesize
+    for (int i = 1; i <= align; i += i) {
+        LUMA_AV_OUTCOME_TRY_FF(av_image_fill_linesizes(linesize.data(), par.format(), 
+                                                       FFALIGN(par.width(), i)));
+        if (!(linesize[0] & (align - 1))) {
+            break;
+        }
+    }
+    for (auto& l : linesize) {
+        l = FFALIGN(l, align);
+    }
+    // extra room between planes so simd code can over read. generous vs ffmpeg's STRIDE_ALIGN
+    const auto plane_padding = static_cast<std::size_t>(std::max(16 + 64, align));
+    const auto padded_height = FFALIGN(par.height(), 32);
+    auto layout = FrameBufferLayout{.linesize = linesize, .nb_buffers = 1};
+    const auto linesizes = std::array<ptrdiff_t, 4>{linesize[0], linesize[1], 
+                                                    linesize[2], linesize[3]};
+    auto sizes = std::array<std::size_t, 4>{};
+    LUMA_AV_OUTCOME_TRY_FF(av_image_fill_plane_sizes(sizes.data(), par.format(), 
+                                                     padded_height, linesizes.data()));
+    auto total = std::size_t{0};
+    for (std::size_t i = 0; i < 4 && sizes[i]; ++i) {
+        layout.offset[i] = total + i * plane_padding;
+        layout.nb_planes = i + 1;
+        total += sizes[i];
+    }
+    layout.buffer_size = total + 4 * plane_padding;
+    return layout;
+}
+
+inline result<FrameBufferLayout> ComputeBufferLayout(AudioParams const& par, int align) noexcept {
+    const auto channels = av_get_channel_layout_nb_channels(par.channel_layout());
+    if (par.nb_samples() <= 0 || channels <= 0) {
+        return errc{AVERROR(EINVAL)};
+    }
+    const auto nb_buffers = av_sample_fmt_is_planar(par.format()) ? channels : 1;
+    // past this ffmpeg needs extended_buf which we dont pool
+    if (nb_buffers > AV_NUM_DATA_POINTERS) {
+        return errc{AVERROR(EINVAL)};
+    }
+    auto layout = FrameBufferLayout{.nb_buffers = nb_buffers};
+    const auto size = av_samples_get_buffer_size(&layout.linesize[0], channels, 
+                                                 par.nb_samples(), par.format(), align);
+    LUMA_AV_OUTCOME_TRY(detail::as_result(size));
+    layout.buffer_size = static_cast<std::size_t>(layout.linesize[0]);
+    return layout;
+}
+
+inline result<FrameBufferLayout> ComputeBufferLayout(FrameBufferParams const& par, 
+                                                     int align) noexcept {
+    return std::visit([&](auto const& alt) { 
+        return detail::ComputeBufferLayout(alt, align); 
+    }, par);
+}
+
+} // detail
+
+/**
+ the samples of one audio channel. step is 1 for planar formats and the channel count for 
+ interleaved ones. doesnt own the samples, the frame has to outlive the view
+*/
+template <class T>
+class ChannelView {
+    public:
+    class Iterator {
+        public:
+        using value_type = std::remove_cv_t<T>;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() noexcept = default;
+        Iterator(T* sample, std::ptrdiff_t step) noexcept : sample_{sample}, step_{step} {}
+
+        T& operator*() const noexcept {
+            return *sample_;
+        }
+        Iterator& operator++() noexcept {
+            sample_ += step_;
+            return *this;
+        }
+        Iterator operator++(int) noexcept {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        friend bool operator==(Iterator const& lhs, Iterator const& rhs) noexcept {
+            return lhs.sample_ == rhs.sample_;
+        }
+
+        private:
+        T* sample_{};
+        std::ptrdiff_t step_{1};
+    };
+
+    constexpr ChannelView() noexcept = default;
+    constexpr ChannelView(T* data, int size, int step) noexcept 
+        : data_{data}, size_{size}, step_{step} {}
+
+    constexpr int size() const noexcept {
+        return size_;
+    }
+    // in samples
+    constexpr int step() const noexcept {
+        return step_;
+    }
+    constexpr bool contiguous() const noexcept {
+        return step_ == 1;
+    }
+    T& operator[](int i) const noexcept {
+        LUMA_AV_ASSERT(i >= 0 && i < size_);
+        return data_[static_cast<std::ptrdiff_t>(i) * step_];
+    }
+    /**
+     only for planar channels, lets loops over the samples vectorize
+    */
+    std::span<T> span() const noexcept {
+        LUMA_AV_ASSERT(this->contiguous());
+        return {data_, static_cast<std::size_t>(size_)};
+    }
+    Iterator begin() const noexcept {
+        return Iterator{data_, step_};
+    }
+    Iterator end() const noexcept {
+        return Iterator{data_ + static_cast<std::ptrdiff_t>(size_) * step_, step_};
+    }
+
+    private:
+    T* data_{};
+    int size_{};
+    int step_{1};
+};
+
+/**
+ typed view of a Frame holding a video buffer. the buffer params are checked once in make
+ and cached, after that the accessors are plain loads with no variant or writability checks.
+ doesnt own anything. the Frame has to outlive the view and its buffer must not be 
+ replaced (alloc_buffer, MakeWritable, unref, ...) while the view is in use.
+ writing through data is only safe if the frame was writable when the view was made.
+*/
+class VideoFrame {
+    public:
+    static result<VideoFrame> make(Frame& frame) noexcept {
+        auto* f = frame.get();
+        if (!f->data[0] || f->nb_samples != 0 || f->width <= 0 || f->height <= 0 
+            || f->format == AV_PIX_FMT_NONE) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto nb_planes = av_pix_fmt_count_planes(static_cast<AVPixelFormat>(f->format));
+        if (nb_planes < 0) {
+            return errc{nb_planes};
+        }
+        return VideoFrame{f, nb_planes};
+    }
+
+    int width() const noexcept {
+        return params_.width();
+    }
+    int height() const noexcept {
+        return params_.height();
+    }
+    AVPixelFormat pix_fmt() const noexcept {
+        return params_.format();
+    }
+    VideoParams const& params() const noexcept {
+        return params_;
+    }
+    int nb_planes() const noexcept {
+        return nb_planes_;
+    }
+
+    uint8_t* data(int plane) noexcept {
+        LUMA_AV_ASSERT(plane >= 0 && plane < nb_planes_);
+        return data_[plane];
+    }
+    const uint8_t* data(int plane) const noexcept {
+        LUMA_AV_ASSERT(plane >= 0 && plane < nb_planes_);
+        return data_[plane];
+    }
+    int linesize(int plane) const noexcept {
+        LUMA_AV_ASSERT(plane >= 0 && plane < nb_planes_);
+        return linesize_[plane];
+    }
+
+    template <class T>
+    result<PlaneView<T>> Plane(int plane) noexcept {
+        LUMA_AV_OUTCOME_TRY(layout, detail::GetPlaneLayout(params_, plane));
+        return detail::MakePlaneView(reinterpret_cast<T*>(data_[plane]), linesize_[plane], layout);
+    }
+    template <class T>
+    result<PlaneView<const T>> Plane(int plane) const noexcept {
+        LUMA_AV_OUTCOME_TRY(layout, detail::GetPlaneLayout(params_, plane));
+        return detail::MakePlaneView(reinterpret_cast<const T*>(data_[plane]), linesize_[plane], layout);
+    }
+
+    /**
+     first byte of row y in the plane. y is in the planes own (possibly subsampled) rows
+    */
+    uint8_t* row(int plane, int y) noexcept {
+        return this->data(plane) + static_cast<std::ptrdiff_t>(y) * linesize_[plane];
+    }
+    const uint8_t* row(int plane, int y) const noexcept {
+        return this->data(plane) + static_cast<std::ptrdiff_t>(y) * linesize_[plane];
+    }
+
+    AVFrame* get() noexcept {
+        return frame_;
+    }
+    const AVFrame* get() const noexcept {
+        return frame_;
+    }
+
+    private:
+    VideoFrame(NotNull<AVFrame*> frame, int nb_planes) noexcept 
+        : frame_{frame}, 
+          params_{.width_ = frame->width, .height_ = frame->height,
+                  .format_ = static_cast<AVPixelFormat>(frame->format)},
+          nb_planes_{nb_planes} {
+        std::copy_n(frame->data, data_.size(), data_.begin());
+        std::copy_n(frame->linesize, linesize_.size(), linesize_.begin());
+    }
+
+    AVFrame* frame_;
+    VideoParams params_;
+    int nb_planes_;
+    std::array<uint8_t*, 4> data_{};
+    std::array<int, 4> linesize_{};
+};
+
+/**
+ typed view of a Frame holding an audio buffer. same rules as VideoFrame.
+ planar formats have one plane per channel, packed formats have a single plane.
+*/
+class AudioFrame {
+    public:
+    static result<AudioFrame> make(Frame& frame) noexcept {
+        auto* f = frame.get();
+        if (!f->extended_data || !f->extended_data[0] || f->nb_samples <= 0 
+            || f->channels <= 0 || f->format == AV_SAMPLE_FMT_NONE) {
+            return errc{AVERROR(EINVAL)};
+        }
+        return AudioFrame{f};
+    }
+
+    int nb_samples() const noexcept {
+        return params_.nb_samples();
+    }
+    uint64_t channel_layout() const noexcept {
+        return params_.channel_layout();
+    }
+    AVSampleFormat sample_fmt() const noexcept {
+        return params_.format();
+    }
+    int sample_rate() const noexcept {
+        return params_.sample_rate();
+    }
+    AudioParams const& params() const noexcept {
+        return params_;
+    }
+    int channels() const noexcept {
+        return channels_;
+    }
+    bool is_planar() const noexcept {
+        return planar_;
+    }
+    int nb_planes() const noexcept {
+        return nb_planes_;
+    }
+    int bytes_per_sample() const noexcept {
+        return bytes_per_sample_;
+    }
+
+    uint8_t* data(int plane) noexcept {
+        LUMA_AV_ASSERT(plane >= 0 && plane < nb_planes_);
+        return extended_data_[plane];
+    }
+    const uint8_t* data(int plane) const noexcept {
+        LUMA_AV_ASSERT(plane >= 0 && plane < nb_planes_);
+        return extended_data_[plane];
+    }
+    /**
+     size in bytes of each plane (only linesize[0] is set for audio)
+    */
+    int linesize() const noexcept {
+        return linesize_;
+    }
+
+    /**
+     the samples of one channel, planar or interleaved. T has to be the sample type 
+     (float for flt/fltp, int16_t for s16/s16p, ...), only its size is checked
+    */
+    template <class T>
+    result<ChannelView<T>> Channel(int channel) noexcept {
+        return this->ChannelImpl<T>(*this, channel);
+    }
+    template <class T>
+    result<ChannelView<const T>> Channel(int channel) const noexcept {
+        return this->ChannelImpl<const T>(*this, channel);
+    }
+
+    AVFrame* get() noexcept {
+        return frame_;
+    }
+    const AVFrame* get() const noexcept {
+        return frame_;
+    }
+
+    private:
+    template <class T, class Self>
+    static result<ChannelView<T>> ChannelImpl(Self& self, int channel) noexcept {
+        if (sizeof(T) != static_cast<std::size_t>(self.bytes_per_sample_) || 
+            channel < 0 || channel >= self.channels_) {
+            return errc{AVERROR(EINVAL)};
+        }
+        if (self.planar_) {
+            return ChannelView<T>{reinterpret_cast<T*>(self.extended_data_[channel]), 
+                                  self.params_.nb_samples(), 1};
+        }
+        return ChannelView<T>{reinterpret_cast<T*>(self.extended_data_[0]) + channel, 
+                              self.params_.nb_samples(), self.channels_};
+    }
+
+    explicit AudioFrame(NotNull<AVFrame*> frame) noexcept 
+        : frame_{frame}, extended_data_{frame->extended_data},
+          params_{.nb_samples_ = frame->nb_samples, .channel_layout_ = frame->channel_layout,
+                  .format_ = static_cast<AVSampleFormat>(frame->format), 
+                  .sample_rate_ = frame->sample_rate},
+          channels_{frame->channels}, linesize_{frame->linesize[0]},
+          bytes_per_sample_{av_get_bytes_per_sample(params_.format())},
+          planar_{av_sample_fmt_is_planar(params_.format()) != 0},
+          nb_planes_{planar_ ? channels_ : 1} {}
+
+    AVFrame* frame_;
+    uint8_t** extended_data_;
+    AudioParams params_;
+    int channels_;
+    int linesize_;
+    int bytes_per_sample_;
+    bool planar_;
+    int nb_planes_;
+};
+
+/**
+ recycles frame buffers instead of allocating new ones for every frame.
+ there is one AVBufferPool per distinct set of buffer params. a pooled frame is a normal 
+ ref counted frame, its buffers go back to the pool when the last reference drops 
+ (from any thread, and even after the FramePool is gone).
+ the least recently used pool is dropped once more than max_pools params are in use.
+ Get is not thread safe.
+*/
+class FramePool {
+    public:
+    struct Stats {
+        // distinct buffer params currently pooled
+        std::size_t pools{};
+        // buffers allocated by the pools (idle or in use)
+        std::size_t buffers{};
+        std::size_t bytes{};
+        // most bytes the pools have had allocated at once
+        std::size_t high_water_bytes{};
+    };
+
+    static constexpr auto default_max_pools = std::size_t{8};
+
+    static result<FramePool> make(std::size_t max_pools = default_max_pools,
+                                  int align = Frame::default_alignment) noexcept {
+        LUMA_AV_ASSERT(max_pools > 0);
+        return FramePool{max_pools, align, std::make_shared<detail::BufferPoolCounters>()};
+    }
+
+    /**
+     replace the frames buffers with pooled buffers matching par
+    */
+    result<void> Get(Frame& frame, FrameBufferParams const& par) noexcept {
+        LUMA_AV_OUTCOME_TRY(entry, this->FindOrCreate(par));
+        auto* f = frame.get();
+        av_frame_unref(f);
+        detail::ApplyParams(f, par);
+        auto const& layout = entry->layout;
+        for (int i = 0; i < layout.nb_buffers; ++i) {
+            f->buf[i] = av_buffer_pool_get(entry->pool.get());
+            if (!f->buf[i]) {
+                av_frame_unref(f);
+                return errc::alloc_failure;
+            }
+        }
+        if (std::holds_alternative<VideoParams>(par)) {
+            for (std::size_t i = 0; i < layout.nb_planes; ++i) {
+                f->data[i] = f->buf[0]->data + layout.offset[i];
+                f->linesize[i] = layout.linesize[i];
+            }
+        } else {
+            for (int i = 0; i < layout.nb_buffers; ++i) {
+                f->data[i] = f->buf[i]->data;
+            }
+            f->linesize[0] = layout.linesize[0];
+        }
+        f->extended_data = f->data;
+        return luma_av::outcome::success();
+    }
+
+    /**
+     how the stages reuse their output frame: keep the frames buffers if nobody else references
+     them and they already match par, otherwise Get new ones. so an output gets overwritten by
+     the next one unless the caller took a ref to it
+    */
+    result<void> GetIfNotWritable(Frame& frame, FrameBufferParams const& par) noexcept {
+        if (frame.IsWritable() && detail::get_buffer_params(frame.get()) == par) {
+            return luma_av::outcome::success();
+        }
+        return this->Get(frame, par);
+    }
+
+    result<Frame> Get(FrameBufferParams const& par) noexcept {
+        LUMA_AV_OUTCOME_TRY(frame, Frame::make());
+        LUMA_AV_OUTCOME_TRY(this->Get(frame, par));
+        return std::move(frame);
+    }
+
+    /**
+     drop least recently used pools until at most max_bytes are allocated or no pools
+     are left. idle buffers are freed right away, buffers still in use when they are released
+    */
+    void Trim(std::size_t max_bytes = 0) noexcept {
+        while (!entries_.empty() && counters_->bytes.load() > max_bytes) {
+            entries_.erase(this->LeastRecentlyUsed());
+        }
+    }
+
+    Stats stats() const noexcept {
+        return Stats{.pools = entries_.size(),
+                     .buffers = counters_->buffers.load(),
+                     .bytes = counters_->bytes.load(),
+                     .high_water_bytes = counters_->high_water_bytes.load()};
+    }
+
+    private:
+    struct Entry {
+        FrameBufferParams params;
+        detail::FrameBufferLayout layout;
+        detail::unique_buffer_pool pool;
+        uint64_t last_used{};
+    };
+
+    FramePool(std::size_t max_pools, int align, 
+              std::shared_ptr<detail::BufferPoolCounters> counters) noexcept
+        : max_pools_{max_pools}, align_{align}, counters_{std::move(counters)} {}
+
+    std::vector<Entry>::iterator LeastRecentlyUsed() noexcept {
+        return std::ranges::min_element(entries_, {}, &Entry::last_used);
+    }
+
+    result<Entry*> FindOrCreate(FrameBufferParams const& par) noexcept {
+        use_count_ += 1;
+        auto it = std::ranges::find(entries_, par, &Entry::params);
+        if (it != entries_.end()) {
+            it->last_used = use_count_;
+            return std::addressof(*it);
+        }
+        LUMA_AV_OUTCOME_TRY(layout, detail::ComputeBufferLayout(par, align_));
+        LUMA_AV_OUTCOME_TRY(pool, detail::MakeCountedBufferPool(counters_, layout.buffer_size));
+        if (entries_.size() >= max_pools_) {
+            entries_.erase(this->LeastRecentlyUsed());
+        }
+        entries_.push_back(Entry{par, layout, std::move(pool), use_count_});
+        return std::addressof(entries_.back());
+    }
+
+    std::size_t max_pools_;
+    int align_;
+    uint64_t use_count_{};
+    std::shared_ptr<detail::BufferPoolCounters> counters_;
+    std::vector<Entry> entries_;
+};
+
 } // luma_av
 
 #endif // LUMA_AV_FRAME_HPP
\ No newline at end of file
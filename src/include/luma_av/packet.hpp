@@ -7,7 +7,16 @@ extern "C" {
 
 #include <luma_av/result.hpp>
 #include <luma_av/util.hpp>
+#include <luma_av/detail/buffer_pool.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <span>
 
 // https://ffmpeg.org/doxygen/3.2/group__lavc__packet.html
@@ -24,6 +33,138 @@ inline void packet_buffer_unref(NotNull<AVPacket*> pkt) noexcept {
 
 }
 
+/**
+ recycles packet buffers. sizes are rounded up to power of 2 size classes with one AVBufferPool
+ each, so packets of similar size share buffers. every buffer has AV_INPUT_BUFFER_PADDING_SIZE 
+ zeroed bytes after the payload, which the decoders bitstream readers rely on.
+ packets bigger than the largest class get a plain padded allocation.
+ Get is thread safe, pooled buffers go back to their pool when the last ref drops, from 
+ any thread and even after the PacketBufferPool is gone
+*/
+class PacketBufferPool {
+    public:
+    struct Stats {
+        // size classes with a pool
+        std::size_t pools{};
+        // buffers allocated by the pools (idle or in use)
+        std::size_t buffers{};
+        std::size_t bytes{};
+        // most bytes the pools have had allocated at once
+        std::size_t high_water_bytes{};
+        // Gets too large for any class
+        std::size_t unpooled{};
+    };
+
+    // 2^8 .. 2^26 (64MiB)
+    static constexpr auto min_class_log2 = 8;
+    static constexpr auto max_class_log2 = 26;
+    static constexpr auto nb_classes = std::size_t{max_class_log2 - min_class_log2 + 1};
+
+    static result<PacketBufferPool> make() noexcept {
+        return PacketBufferPool{std::make_shared<detail::BufferPoolCounters>()};
+    }
+
+    /**
+     the pool reset_buffer_copy and new_buffer use when not given one
+    */
+    static PacketBufferPool& Default() noexcept {
+        static auto pool = PacketBufferPool{std::make_shared<detail::BufferPoolCounters>()};
+        return pool;
+    }
+
+    PacketBufferPool(PacketBufferPool&& other) noexcept 
+        : counters_{std::move(other.counters_)}, 
+          unpooled_{other.unpooled_.load()} {
+        for (std::size_t i = 0; i < nb_classes; ++i) {
+            pools_[i] = other.pools_[i].exchange(nullptr);
+        }
+    }
+    PacketBufferPool& operator=(PacketBufferPool&&) = delete;
+    PacketBufferPool(PacketBufferPool const&) = delete;
+    PacketBufferPool& operator=(PacketBufferPool const&) = delete;
+
+    ~PacketBufferPool() {
+        for (auto& pool : pools_) {
+            auto* p = pool.load();
+            av_buffer_pool_uninit(&p);
+        }
+    }
+
+    /**
+     a buffer with room for size bytes plus the zeroed padding. 
+     the ref's size is the whole class, not size
+    */
+    result<AVBufferRef*> Get(int size) noexcept {
+        if (size < 0 || size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto padded = static_cast<std::size_t>(size) + AV_INPUT_BUFFER_PADDING_SIZE;
+        const auto class_log2 = std::max<int>(min_class_log2, std::bit_width(padded - 1));
+        AVBufferRef* buf = nullptr;
+        if (class_log2 > max_class_log2) {
+            unpooled_ += 1;
+            buf = av_buffer_alloc(static_cast<int>(padded));
+        } else {
+            LUMA_AV_OUTCOME_TRY(pool, this->ClassPool(class_log2));
+            buf = av_buffer_pool_get(pool);
+        }
+        if (!buf) {
+            return luma_av::outcome::failure(errc::alloc_failure);
+        }
+        std::memset(buf->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        return buf;
+    }
+
+    Stats stats() const noexcept {
+        auto nb_pools = std::ranges::count_if(pools_, [](auto const& p) { return p.load() != nullptr; });
+        return Stats{.pools = static_cast<std::size_t>(nb_pools),
+                     .buffers = counters_->buffers.load(),
+                     .bytes = counters_->bytes.load(),
+                     .high_water_bytes = counters_->high_water_bytes.load(),
+                     .unpooled = unpooled_.load()};
+    }
+
+    private:
+    explicit PacketBufferPool(std::shared_ptr<detail::BufferPoolCounters> counters) noexcept 
+        : counters_{std::move(counters)} {}
+
+    result<AVBufferPool*> ClassPool(int class_log2) noexcept {
+        auto& slot = pools_[static_cast<std::size_t>(class_log2 - min_class_log2)];
+        if (auto* pool = slot.load(std::memory_order_acquire)) {
+            return pool;
+        }
+        auto lock = std::scoped_lock{create_mut_};
+        if (auto* pool = slot.load(std::memory_order_acquire)) {
+            return pool;
+        }
+        LUMA_AV_OUTCOME_TRY(pool, detail::MakeCountedBufferPool(counters_, std::size_t{1} << class_log2));
+        slot.store(pool.get(), std::memory_order_release);
+        return pool.release();
+    }
+
+    std::shared_ptr<detail::BufferPoolCounters> counters_;
+    std::array<std::atomic<AVBufferPool*>, nb_classes> pools_{};
+    std::atomic<std::size_t> unpooled_{0};
+    std::mutex create_mut_;
+};
+
+/**
+ memory packets can point into without copying it, e.g. a MappedFileBuff.
+ owner keeps it alive, extent is all of it. AVBufferRef sizes are int so owner 
+ cant describe a multi GB mapping by itself
+*/
+struct MappedRegion {
+    AVBufferRef* owner = nullptr;
+    std::span<const uint8_t> extent;
+
+    bool contains(std::span<const uint8_t> data) const noexcept {
+        const auto less = std::less<const uint8_t*>{};
+        const auto* end = extent.data() + extent.size();
+        return !less(data.data(), extent.data()) && !less(end, data.data()) && 
+            data.size() <= static_cast<std::size_t>(end - data.data());
+    }
+};
+
 /**
  wrapper for AVPacket
  this class maintains the reference counting semantics available with AVPacket
@@ -96,6 +237,16 @@ class Packet {
         return Packet::make(in_pkt.get());
     }
 
+    /**
+    a packet pointing at data inside mapping without copying it. see reset_buffer_mapped
+    */
+    static result<Packet> WrapMapped(MappedRegion mapping, std::span<const uint8_t> data,
+                                     PacketBufferPool& pool = PacketBufferPool::Default()) noexcept {
+        LUMA_AV_OUTCOME_TRY(pkt, Packet::make());
+        LUMA_AV_OUTCOME_TRY(pkt.reset_buffer_mapped(mapping, data, pool));
+        return std::move(pkt);
+    }
+
     Packet(const Packet&) = delete;
     Packet& operator=(const Packet&) = delete;
 
@@ -150,13 +301,17 @@ class Packet {
     }
 
     /**
-    replace the current buffer with a newly allocated buffer of a specificed size
+    replace the current buffer with a buffer of a specificed size from the pool. 
+    the contents are unspecified, the padding after them is zeroed
     */
-    result<void> new_buffer(int size) noexcept {
+    result<void> new_buffer(int size, PacketBufferPool& pool = PacketBufferPool::Default()) noexcept {
+        LUMA_AV_OUTCOME_TRY(buf, pool.Get(size));
         if (this->has_buffer()) {
             detail::packet_buffer_unref(pkt_.get());
         }
-        LUMA_AV_OUTCOME_TRY_FF(av_new_packet(pkt_.get(), size));
+        pkt_->buf = buf;
+        pkt_->data = buf->data;
+        pkt_->size = size;
         return luma_av::outcome::success();
     }
 
@@ -174,26 +329,81 @@ class Packet {
         return luma_av::outcome::success();
     }
     /**
-        replace the internal buffer with a new buffer. rather than transfering ownership,
-        a new buffer is allocated and the input data is copied into the new buffer
+        replace the internal buffer contents with a copy of data (plus zeroed padding). 
+        the current buffer is reused if nobody else holds a ref and it is big enough, 
+        otherwise a new one comes from the pool
     */
-    result<void> reset_buffer_copy(std::span<const uint8_t> data) noexcept {
+    result<void> reset_buffer_copy(std::span<const uint8_t> data, 
+                                   PacketBufferPool& pool = PacketBufferPool::Default()) noexcept {
+        if (data.size() > static_cast<std::size_t>(INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)) {
+            return errc{AVERROR(EINVAL)};
+        }
         const auto buff_size = static_cast<int>(data.size());
-        auto buff = static_cast<uint8_t*>(av_malloc(buff_size));
-        LUMA_AV_ASSERT(buff);
-        std::copy(data.begin(), data.end(), buff);
-        LUMA_AV_OUTCOME_TRY(this->reset_buffer(buff, buff_size));
+        auto* buf = pkt_->buf;
+        const auto reuse = buf && av_buffer_is_writable(buf) &&
+            static_cast<std::size_t>(buf->size) >= data.size() + AV_INPUT_BUFFER_PADDING_SIZE;
+        if (reuse) {
+            // copy first in case data points into this buffer
+            std::memmove(buf->data, data.data(), data.size());
+            std::memset(buf->data + buff_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+            pkt_->data = buf->data;
+            pkt_->size = buff_size;
+            return luma_av::outcome::success();
+        }
+        LUMA_AV_OUTCOME_TRY(new_buf, pool.Get(buff_size));
+        std::ranges::copy(data, new_buf->data);
+        if (this->has_buffer()) {
+            detail::packet_buffer_unref(pkt_.get());
+        }
+        pkt_->buf = new_buf;
+        pkt_->data = new_buf->data;
+        pkt_->size = buff_size;
+        return luma_av::outcome::success();
+    }
+
+    /**
+        point the packet at data inside mapping instead of copying it. the packet holds a ref
+        to mapping.owner so the memory lives as long as the packet does.
+        decoders read a little past the end of a packet, inside the mapping that just reads 
+        the following bytes (so the padding is not zeroed), but within 
+        AV_INPUT_BUFFER_PADDING_SIZE of the end of the mapping data is copied into a 
+        padded buffer from pool instead.
+        the mapping is shared so the packet is not writable, make_writable copies it out
+    */
+    result<void> reset_buffer_mapped(MappedRegion mapping, std::span<const uint8_t> data,
+                                     PacketBufferPool& pool = PacketBufferPool::Default()) noexcept {
+        if (!mapping.owner || !mapping.contains(data) || 
+                data.size() > static_cast<std::size_t>(INT_MAX)) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto tail = static_cast<std::size_t>(mapping.extent.data() + mapping.extent.size() 
+                                                   - data.data()) - data.size();
+        if (tail < AV_INPUT_BUFFER_PADDING_SIZE) {
+            return this->reset_buffer_copy(data, pool);
+        }
+        // ref before unref in case our current buffer is the mapping
+        auto* buf = av_buffer_ref(mapping.owner);
+        if (!buf) {
+            return luma_av::outcome::failure(errc::alloc_failure);
+        }
+        if (this->has_buffer()) {
+            detail::packet_buffer_unref(pkt_.get());
+        }
+        pkt_->buf = buf;
+        pkt_->data = const_cast<uint8_t*>(data.data());
+        pkt_->size = static_cast<int>(data.size());
         return luma_av::outcome::success();
     }
 
     /**
-      if the buffer has more than one owner, 
+      if the buffer has more than one owner (or is read only), 
       create a new buffer and copy the contents of the current buffer.
       the resulting buffer is writable i.e. there is only one owner
      */
     result<void> make_writable() {
         LUMA_AV_ASSERT(this->has_buffer());
-        LUMA_AV_OUTCOME_TRY_FF(av_buffer_make_writable(&pkt_->buf));
+        // not av_buffer_make_writable, data doesnt have to be at the start of buf
+        LUMA_AV_OUTCOME_TRY_FF(av_packet_make_writable(pkt_.get()));
         return luma_av::outcome::success();
     }
 
@@ -0,0 +1,427 @@
+
+#ifndef LUMA_AV_PACKET_LOG_HPP
+#define LUMA_AV_PACKET_LOG_HPP
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <luma_av/format.hpp>
+#include <luma_av/packet.hpp>
+#include <luma_av/result.hpp>
+#include <luma_av/util.hpp>
+
+/**
+ a packet log is a capture of the exact packets coming out of a Reader/Encoder
+ so they can be replayed at full speed without a demuxer.
+
+ layout (native endian, the reader rejects logs from the other endianness):
+   file header, stream table, then one record per packet appended back to back.
+   every record starts 64 byte aligned:
+     RecordHeader | side data entries | pad to 64 | packet data | >= 64 zero bytes to 64
+ the zeros after the data are the padding decoders want, so the reader can map the file
+ and hand out packets pointing straight into it.
+ the writer only ever appends, a log cut off mid record (e.g. the capture was killed)
+ replays up to its last complete packet
+*/
+
+namespace luma_av {
+
+/**
+ what a decoder needs to know about a logged stream.
+ index in the log's stream table is the packets stream_index
+*/
+struct PacketLogStream {
+    AVMediaType type = AVMEDIA_TYPE_UNKNOWN;
+    AVCodecID codec_id = AV_CODEC_ID_NONE;
+    AVRational time_base{0, 1};
+    std::vector<uint8_t> extradata;
+};
+
+namespace detail {
+
+inline constexpr auto packet_log_align = std::size_t{64};
+static_assert(packet_log_align >= AV_INPUT_BUFFER_PADDING_SIZE);
+
+constexpr std::size_t PacketLogAlign(std::size_t n, std::size_t align = packet_log_align) noexcept {
+    return (n + align - 1) / align * align;
+}
+
+inline constexpr char packet_log_magic[8] = {'L', 'U', 'M', 'A', 'P', 'L', 'O', 'G'};
+inline constexpr auto packet_log_version = uint32_t{1};
+inline constexpr auto packet_log_byte_order = uint32_t{0x01020304};
+inline constexpr auto packet_log_record_magic = uint32_t{0x544B5050}; // "PPKT"
+
+struct PacketLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t nb_streams;
+    uint32_t reserved;
+};
+
+struct PacketLogStreamHeader {
+    int32_t type;
+    int32_t codec_id;
+    int32_t time_base_num;
+    int32_t time_base_den;
+    uint32_t extradata_size;
+    uint32_t reserved;
+};
+
+struct PacketLogRecordHeader {
+    uint32_t magic;
+    int32_t flags;
+    int64_t pts;
+    int64_t dts;
+    int64_t duration;
+    int64_t pos;
+    int32_t stream_index;
+    uint32_t size;
+    uint32_t nb_side_data;
+    // side data entries including their 8 byte padding
+    uint32_t side_data_bytes;
+    // everything up to the next record
+    uint64_t record_size;
+};
+static_assert(sizeof(PacketLogRecordHeader) == 64);
+
+struct PacketLogSideDataHeader {
+    int32_t type;
+    uint32_t size;
+};
+
+template <class T>
+requires std::is_trivially_copyable_v<T>
+T LoadPacketLog(std::span<const uint8_t> buff, std::size_t offset) noexcept {
+    LUMA_AV_ASSERT(offset + sizeof(T) <= buff.size());
+    auto out = T{};
+    std::memcpy(&out, buff.data() + offset, sizeof(T));
+    return out;
+}
+
+inline std::size_t PacketLogSideDataBytes(const AVPacket* pkt) noexcept {
+    auto bytes = std::size_t{0};
+    for (auto i = 0; i < pkt->side_data_elems; ++i) {
+        bytes += PacketLogAlign(sizeof(PacketLogSideDataHeader) +
+                                static_cast<std::size_t>(pkt->side_data[i].size), 8);
+    }
+    return bytes;
+}
+
+} // detail
+
+/**
+ appends packets to a packet log. see the top of this file for the format.
+ writes are buffered by stdio, Close (or the dtor) flushes
+*/
+class PacketLogWriter {
+    struct FileCloser {
+        void operator()(std::FILE* f) const noexcept {
+            std::fclose(f);
+        }
+    };
+    using unique_file = std::unique_ptr<std::FILE, FileCloser>;
+
+    unique_file file_;
+    std::size_t nb_streams_{};
+    std::size_t bytes_written_{};
+    std::size_t packets_written_{};
+
+    PacketLogWriter(std::FILE* file, std::size_t nb_streams) noexcept
+        : file_{file}, nb_streams_{nb_streams} {}
+
+    result<void> WriteBytes(const void* data, std::size_t size) noexcept {
+        if (size && std::fwrite(data, 1, size, file_.get()) != size) {
+            return errc{AVERROR(EIO)};
+        }
+        bytes_written_ += size;
+        return luma_av::outcome::success();
+    }
+    result<void> WriteZeros(std::size_t size) noexcept {
+        static constexpr uint8_t zeros[detail::packet_log_align] = {};
+        while (size) {
+            const auto n = std::min(size, sizeof(zeros));
+            LUMA_AV_OUTCOME_TRY(this->WriteBytes(zeros, n));
+            size -= n;
+        }
+        return luma_av::outcome::success();
+    }
+    result<void> PadTo(std::size_t align) noexcept {
+        return this->WriteZeros(detail::PacketLogAlign(bytes_written_, align) - bytes_written_);
+    }
+    template <class T>
+    result<void> WriteStruct(T const& t) noexcept {
+        return this->WriteBytes(&t, sizeof(T));
+    }
+
+    result<void> WriteHeader(std::span<const PacketLogStream> streams) noexcept {
+        auto header = detail::PacketLogHeader{};
+        std::memcpy(header.magic, detail::packet_log_magic, sizeof(header.magic));
+        header.version = detail::packet_log_version;
+        header.byte_order = detail::packet_log_byte_order;
+        header.nb_streams = static_cast<uint32_t>(streams.size());
+        LUMA_AV_OUTCOME_TRY(this->WriteStruct(header));
+        for (auto const& stream : streams) {
+            const auto stream_header = detail::PacketLogStreamHeader{
+                .type = stream.type, .codec_id = stream.codec_id,
+                .time_base_num = stream.time_base.num, .time_base_den = stream.time_base.den,
+                .extradata_size = static_cast<uint32_t>(stream.extradata.size()), .reserved = 0};
+            LUMA_AV_OUTCOME_TRY(this->WriteStruct(stream_header));
+            LUMA_AV_OUTCOME_TRY(this->WriteBytes(stream.extradata.data(), stream.extradata.size()));
+            LUMA_AV_OUTCOME_TRY(this->PadTo(8));
+        }
+        return this->PadTo(detail::packet_log_align);
+    }
+
+    public:
+    /**
+     creates (or truncates) filename and writes the stream table
+    */
+    static result<PacketLogWriter> make(cstr_view filename,
+                                        std::span<const PacketLogStream> streams = {}) noexcept {
+        auto file = std::fopen(filename.c_str(), "wb");
+        if (!file) {
+            return errc{AVERROR(errno)};
+        }
+        auto writer = PacketLogWriter{file, streams.size()};
+        LUMA_AV_OUTCOME_TRY(writer.WriteHeader(streams));
+        return std::move(writer);
+    }
+
+    /**
+     appends pkt. stream_index has to be in the stream table, unless the table is empty
+    */
+    result<void> Write(const AVPacket* pkt) noexcept {
+        LUMA_AV_ASSERT(file_);
+        if (pkt->size < 0 || pkt->stream_index < 0 ||
+                (nb_streams_ && static_cast<std::size_t>(pkt->stream_index) >= nb_streams_)) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto side_data_bytes = detail::PacketLogSideDataBytes(pkt);
+        const auto size = static_cast<std::size_t>(pkt->size);
+        const auto data_offset = detail::PacketLogAlign(sizeof(detail::PacketLogRecordHeader) + side_data_bytes);
+        const auto record_size = detail::PacketLogAlign(data_offset + size + AV_INPUT_BUFFER_PADDING_SIZE);
+        const auto header = detail::PacketLogRecordHeader{
+            .magic = detail::packet_log_record_magic, .flags = pkt->flags,
+            .pts = pkt->pts, .dts = pkt->dts, .duration = pkt->duration, .pos = pkt->pos,
+            .stream_index = pkt->stream_index, .size = static_cast<uint32_t>(size),
+            .nb_side_data = static_cast<uint32_t>(pkt->side_data_elems),
+            .side_data_bytes = static_cast<uint32_t>(side_data_bytes),
+            .record_size = record_size};
+        const auto record_start = bytes_written_;
+        LUMA_AV_OUTCOME_TRY(this->WriteStruct(header));
+        for (auto i = 0; i < pkt->side_data_elems; ++i) {
+            const auto& sd = pkt->side_data[i];
+            const auto sd_header = detail::PacketLogSideDataHeader{
+                .type = sd.type, .size = static_cast<uint32_t>(sd.size)};
+            LUMA_AV_OUTCOME_TRY(this->WriteStruct(sd_header));
+            LUMA_AV_OUTCOME_TRY(this->WriteBytes(sd.data, static_cast<std::size_t>(sd.size)));
+            LUMA_AV_OUTCOME_TRY(this->PadTo(8));
+        }
+        LUMA_AV_OUTCOME_TRY(this->PadTo(detail::packet_log_align));
+        LUMA_AV_OUTCOME_TRY(this->WriteBytes(pkt->data, size));
+        LUMA_AV_OUTCOME_TRY(this->WriteZeros(record_start + record_size - bytes_written_));
+        packets_written_ += 1;
+        return luma_av::outcome::success();
+    }
+    result<void> Write(Packet const& pkt) noexcept {
+        return this->Write(pkt.get());
+    }
+
+    result<void> Flush() noexcept {
+        LUMA_AV_ASSERT(file_);
+        if (std::fflush(file_.get()) != 0) {
+            return errc{AVERROR(EIO)};
+        }
+        return luma_av::outcome::success();
+    }
+
+    /**
+     flush and close the file. the dtor does the same but cant report errors
+    */
+    result<void> Close() noexcept {
+        LUMA_AV_ASSERT(file_);
+        if (std::fclose(file_.release()) != 0) {
+            return errc{AVERROR(EIO)};
+        }
+        return luma_av::outcome::success();
+    }
+
+    std::size_t bytes_written() const noexcept {
+        return bytes_written_;
+    }
+    std::size_t packets_written() const noexcept {
+        return packets_written_;
+    }
+};
+
+/**
+ replays a packet log. the file is mapped and packets point into the mapping,
+ so reading a packet copies nothing but its side data.
+ same interface as Reader so it works with views::read_input, e.g.
+   log | views::read_input | views::decode(dec)
+ ReadFrameInPlace returns AVERROR_EOF at the end, Rewind starts over
+*/
+class PacketLogReader {
+    MappedFileBuff buff_;
+    std::vector<PacketLogStream> streams_;
+    std::size_t first_record_{};
+    std::size_t offset_{};
+    Packet reader_packet_;
+
+    PacketLogReader(MappedFileBuff buff, std::vector<PacketLogStream> streams,
+                    std::size_t first_record, Packet pkt) noexcept
+        : buff_{std::move(buff)}, streams_{std::move(streams)},
+          first_record_{first_record}, offset_{first_record}, reader_packet_{std::move(pkt)} {}
+
+    static result<std::size_t> ParseHeader(std::span<const uint8_t> buff,
+                                           std::vector<PacketLogStream>& streams) noexcept {
+        if (buff.size() < sizeof(detail::PacketLogHeader)) {
+            return errc{AVERROR_INVALIDDATA};
+        }
+        const auto header = detail::LoadPacketLog<detail::PacketLogHeader>(buff, 0);
+        if (std::memcmp(header.magic, detail::packet_log_magic, sizeof(header.magic)) != 0 ||
+                header.version != detail::packet_log_version ||
+                header.byte_order != detail::packet_log_byte_order) {
+            return errc{AVERROR_INVALIDDATA};
+        }
+        auto offset = sizeof(detail::PacketLogHeader);
+        for (uint32_t i = 0; i < header.nb_streams; ++i) {
+            if (offset > buff.size() || buff.size() - offset < sizeof(detail::PacketLogStreamHeader)) {
+                return errc{AVERROR_INVALIDDATA};
+            }
+            const auto stream = detail::LoadPacketLog<detail::PacketLogStreamHeader>(buff, offset);
+            offset += sizeof(detail::PacketLogStreamHeader);
+            if (buff.size() - offset < stream.extradata_size) {
+                return errc{AVERROR_INVALIDDATA};
+            }
+            const auto extradata = buff.subspan(offset, stream.extradata_size);
+            streams.push_back(PacketLogStream{
+                .type = static_cast<AVMediaType>(stream.type),
+                .codec_id = static_cast<AVCodecID>(stream.codec_id),
+                .time_base = AVRational{stream.time_base_num, stream.time_base_den},
+                .extradata = {extradata.begin(), extradata.end()}});
+            offset = detail::PacketLogAlign(offset + stream.extradata_size, 8);
+        }
+        offset = detail::PacketLogAlign(offset);
+        if (offset > buff.size()) {
+            return errc{AVERROR_INVALIDDATA};
+        }
+        return offset;
+    }
+
+    result<void> ReadSideData(std::span<const uint8_t> side_data, uint32_t nb_side_data) noexcept {
+        auto offset = std::size_t{0};
+        for (uint32_t i = 0; i < nb_side_data; ++i) {
+            if (offset > side_data.size() || 
+                    side_data.size() - offset < sizeof(detail::PacketLogSideDataHeader)) {
+                return errc{AVERROR_INVALIDDATA};
+            }
+            const auto sd = detail::LoadPacketLog<detail::PacketLogSideDataHeader>(side_data, offset);
+            offset += sizeof(detail::PacketLogSideDataHeader);
+            if (side_data.size() - offset < sd.size || sd.size > INT_MAX) {
+                return errc{AVERROR_INVALIDDATA};
+            }
+            auto dst = av_packet_new_side_data(reader_packet_.get(),
+                                               static_cast<AVPacketSideDataType>(sd.type),
+                                               static_cast<int>(sd.size));
+            if (!dst) {
+                return luma_av::outcome::failure(errc::alloc_failure);
+            }
+            std::memcpy(dst, side_data.data() + offset, sd.size);
+            offset = detail::PacketLogAlign(offset + sd.size, 8);
+        }
+        return luma_av::outcome::success();
+    }
+
+    public:
+    static result<PacketLogReader> make(cstr_view filename) noexcept {
+        LUMA_AV_OUTCOME_TRY(buff, MappedFileBuff::make(filename));
+        auto streams = std::vector<PacketLogStream>{};
+        LUMA_AV_OUTCOME_TRY(first_record, ParseHeader(buff.span(), streams));
+        LUMA_AV_OUTCOME_TRY(pkt, Packet::make());
+        return PacketLogReader{std::move(buff), std::move(streams), first_record, std::move(pkt)};
+    }
+
+    std::span<const PacketLogStream> streams() const noexcept {
+        return streams_;
+    }
+
+    /**
+     reads the next packet into view_packet(). the packet refs the mapping,
+     its padding is the zeros from the log
+    */
+    result<void> ReadFrameInPlace() noexcept {
+        const auto buff = std::as_const(buff_).span();
+        const auto remaining = buff.size() - offset_;
+        if (remaining < sizeof(detail::PacketLogRecordHeader)) {
+            return errc{AVERROR_EOF};
+        }
+        const auto header = detail::LoadPacketLog<detail::PacketLogRecordHeader>(buff, offset_);
+        if (header.magic != detail::packet_log_record_magic) {
+            return errc{AVERROR_INVALIDDATA};
+        }
+        if (header.record_size > remaining) {
+            // cut off mid record
+            return errc{AVERROR_EOF};
+        }
+        const auto record = buff.subspan(offset_, header.record_size);
+        const auto side_data_offset = sizeof(detail::PacketLogRecordHeader);
+        const auto data_offset = detail::PacketLogAlign(side_data_offset + header.side_data_bytes);
+        if (header.record_size < data_offset + header.size + AV_INPUT_BUFFER_PADDING_SIZE ||
+                header.size > INT_MAX) {
+            return errc{AVERROR_INVALIDDATA};
+        }
+        av_packet_unref(reader_packet_.get());
+        LUMA_AV_OUTCOME_TRY(this->ReadSideData(record.subspan(side_data_offset, header.side_data_bytes),
+                                               header.nb_side_data));
+        if (header.size) {
+            LUMA_AV_OUTCOME_TRY(reader_packet_.reset_buffer_mapped(buff_.region(),
+                                                    record.subspan(data_offset, header.size)));
+        }
+        auto pkt = reader_packet_.get();
+        pkt->pts = header.pts;
+        pkt->dts = header.dts;
+        pkt->duration = header.duration;
+        pkt->pos = header.pos;
+        pkt->flags = header.flags;
+        pkt->stream_index = header.stream_index;
+        offset_ += header.record_size;
+        return luma_av::outcome::success();
+    }
+    result<Packet> ReadFrame() noexcept {
+        LUMA_AV_OUTCOME_TRY(ReadFrameInPlace());
+        return ref_packet();
+    }
+
+    /**
+     back to the first packet, for benchmarks that loop over the same log
+    */
+    void Rewind() noexcept {
+        offset_ = first_record_;
+    }
+
+    Packet& view_packet() noexcept {
+        return reader_packet_;
+    }
+    result<Packet> ref_packet() noexcept {
+        return Packet::make(reader_packet_);
+    }
+};
+
+} // luma_av
+
+#endif // LUMA_AV_PACKET_LOG_HPP
@@ -7,6 +7,8 @@ extern "C" {
 }
 
 
+#include <algorithm>
+#include <climits>
 #include <concepts>
 #include <functional>
 #include <optional>
@@ -57,7 +59,10 @@ std::pair<result<std::span<const uint8_t>>, std::span<const uint8_t>> ParseStep(
     const auto ret = av_parser_parse2(parser_.get(), codec_ctx_.get(), 
                                 std::addressof(data_out), 
                                 std::addressof(size_out),
-                                in_buff.data(), in_buff.size(), AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+                                in_buff.data(), 
+                                // the rest is picked up by the next call
+                                static_cast<int>(std::min<std::size_t>(in_buff.size(), INT_MAX)), 
+                                AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
     if (ret < 0) {
         return {errc{ret}, in_buff};
     } else if (!(data_out) or (size_out == 0)) {
@@ -67,19 +72,46 @@ std::pair<result<std::span<const uint8_t>>, std::span<const uint8_t>> ParseStep(
               in_buff.subspan(ret)};
     }
 }
+/**
+ the parsers output is only valid until the next call so it gets copied into out_pkt. 
+ that reuses out_pkts buffer when nobody else holds a ref to it, otherwise takes one from pool
+*/
 std::pair<result<void>, std::span<const uint8_t>> ParseStep(Packet& out_pkt, 
-                                        std::span<const uint8_t> in_buff) noexcept {
+                                        std::span<const uint8_t> in_buff,
+                                        PacketBufferPool& pool = PacketBufferPool::Default()) noexcept {
     const auto [out_buff, remaining] = this->ParseStep(in_buff);
     if(!out_buff) {
         return {out_buff.error(), remaining};
     }
-    if (auto res = out_pkt.reset_buffer_copy(out_buff.value()); 
+    if (auto res = out_pkt.reset_buffer_copy(out_buff.value(), pool); 
             !res) {
             return {res.error(), remaining};
     } else {
         return {luma_av::outcome::success(), remaining};
     }
 }
+/**
+ same but without the copy when the parser hands back data from inside mapping, i.e. 
+ in_buff is (part of) mapping and the packet didnt straddle two calls. out_pkt then refs 
+ the mapping instead, see Packet::reset_buffer_mapped. anything else is still copied
+*/
+std::pair<result<void>, std::span<const uint8_t>> ParseStep(Packet& out_pkt, 
+                                        std::span<const uint8_t> in_buff,
+                                        MappedRegion mapping,
+                                        PacketBufferPool& pool = PacketBufferPool::Default()) noexcept {
+    const auto [out_buff, remaining] = this->ParseStep(in_buff);
+    if(!out_buff) {
+        return {out_buff.error(), remaining};
+    }
+    auto res = mapping.contains(out_buff.value()) ? 
+        out_pkt.reset_buffer_mapped(mapping, out_buff.value(), pool) : 
+        out_pkt.reset_buffer_copy(out_buff.value(), pool);
+    if (!res) {
+        return {res.error(), remaining};
+    } else {
+        return {luma_av::outcome::success(), remaining};
+    }
+}
 
 };
 
@@ -87,9 +119,23 @@ std::pair<result<void>, std::span<const uint8_t>> ParseStep(Packet& out_pkt,
 class Parser {
     ParserContext parser_;
     Packet out_pkt_;
+    // set when parsing straight out of a mapping
+    detail::unique_buffer_ref mapping_owner_{};
+    std::span<const uint8_t> mapping_extent_{};
     Parser(ParserContext parser, Packet pkt)
         : parser_{std::move(parser)}, out_pkt_{std::move(pkt)} {
     }
+    result<void> SetMapping(MappedRegion mapping) noexcept {
+        if (!mapping.owner) {
+            return errc{AVERROR(EINVAL)};
+        }
+        mapping_owner_.reset(av_buffer_ref(mapping.owner));
+        if (!mapping_owner_) {
+            return luma_av::outcome::failure(errc::alloc_failure);
+        }
+        mapping_extent_ = mapping.extent;
+        return luma_av::outcome::success();
+    }
     public:
     template <class codec_id> 
     requires std::convertible_to<codec_id, cstr_view> 
@@ -107,9 +153,31 @@ class Parser {
         return Parser{std::move(parser_ctx), std::move(pkt)};
     }
 
+    /**
+     a parser for input that comes out of mapping (e.g. MappedFileBuff::region()).
+     packets are handed out without copying whenever the parser lets us, 
+     and keep the mapping alive for as long as anyone holds them
+    */
+    template <class codec_id> 
+    requires std::convertible_to<codec_id, cstr_view> 
+        || std::convertible_to<codec_id, AVCodecID>
+    static result<Parser> make(codec_id id, MappedRegion mapping) noexcept {
+        LUMA_AV_OUTCOME_TRY(parser, Parser::make(id));
+        LUMA_AV_OUTCOME_TRY(parser.SetMapping(mapping));
+        return std::move(parser);
+    }
+
+    static result<Parser> make(ParserContext parser_ctx, MappedRegion mapping) noexcept {
+        LUMA_AV_OUTCOME_TRY(parser, Parser::make(std::move(parser_ctx)));
+        LUMA_AV_OUTCOME_TRY(parser.SetMapping(mapping));
+        return std::move(parser);
+    }
+
     std::pair<result<NotNull<Packet*>>, 
         std::span<const uint8_t>> ParseStep(std::span<const uint8_t> in_buff) noexcept { 
-        const auto [res, buff] = parser_.ParseStep(out_pkt_, in_buff);
+        const auto [res, buff] = mapping_owner_ ? 
+            parser_.ParseStep(out_pkt_, in_buff, MappedRegion{mapping_owner_.get(), mapping_extent_}) :
+            parser_.ParseStep(out_pkt_, in_buff);
         if (res) {
             return {luma_av::outcome::success(std::addressof(out_pkt_)), buff};
         } else {
@@ -0,0 +1,322 @@
+
+#ifndef LUMA_AV_PROCESS_HPP
+#define LUMA_AV_PROCESS_HPP
+
+#include <concepts>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <utility>
+
+#include <luma_av/frame.hpp>
+#include <luma_av/result.hpp>
+#include <luma_av/util.hpp>
+#include <luma_av/detail/ranges_config.hpp>
+
+namespace luma_av {
+
+/**
+ a per frame stage written in c++, for the small stuff that isnt worth a filter graph
+ (pts rewriting, tagging, stats, dropping). same send/receive model as the codecs:
+  - SendFrame gives it the next input. the input can be edited in place and handed back out,
+    it stays valid until the next SendFrame
+  - ReceiveFrame gives 0..N outputs per input, then AVERROR(EAGAIN) (or errc::again) when it wants more
+  - Flush says the input ended, ReceiveFrame then gives whatever was held back
+    and AVERROR_EOF (or errc::end) after that
+ outputs point at frames the processor owns: the input itself or a workspace frame it
+ refills from a FramePool. they are valid until the next call
+*/
+template <class P>
+concept FrameProcessor = requires(P& p, Frame& frame) {
+    { p.SendFrame(frame) } -> std::same_as<result<void>>;
+    { p.ReceiveFrame() } -> std::same_as<result<NotNull<Frame*>>>;
+    { p.Flush() } -> std::same_as<result<void>>;
+};
+
+namespace detail {
+inline bool IsProcessAgain(error_code const& ec) noexcept {
+    return ec == errc::again || ec.value() == AVERROR(EAGAIN);
+}
+inline bool IsProcessEnd(error_code const& ec) noexcept {
+    return ec == errc::end || ec.value() == AVERROR_EOF;
+}
+} // detail
+
+/**
+ FrameProcessor out of f(Frame&) -> result<bool>, one output per input.
+ f edits the frame in place and returns false to drop it
+*/
+template <class F>
+class InPlaceProcessor {
+    F f_;
+    Frame* pending_ = nullptr;
+    bool flushed_ = false;
+
+    public:
+    explicit InPlaceProcessor(F f) noexcept(std::is_nothrow_move_constructible_v<F>) : f_{std::move(f)} {}
+
+    result<void> SendFrame(Frame& frame) noexcept {
+        if (pending_ || flushed_) {
+            return errc{AVERROR(EINVAL)};
+        }
+        LUMA_AV_OUTCOME_TRY(keep, f_(frame));
+        if (keep) {
+            pending_ = std::addressof(frame);
+        }
+        return luma_av::outcome::success();
+    }
+    result<NotNull<Frame*>> ReceiveFrame() noexcept {
+        if (pending_) {
+            return std::exchange(pending_, nullptr);
+        }
+        return flushed_ ? errc::end : errc::again;
+    }
+    result<void> Flush() noexcept {
+        flushed_ = true;
+        return luma_av::outcome::success();
+    }
+};
+
+namespace detail {
+
+// overloads for all of the different types of frames we support
+//  from the input range. they all have to be frames that outlive the call
+template <FrameProcessor P>
+struct SendFrameClosure {
+    P& proc_;
+    result<void> operator()(NotNull<Frame*> frame) noexcept {
+        return proc_.SendFrame(*frame);
+    }
+    result<void> operator()(Frame& frame) noexcept {
+        return proc_.SendFrame(frame);
+    }
+    result<void> operator()(result<Frame>& frame_res) noexcept {
+        LUMA_AV_OUTCOME_TRY(frame, frame_res);
+        return proc_.SendFrame(frame);
+    }
+    result<void> operator()(result<NotNull<Frame*>> const& frame_res) noexcept {
+        LUMA_AV_OUTCOME_TRY(frame, frame_res);
+        return proc_.SendFrame(*frame);
+    }
+};
+
+#ifdef LUMA_AV_ENABLE_RANGES
+
+template <std::ranges::view R, FrameProcessor P>
+class process_view_impl : public std::ranges::view_interface<process_view_impl<R, P>> {
+public:
+process_view_impl() noexcept = default;
+explicit process_view_impl(R base, P& proc, bool drain_me)
+    : base_{std::move(base)}, proc_{std::addressof(proc)}, drain_me_{drain_me} {
+
+}
+
+auto base() const noexcept -> R {
+    return base_;
+}
+auto processor() const noexcept -> P& {
+    return *proc_;
+}
+
+auto begin() {
+    return iterator<false>{*this};
+}
+
+auto end() {
+    return std::ranges::end(base_);
+}
+
+private:
+R base_{};
+P* proc_ = nullptr;
+bool drain_me_ = false;
+
+template <bool is_const>
+class iterator;
+
+};
+
+template <std::ranges::view R, FrameProcessor P>
+template <bool is_const>
+class process_view_impl<R, P>::iterator {
+    using output_type = result<NotNull<Frame*>>;
+    using parent_t = detail::MaybeConst_t<is_const, process_view_impl<R, P>>;
+    using base_t = detail::MaybeConst_t<is_const, R>;
+    friend iterator<not is_const>;
+
+    parent_t* parent_ = nullptr;
+    mutable std::ranges::iterator_t<base_t> current_{};
+    mutable bool reached_end_ = false;
+    mutable std::ptrdiff_t skip_count_{0};
+    mutable std::optional<output_type> cached_frame_;
+    // taking outputs for the last input (or the flush) until the processor runs dry
+    mutable bool polling_ = false;
+    mutable bool flushed_ = false;
+
+public:
+
+using difference_type = std::ptrdiff_t;
+using value_type = output_type;
+
+iterator() = default;
+
+explicit iterator(parent_t& parent)
+ : parent_{std::addressof(parent)},
+    current_{std::ranges::begin(parent.base_)} {
+}
+
+std::ranges::iterator_t<base_t> base() const {
+    return current_;
+}
+
+output_type operator*() const {
+    LUMA_AV_ASSERT(!reached_end_);
+    LUMA_AV_ASSERT(skip_count_ >= -1);
+    if ((skip_count_== -1) && (cached_frame_)) {
+        return *cached_frame_;
+    }
+    auto& proc = parent_->processor();
+    while (true) {
+        while (polling_) {
+            auto res = proc.ReceiveFrame();
+            if (res) {
+                if (skip_count_ > 0) {
+                    skip_count_ -= 1;
+                    continue;
+                }
+            } else if (IsProcessAgain(res.error()) || IsProcessEnd(res.error())) {
+                polling_ = false;
+                continue;
+            } else {
+                // the error is the output for this input, move on after it
+                polling_ = false;
+            }
+            cached_frame_ = res;
+            skip_count_ = -1;
+            return res;
+        }
+        if (current_ != std::ranges::end(parent_->base_)) {
+            auto res = SendFrameClosure<P>{proc}(*current_);
+            ++current_;
+            if (!res) {
+                auto out = output_type{res.error()};
+                cached_frame_ = out;
+                skip_count_ = -1;
+                return out;
+            }
+        } else if (parent_->drain_me_ && !flushed_) {
+            flushed_ = true;
+            LUMA_AV_OUTCOME_TRY(proc.Flush());
+        } else {
+            reached_end_ = true;
+            return errc::detail_process_range_end;
+        }
+        polling_ = true;
+    }
+}
+
+iterator& operator++() {
+    skip_count_ += 1;
+    return *this;
+}
+
+void operator++(int) {
+    ++*this;
+}
+
+iterator operator++(int)
+requires std::ranges::forward_range<base_t> {
+    auto temp = *this;
+    ++*this;
+    return temp;
+}
+
+bool operator==(std::ranges::sentinel_t<base_t> const& other) const {
+    return reached_end_;
+}
+
+bool operator==(iterator const& other) const
+requires std::equality_comparable<std::ranges::iterator_t<base_t>> {
+    auto proc_or_null = [](auto parent) -> P* {
+        if (parent) {
+            return parent->proc_;
+        } else {
+            return nullptr;
+        }
+    };
+    return proc_or_null(parent_) == proc_or_null(other.parent_) &&
+        current_ == other.current_ &&
+        reached_end_ == other.reached_end_ &&
+        skip_count_ == other.skip_count_ &&
+        polling_ == other.polling_ &&
+        cached_frame_.has_value() == other.cached_frame_.has_value();
+}
+
+};
+
+inline const auto process_range_end_view = std::views::filter([](const auto& res){
+    if (res) {
+        return true;
+    } else if (res.error() == errc::detail_process_range_end) {
+        return false;
+    } else {
+        return true;
+    }
+});
+
+template <FrameProcessor P>
+class process_view_impl_range_adaptor_closure {
+    P* proc_;
+    bool drain_me_;
+    public:
+    process_view_impl_range_adaptor_closure(P& proc, bool drain_me)
+        : proc_{std::addressof(proc)}, drain_me_{drain_me} {
+
+    }
+    template <std::ranges::viewable_range R>
+    auto operator()(R&& r) const {
+        return process_view_impl<std::views::all_t<R>, P>{
+            std::views::all(std::forward<R>(r)), *proc_, drain_me_} | process_range_end_view;
+    }
+};
+
+template <FrameProcessor P, std::ranges::viewable_range R>
+decltype(auto) operator|(R&& r, process_view_impl_range_adaptor_closure<P> const& closure) {
+    return closure(std::forward<R>(r));
+}
+
+template <bool drain_me>
+class process_view_impl_fn {
+public:
+template <class R, FrameProcessor P>
+auto operator()(R&& r, P& proc) const {
+    return process_view_impl_range_adaptor_closure<P>{proc, drain_me}(std::forward<R>(r));
+}
+template <FrameProcessor P>
+auto operator()(P& proc) const {
+    return process_view_impl_range_adaptor_closure<P>{proc, drain_me};
+}
+};
+
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // detail
+
+#ifdef LUMA_AV_ENABLE_RANGES
+/**
+ frames | views::process(proc) yields result<NotNull<Frame*>> for every output of a FrameProcessor,
+ errors included. the _drain variant flushes the processor once the input ends
+ and yields what it still held
+*/
+inline const auto process_view = detail::process_view_impl_fn<false>{};
+inline const auto process_drain_view = detail::process_view_impl_fn<true>{};
+
+namespace views {
+inline const auto process = process_view;
+inline const auto process_drain = process_drain_view;
+} // views
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // luma_av
+
+#endif // LUMA_AV_PROCESS_HPP
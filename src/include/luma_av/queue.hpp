@@ -0,0 +1,512 @@
+
+#ifndef LUMA_AV_QUEUE_HPP
+#define LUMA_AV_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+#include <luma_av/result.hpp>
+#include <luma_av/util.hpp>
+
+namespace luma_av {
+
+/**
+ bounded queues for handing Packets/Frames (or any nothrow movable type) between threads.
+ SpscQueue for exactly one producer and one consumer thread, MpmcQueue for any number of each.
+
+ Try* never block and return errc::again when full/empty.
+ Push/Pop block (atomic wait, so a futex on linux, no mutex) until they can make progress.
+ Close() ends the stream: pushes return errc::end from then on, pops keep returning what
+ was pushed before and errc::end once it has all been taken. a push that fails leaves its
+ argument untouched
+*/
+
+namespace detail {
+
+// not std::hardware_destructive_interference_size, its value isnt abi stable
+inline constexpr auto queue_cache_line = std::size_t{64};
+
+// high bit of the producer index, set once the queue is closed
+inline constexpr auto queue_closed_bit = std::size_t{1} << (sizeof(std::size_t) * CHAR_BIT - 1);
+
+/**
+ wakes up threads blocked on one side of a queue. the waiter count keeps Notify
+ down to a load when nobody is blocked, which is the common case in a busy pipeline
+*/
+struct alignas(queue_cache_line) QueueSignal {
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> waiters{0};
+
+    // call after publishing the change the waiters are waiting for
+    void Notify() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            this->NotifyAll();
+        }
+    }
+    void NotifyAll() noexcept {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        epoch.notify_all();
+    }
+    template <class Ready>
+    void Wait(Ready&& ready) noexcept {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (true) {
+            // load before checking so a notify in between changes it and wait returns
+            const auto e = epoch.load(std::memory_order_seq_cst);
+            if (ready()) {
+                break;
+            }
+            epoch.wait(e, std::memory_order_seq_cst);
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+template <class T>
+struct QueueSlot {
+    alignas(T) std::byte bytes[sizeof(T)];
+
+    T* ptr() noexcept {
+        return std::launder(reinterpret_cast<T*>(bytes));
+    }
+};
+
+template <class T>
+concept QueueElement = std::is_nothrow_move_constructible_v<T> &&
+    std::is_nothrow_move_assignable_v<T> && std::is_nothrow_destructible_v<T>;
+
+inline result<std::size_t> QueueCapacity(std::size_t capacity) noexcept {
+    if (capacity == 0 || capacity > (std::size_t{1} << 30)) {
+        return errc{AVERROR(EINVAL)};
+    }
+    // the mpmc cell sequence numbers need at least 2
+    return std::max(std::size_t{2}, std::bit_ceil(capacity));
+}
+
+/**
+ single producer single consumer ring. each side owns one index and keeps a cached
+ copy of the other, so in steady state a push or pop touches no shared cache line
+ but the slot and its own index. batches publish with a single index update
+*/
+template <QueueElement T>
+class SpscRing {
+    alignas(queue_cache_line) std::atomic<std::size_t> head_{0};
+    std::size_t cached_tail_{0};
+    alignas(queue_cache_line) std::atomic<std::size_t> tail_{0};
+    std::size_t cached_head_{0};
+    alignas(queue_cache_line) std::size_t mask_;
+    std::unique_ptr<QueueSlot<T>[]> slots_;
+
+    T* slot(std::size_t i) noexcept {
+        return slots_[i & mask_].ptr();
+    }
+
+    public:
+    QueueSignal not_empty;
+    QueueSignal not_full;
+
+    SpscRing(std::size_t capacity, std::unique_ptr<QueueSlot<T>[]> slots) noexcept
+        : mask_{capacity - 1}, slots_{std::move(slots)} {}
+    SpscRing(SpscRing const&) = delete;
+    SpscRing& operator=(SpscRing const&) = delete;
+    ~SpscRing() {
+        const auto tail = tail_.load() & ~queue_closed_bit;
+        for (auto i = head_.load(); i != tail; ++i) {
+            slot(i)->~T();
+        }
+    }
+
+    std::size_t capacity() const noexcept {
+        return mask_ + 1;
+    }
+    std::size_t size() const noexcept {
+        const auto head = head_.load(std::memory_order_acquire);
+        return (tail_.load(std::memory_order_acquire) & ~queue_closed_bit) - head;
+    }
+    bool closed() const noexcept {
+        return tail_.load(std::memory_order_acquire) & queue_closed_bit;
+    }
+    bool readable() const noexcept {
+        return this->size() > 0;
+    }
+    bool writable() const noexcept {
+        return this->size() < this->capacity();
+    }
+
+    void Close() noexcept {
+        tail_.fetch_or(queue_closed_bit, std::memory_order_acq_rel);
+    }
+
+    // producer thread only
+    result<std::size_t> TryPush(std::span<T> items) noexcept {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail & queue_closed_bit) {
+            return errc::end;
+        }
+        if (this->capacity() - (tail - cached_head_) < items.size()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+        const auto n = std::min(items.size(), this->capacity() - (tail - cached_head_));
+        if (n == 0) {
+            return errc::again;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            ::new (static_cast<void*>(slot(tail + i))) T(std::move(items[i]));
+        }
+        // a cas instead of a store in case Close set the bit in the meantime
+        if (!tail_.compare_exchange_strong(tail, tail + n, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+            for (std::size_t i = 0; i < n; ++i) {
+                items[i] = std::move(*slot(tail + i));
+                slot(tail + i)->~T();
+            }
+            return errc::end;
+        }
+        not_empty.Notify();
+        return n;
+    }
+
+    // consumer thread only. take is called with each T&&
+    template <class F>
+    result<std::size_t> TryPop(F&& take, std::size_t max) noexcept {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (cached_tail_ - head < max) {
+            const auto tail = tail_.load(std::memory_order_acquire);
+            cached_tail_ = tail & ~queue_closed_bit;
+            if (cached_tail_ == head) {
+                return (tail & queue_closed_bit) ? errc::end : errc::again;
+            }
+        }
+        const auto n = std::min(max, cached_tail_ - head);
+        for (std::size_t i = 0; i < n; ++i) {
+            take(std::move(*slot(head + i)));
+            slot(head + i)->~T();
+        }
+        head_.store(head + n, std::memory_order_release);
+        not_full.Notify();
+        return n;
+    }
+};
+
+/**
+ multi producer multi consumer ring (Vyukov's bounded queue). every cell carries a sequence
+ number saying whose turn it is, producers and consumers claim cells by cas on their index.
+ closing sets the high bit of the producer index, which makes every later claim fail,
+ so the consumers know exactly how many items are still to come
+*/
+template <QueueElement T>
+class MpmcRing {
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        QueueSlot<T> slot;
+    };
+    alignas(queue_cache_line) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(queue_cache_line) std::atomic<std::size_t> dequeue_pos_{0};
+    alignas(queue_cache_line) std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    static std::ptrdiff_t Diff(std::size_t a, std::size_t b) noexcept {
+        return static_cast<std::ptrdiff_t>(a - b);
+    }
+
+    result<void> TryPushOne(T& item) noexcept {
+        auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            if (pos & queue_closed_bit) {
+                return errc::end;
+            }
+            auto& cell = cells_[pos & mask_];
+            const auto diff = Diff(cell.seq.load(std::memory_order_acquire), pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ::new (static_cast<void*>(cell.slot.ptr())) T(std::move(item));
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return luma_av::outcome::success();
+                }
+            } else if (diff < 0) {
+                return errc::again;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template <class F>
+    result<void> TryPopOne(F& take) noexcept {
+        auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            auto& cell = cells_[pos & mask_];
+            const auto diff = Diff(cell.seq.load(std::memory_order_acquire), pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    take(std::move(*cell.slot.ptr()));
+                    cell.slot.ptr()->~T();
+                    cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return luma_av::outcome::success();
+                }
+            } else if (diff < 0) {
+                // empty, unless a producer claimed the cell and hasnt finished writing it
+                const auto enqueue_pos = enqueue_pos_.load(std::memory_order_acquire);
+                if ((enqueue_pos & queue_closed_bit) && (enqueue_pos & ~queue_closed_bit) == pos) {
+                    return errc::end;
+                }
+                return errc::again;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    public:
+    QueueSignal not_empty;
+    QueueSignal not_full;
+
+    MpmcRing(std::size_t capacity, std::unique_ptr<Cell[]> cells) noexcept
+        : mask_{capacity - 1}, cells_{std::move(cells)} {
+        for (std::size_t i = 0; i < capacity; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpmcRing(MpmcRing const&) = delete;
+    MpmcRing& operator=(MpmcRing const&) = delete;
+    ~MpmcRing() {
+        const auto end = enqueue_pos_.load() & ~queue_closed_bit;
+        for (auto pos = dequeue_pos_.load(); pos != end; ++pos) {
+            cells_[pos & mask_].slot.ptr()->~T();
+        }
+    }
+
+    static std::unique_ptr<Cell[]> AllocCells(std::size_t capacity) noexcept {
+        return std::unique_ptr<Cell[]>{new (std::nothrow) Cell[capacity]};
+    }
+
+    std::size_t capacity() const noexcept {
+        return mask_ + 1;
+    }
+    std::size_t size() const noexcept {
+        const auto dequeue_pos = dequeue_pos_.load(std::memory_order_acquire);
+        const auto enqueue_pos = enqueue_pos_.load(std::memory_order_acquire) & ~queue_closed_bit;
+        return static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(Diff(enqueue_pos, dequeue_pos),
+                                                                   0, this->capacity()));
+    }
+    bool closed() const noexcept {
+        return enqueue_pos_.load(std::memory_order_acquire) & queue_closed_bit;
+    }
+    bool readable() const noexcept {
+        const auto pos = dequeue_pos_.load(std::memory_order_acquire);
+        return Diff(cells_[pos & mask_].seq.load(std::memory_order_acquire), pos + 1) >= 0;
+    }
+    bool writable() const noexcept {
+        const auto pos = enqueue_pos_.load(std::memory_order_acquire) & ~queue_closed_bit;
+        return Diff(cells_[pos & mask_].seq.load(std::memory_order_acquire), pos) >= 0;
+    }
+
+    void Close() noexcept {
+        enqueue_pos_.fetch_or(queue_closed_bit, std::memory_order_acq_rel);
+    }
+
+    result<std::size_t> TryPush(std::span<T> items) noexcept {
+        auto n = std::size_t{0};
+        for (auto& item : items) {
+            if (auto res = this->TryPushOne(item); !res) {
+                if (n == 0) {
+                    return res.error();
+                }
+                break;
+            }
+            ++n;
+        }
+        if (n > 0) {
+            not_empty.Notify();
+        }
+        return n;
+    }
+
+    template <class F>
+    result<std::size_t> TryPop(F&& take, std::size_t max) noexcept {
+        auto n = std::size_t{0};
+        for (; n < max; ++n) {
+            if (auto res = this->TryPopOne(take); !res) {
+                if (n == 0) {
+                    return res.error();
+                }
+                break;
+            }
+        }
+        if (n > 0) {
+            not_full.Notify();
+        }
+        return n;
+    }
+};
+
+template <class T>
+result<std::unique_ptr<SpscRing<T>>> MakeRing(std::size_t capacity, SpscRing<T>*) noexcept {
+    LUMA_AV_OUTCOME_TRY(cap, QueueCapacity(capacity));
+    auto slots = std::unique_ptr<QueueSlot<T>[]>{new (std::nothrow) QueueSlot<T>[cap]};
+    auto ring = slots ? std::unique_ptr<SpscRing<T>>{new (std::nothrow) SpscRing<T>{cap, std::move(slots)}}
+                      : nullptr;
+    if (!ring) {
+        return luma_av::outcome::failure(errc::alloc_failure);
+    }
+    return std::move(ring);
+}
+
+template <class T>
+result<std::unique_ptr<MpmcRing<T>>> MakeRing(std::size_t capacity, MpmcRing<T>*) noexcept {
+    LUMA_AV_OUTCOME_TRY(cap, QueueCapacity(capacity));
+    auto cells = MpmcRing<T>::AllocCells(cap);
+    auto ring = cells ? std::unique_ptr<MpmcRing<T>>{new (std::nothrow) MpmcRing<T>{cap, std::move(cells)}}
+                      : nullptr;
+    if (!ring) {
+        return luma_av::outcome::failure(errc::alloc_failure);
+    }
+    return std::move(ring);
+}
+
+/**
+ the blocking and single item api on top of a ring. see the top of this file
+*/
+template <class T, class Ring>
+class BasicQueue {
+    std::unique_ptr<Ring> ring_;
+
+    explicit BasicQueue(std::unique_ptr<Ring> ring) noexcept : ring_{std::move(ring)} {}
+
+    public:
+    using value_type = T;
+
+    /**
+     capacity is rounded up to a power of 2
+    */
+    static result<BasicQueue> make(std::size_t capacity) noexcept {
+        LUMA_AV_OUTCOME_TRY(ring, MakeRing(capacity, static_cast<Ring*>(nullptr)));
+        return BasicQueue{std::move(ring)};
+    }
+
+    std::size_t capacity() const noexcept {
+        return ring_->capacity();
+    }
+    // approximate while other threads are pushing/popping
+    std::size_t size() const noexcept {
+        return ring_->size();
+    }
+    bool closed() const noexcept {
+        return ring_->closed();
+    }
+
+    /**
+     no more pushes. blocked pushers return errc::end, blocked poppers get the rest
+     of the items and then errc::end
+    */
+    void Close() noexcept {
+        ring_->Close();
+        ring_->not_empty.NotifyAll();
+        ring_->not_full.NotifyAll();
+    }
+
+    result<void> TryPush(T&& item) noexcept {
+        LUMA_AV_OUTCOME_TRY(ring_->TryPush(std::span<T>{std::addressof(item), 1}));
+        return luma_av::outcome::success();
+    }
+    result<void> Push(T&& item) noexcept {
+        LUMA_AV_OUTCOME_TRY(this->PushBatch(std::span<T>{std::addressof(item), 1}));
+        return luma_av::outcome::success();
+    }
+
+    /**
+     moves as many of items as fit, returns how many that was
+    */
+    result<std::size_t> TryPushBatch(std::span<T> items) noexcept {
+        return ring_->TryPush(items);
+    }
+    /**
+     blocks until all of items are pushed. returns fewer than items.size() only if
+     the queue got closed part way, errc::end if it was closed before any got in
+    */
+    result<std::size_t> PushBatch(std::span<T> items) noexcept {
+        auto pushed = std::size_t{0};
+        while (pushed < items.size()) {
+            auto res = ring_->TryPush(items.subspan(pushed));
+            if (res) {
+                pushed += res.value();
+            } else if (res.error() != errc::again) {
+                if (pushed == 0) {
+                    return res.error();
+                }
+                break;
+            } else {
+                ring_->not_full.Wait([&]{ return ring_->writable() || ring_->closed(); });
+            }
+        }
+        return pushed;
+    }
+
+    result<T> TryPop() noexcept {
+        auto out = std::optional<T>{};
+        LUMA_AV_OUTCOME_TRY(ring_->TryPop([&](T&& item) { out.emplace(std::move(item)); }, 1));
+        return std::move(*out);
+    }
+    result<T> Pop() noexcept {
+        auto out = std::optional<T>{};
+        LUMA_AV_OUTCOME_TRY(this->PopWith([&](T&& item) { out.emplace(std::move(item)); }, 1));
+        return std::move(*out);
+    }
+
+    /**
+     up to max items, written to out.
+    */
+    template <std::output_iterator<T> OutputIt>
+    result<std::size_t> TryPopBatch(OutputIt out, std::size_t max) noexcept {
+        return ring_->TryPop([&](T&& item) { *out = std::move(item); ++out; }, max);
+    }
+    /**
+     blocks until there is at least one item, then takes up to max
+    */
+    template <std::output_iterator<T> OutputIt>
+    result<std::size_t> PopBatch(OutputIt out, std::size_t max) noexcept {
+        return this->PopWith([&](T&& item) { *out = std::move(item); ++out; }, max);
+    }
+
+    private:
+    template <class F>
+    result<std::size_t> PopWith(F take, std::size_t max) noexcept {
+        while (true) {
+            auto res = ring_->TryPop(take, max);
+            if (res || res.error() != errc::again) {
+                return res;
+            }
+            ring_->not_empty.Wait([&]{ return ring_->readable() || ring_->closed(); });
+        }
+    }
+};
+
+} // detail
+
+/**
+ one producer thread, one consumer thread
+*/
+template <detail::QueueElement T>
+using SpscQueue = detail::BasicQueue<T, detail::SpscRing<T>>;
+
+/**
+ any number of producer and consumer threads
+*/
+template <detail::QueueElement T>
+using MpmcQueue = detail::BasicQueue<T, detail::MpmcRing<T>>;
+
+} // luma_av
+
+#endif // LUMA_AV_QUEUE_HPP
@@ -0,0 +1,485 @@
+
+#ifndef LUMA_AV_RESAMPLE_HPP
+#define LUMA_AV_RESAMPLE_HPP
+
+extern "C" {
+#include <libswresample/swresample.h>
+}
+
+#include <memory>
+#include <optional>
+#include <ranges>
+
+#include <luma_av/frame.hpp>
+#include <luma_av/result.hpp>
+#include <luma_av/util.hpp>
+#include <luma_av/detail/ranges_config.hpp>
+
+namespace luma_av {
+
+/**
+ what SwrSession converts to. anything left at 0/none is taken from the input frames,
+ so e.g. ResampleOpts{}.sample_rate(16000) only changes the rate
+*/
+class ResampleOpts {
+    public:
+    uint64_t channel_layout() const noexcept {
+        return channel_layout_;
+    }
+    auto& channel_layout(uint64_t layout) noexcept {
+        channel_layout_ = layout;
+        return *this;
+    }
+
+    AVSampleFormat format() const noexcept {
+        return format_;
+    }
+    auto& format(AVSampleFormat fmt) noexcept {
+        format_ = fmt;
+        return *this;
+    }
+
+    int sample_rate() const noexcept {
+        return sample_rate_;
+    }
+    auto& sample_rate(int rate) noexcept {
+        sample_rate_ = rate;
+        return *this;
+    }
+
+    /**
+     fills in whatever wasnt set from the source params. nb_samples is left at 0
+    */
+    AudioParams Resolve(AudioParams const& src) const noexcept {
+        return AudioParams{
+            .channel_layout_ = channel_layout_ ? channel_layout_ : src.channel_layout(),
+            .format_ = format_ != AV_SAMPLE_FMT_NONE ? format_ : src.format(),
+            .sample_rate_ = sample_rate_ > 0 ? sample_rate_ : src.sample_rate()};
+    }
+
+    private:
+    uint64_t channel_layout_{};
+    AVSampleFormat format_{AV_SAMPLE_FMT_NONE};
+    int sample_rate_{};
+};
+
+namespace detail {
+/**
+ everything but nb_samples, which changes frame to frame without needing a new context
+*/
+inline bool SameStreamParams(AudioParams const& lhs, AudioParams const& rhs) noexcept {
+    return lhs.channel_layout() == rhs.channel_layout() && lhs.format() == rhs.format() &&
+        lhs.sample_rate() == rhs.sample_rate();
+}
+} // detail
+
+/**
+ https://ffmpeg.org/doxygen/trunk/group__lswr.html
+*/
+class ResampleContext {
+
+    struct SwrCtxDeleter {
+        void operator()(SwrContext* ctx) const noexcept {
+            swr_free(&ctx);
+        }
+    };
+
+    using swrctx_ptr = std::unique_ptr<SwrContext, SwrCtxDeleter>;
+    swrctx_ptr swrctx_;
+    AudioParams src_params_;
+    AudioParams dst_params_;
+
+    ResampleContext(SwrContext* ctx, AudioParams const& src_params, AudioParams const& dst_params) noexcept
+        : swrctx_{ctx}, src_params_{src_params}, dst_params_{dst_params} {
+
+    }
+
+    public:
+
+    static result<ResampleContext> make(AudioParams const& src_params, AudioParams const& dst_params) noexcept {
+        if (src_params.sample_rate() <= 0 || dst_params.sample_rate() <= 0) {
+            return errc{AVERROR(EINVAL)};
+        }
+        auto* ctx = swr_alloc_set_opts(nullptr,
+                        static_cast<int64_t>(dst_params.channel_layout()), dst_params.format(), dst_params.sample_rate(),
+                        static_cast<int64_t>(src_params.channel_layout()), src_params.format(), src_params.sample_rate(),
+                        0, nullptr);
+        if (!ctx) {
+            return luma_av::outcome::failure(errc::alloc_failure);
+        }
+        auto owned = swrctx_ptr{ctx};
+        LUMA_AV_OUTCOME_TRY_FF(swr_init(owned.get()));
+        return ResampleContext{owned.release(), src_params, dst_params};
+    }
+
+    AudioParams const& src_params() const noexcept {
+        return src_params_;
+    }
+    AudioParams const& dst_params() const noexcept {
+        return dst_params_;
+    }
+
+    /**
+     upper bound on the samples the next Convert of in_samples can produce,
+     including whatever is buffered inside swr
+    */
+    result<int> OutSamples(int in_samples) noexcept {
+        const auto out = swr_get_out_samples(swrctx_.get(), in_samples);
+        LUMA_AV_OUTCOME_TRY(detail::as_result(out));
+        return out;
+    }
+
+    /**
+     returns the number of samples written per channel. in can be null to drain
+    */
+    result<int> Convert(uint8_t** out, int out_count, const uint8_t** in, int in_count) noexcept {
+        const auto written = swr_convert(swrctx_.get(), out, out_count, in, in_count);
+        LUMA_AV_OUTCOME_TRY(detail::as_result(written));
+        return written;
+    }
+
+    SwrContext* get() noexcept {
+        return swrctx_.get();
+    }
+    const SwrContext* get() const noexcept {
+        return swrctx_.get();
+    }
+};
+
+/**
+ ScaleSession for audio. converts sample format, channel layout and rate into an output
+ frame it owns. the output buffer is reused until someone else holds a ref to it, then a
+ new one comes from the pool. the context is rebuilt if the input params change
+ (anything still buffered in the old one is dropped, Flush first if that matters).
+ output pts and other props are copied from the input, they dont account for the resampler delay
+*/
+class SwrSession {
+    // buffers are rounded up to this many samples so small changes in the output
+    //  count dont need a new buffer (or pool)
+    static constexpr auto capacity_granularity = int{1024};
+
+    Frame out_frame_;
+    ResampleOpts dst_opts_;
+    std::optional<ResampleContext> ctx_;
+    FramePool pool_;
+    // samples per channel the current output buffer can hold
+    int capacity_{};
+
+    SwrSession(Frame out_frame, ResampleOpts const& dst_opts, FramePool pool) noexcept
+        : out_frame_{std::move(out_frame)}, dst_opts_{dst_opts}, pool_{std::move(pool)} {
+
+    }
+
+    result<void> PrepareOutput(int out_samples) noexcept {
+        auto const& dst = ctx_->dst_params();
+        const auto same_params = detail::holds_audio_buffer(out_frame_.get()) &&
+            detail::SameStreamParams(out_frame_.audio_params(), dst);
+        if (same_params && capacity_ >= out_samples && out_frame_.IsWritable()) {
+            return luma_av::outcome::success();
+        }
+        const auto capacity = (std::max(out_samples, 1) + capacity_granularity - 1)
+                              / capacity_granularity * capacity_granularity;
+        auto par = dst;
+        par.nb_samples(capacity);
+        LUMA_AV_OUTCOME_TRY(pool_.Get(out_frame_, par));
+        capacity_ = capacity;
+        return luma_av::outcome::success();
+    }
+
+    /**
+     runs swr into the output frame, in_frame null drains. errc::again if nothing came out
+    */
+    result<NotNull<Frame*>> ConvertImpl(AVFrame const* in_frame) noexcept {
+        const auto in_samples = in_frame ? in_frame->nb_samples : 0;
+        LUMA_AV_OUTCOME_TRY(out_samples, ctx_->OutSamples(in_samples));
+        if (out_samples <= 0) {
+            return errc::again;
+        }
+        LUMA_AV_OUTCOME_TRY(this->PrepareOutput(out_samples));
+        auto* out = out_frame_.get();
+        const auto** in = in_frame ? const_cast<const uint8_t**>(in_frame->extended_data) : nullptr;
+        LUMA_AV_OUTCOME_TRY(written, ctx_->Convert(out->extended_data, capacity_, in, in_samples));
+        if (written == 0) {
+            return errc::again;
+        }
+        if (in_frame) {
+            // copy_props adds side data and merges metadata, it never clears what the
+            //  kept buffer got from the last input
+            while (out->nb_side_data > 0) {
+                av_frame_remove_side_data(out, out->side_data[0]->type);
+            }
+            av_dict_free(&out->metadata);
+            LUMA_AV_OUTCOME_TRY_FF(av_frame_copy_props(out, in_frame));
+        }
+        out->sample_rate = ctx_->dst_params().sample_rate();
+        out->nb_samples = written;
+        return std::addressof(out_frame_);
+    }
+
+    public:
+    static result<SwrSession> make(ResampleOpts const& dst_opts) noexcept {
+        LUMA_AV_OUTCOME_TRY(frame, Frame::make());
+        LUMA_AV_OUTCOME_TRY(pool, FramePool::make(1));
+        return SwrSession{std::move(frame), dst_opts, std::move(pool)};
+    }
+
+    /**
+     errc::again when swr kept all the input (e.g. very short frames while changing rate),
+     just keep sending
+    */
+    result<NotNull<Frame*>> Resample(Frame const& src_frame) noexcept {
+        if (!detail::holds_audio_buffer(src_frame.get())) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto src_params = src_frame.audio_params();
+        if (!ctx_ || !detail::SameStreamParams(ctx_->src_params(), src_params)) {
+            ctx_.reset();
+            LUMA_AV_OUTCOME_TRY(ctx, ResampleContext::make(src_params, dst_opts_.Resolve(src_params)));
+            ctx_ = std::move(ctx);
+        }
+        return this->ConvertImpl(src_frame.get());
+    }
+
+    /**
+     the samples still buffered in swr at the end of the stream.
+     errc::end once there is nothing left
+    */
+    result<NotNull<Frame*>> Flush() noexcept {
+        if (!ctx_) {
+            return errc::end;
+        }
+        auto res = this->ConvertImpl(nullptr);
+        if (!res && res.error() == errc::again) {
+            return errc::end;
+        }
+        return res;
+    }
+};
+
+struct ResampleClosure {
+    SwrSession& swr;
+    result<NotNull<Frame*>> operator()(
+            result<NotNull<Frame*>> const& frame_res) noexcept {
+        LUMA_AV_OUTCOME_TRY(frame, frame_res);
+        return swr.Resample(*frame);
+    }
+    result<NotNull<Frame*>> operator()(Frame const& frame) noexcept {
+        return swr.Resample(frame);
+    }
+};
+
+namespace detail {
+
+#ifdef LUMA_AV_ENABLE_RANGES
+
+template <std::ranges::view R>
+class resample_view_impl : public std::ranges::view_interface<resample_view_impl<R>> {
+public:
+resample_view_impl() noexcept = default;
+explicit resample_view_impl(R base, SwrSession& swr, bool drain_me)
+    : base_{std::move(base)}, swr_{std::addressof(swr)}, drain_me_{drain_me} {
+
+}
+
+auto base() const noexcept -> R {
+    return base_;
+}
+auto swr() const noexcept -> SwrSession& {
+    return *swr_;
+}
+
+auto begin() {
+    return iterator<false>{*this};
+}
+
+auto end() {
+    return std::ranges::end(base_);
+}
+
+private:
+R base_{};
+SwrSession* swr_ = nullptr;
+bool drain_me_ = false;
+
+template <bool is_const>
+class iterator;
+
+};
+
+template <std::ranges::viewable_range R>
+resample_view_impl(R&&, SwrSession&, bool) -> resample_view_impl<std::ranges::views::all_t<R>>;
+
+
+template <std::ranges::view R>
+template <bool is_const>
+class resample_view_impl<R>::iterator {
+    using output_type = result<NotNull<Frame*>>;
+    using parent_t = detail::MaybeConst_t<is_const, resample_view_impl<R>>;
+    using base_t = detail::MaybeConst_t<is_const, R>;
+    friend iterator<not is_const>;
+
+    parent_t* parent_ = nullptr;
+    mutable std::ranges::iterator_t<base_t> current_{};
+    mutable bool reached_end_ = false;
+    mutable std::ptrdiff_t skip_count_{0};
+    mutable std::optional<output_type> cached_frame_;
+
+public:
+
+using difference_type = std::ptrdiff_t;
+using value_type = output_type;
+
+iterator() = default;
+
+explicit iterator(parent_t& parent)
+ : parent_{std::addressof(parent)},
+    current_{std::ranges::begin(parent.base_)} {
+}
+
+std::ranges::iterator_t<base_t> base() const {
+    return current_;
+}
+
+/**
+ inputs that swr swallowed whole are skipped. the drain variant then yields whatever
+ was still buffered once the input runs out
+*/
+output_type operator*() const {
+    LUMA_AV_ASSERT(!reached_end_);
+    LUMA_AV_ASSERT(skip_count_ >= -1);
+    if ((skip_count_== -1) && (cached_frame_)) {
+        return *cached_frame_;
+    }
+    auto& swr = parent_->swr();
+    for(;current_!=std::ranges::end(parent_->base_); ++current_) {
+        auto res = ResampleClosure{swr}(*current_);
+        if (!res && res.error() == errc::again) {
+            continue;
+        }
+        if (res && skip_count_ > 0) {
+            skip_count_ -= 1;
+            continue;
+        }
+        ++current_;
+        cached_frame_ = res;
+        skip_count_ = -1;
+        return res;
+    }
+    while (parent_->drain_me_) {
+        auto res = swr.Flush();
+        if (!res && res.error() == errc::end) {
+            break;
+        }
+        if (res && skip_count_ > 0) {
+            skip_count_ -= 1;
+            continue;
+        }
+        cached_frame_ = res;
+        skip_count_ = -1;
+        return res;
+    }
+    reached_end_ = true;
+    return errc::detail_resample_range_end;
+}
+
+iterator& operator++() {
+    skip_count_ += 1;
+    return *this;
+}
+
+void operator++(int) {
+    ++*this;
+}
+
+iterator operator++(int)
+requires std::ranges::forward_range<base_t> {
+    auto temp = *this;
+    ++*this;
+    return temp;
+}
+
+bool operator==(std::ranges::sentinel_t<base_t> const& other) const {
+    return reached_end_;
+}
+
+bool operator==(iterator const& other) const
+requires std::equality_comparable<std::ranges::iterator_t<base_t>> {
+    auto swr_or_null = [](auto parent) -> SwrSession* {
+        if (parent) {
+            return parent->swr_;
+        } else {
+            return nullptr;
+        }
+    };
+    return swr_or_null(parent_) == swr_or_null(other.parent_) &&
+        current_ == other.current_ &&
+        reached_end_ == other.reached_end_ &&
+        skip_count_ == other.skip_count_ &&
+        cached_frame_.has_value() == other.cached_frame_.has_value();
+}
+
+};
+
+inline const auto resample_range_end_view = std::views::filter([](const auto& res){
+    if (res) {
+        return true;
+    } else if (res.error() == errc::detail_resample_range_end) {
+        return false;
+    } else {
+        return true;
+    }
+});
+
+class resample_view_impl_range_adaptor_closure {
+    SwrSession* swr_;
+    bool drain_me_;
+    public:
+    resample_view_impl_range_adaptor_closure(SwrSession& swr, bool drain_me)
+        : swr_{std::addressof(swr)}, drain_me_{drain_me} {
+
+    }
+    template <std::ranges::viewable_range R>
+    auto operator()(R&& r) const {
+        return resample_view_impl{std::views::all(std::forward<R>(r)), *swr_, drain_me_}
+                | resample_range_end_view;
+    }
+};
+
+template <std::ranges::viewable_range R>
+decltype(auto) operator|(R&& r, resample_view_impl_range_adaptor_closure const& closure) {
+    return closure(std::forward<R>(r));
+}
+
+template <bool drain_me>
+class resample_view_impl_fn {
+public:
+template <class R>
+auto operator()(R&& r, SwrSession& swr) const {
+    return resample_view_impl_range_adaptor_closure{swr, drain_me}(std::forward<R>(r));
+}
+auto operator()(SwrSession& swr) const {
+    return resample_view_impl_range_adaptor_closure{swr, drain_me};
+}
+};
+
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // detail
+
+#ifdef LUMA_AV_ENABLE_RANGES
+/**
+ frames | views::resample(swr) yields result<NotNull<Frame*>>, the sessions output frame.
+ resample_drain also flushes swr once the input ends, use it for the last chunk of a stream
+*/
+inline const auto resample_view = detail::resample_view_impl_fn<false>{};
+inline const auto resample_drain_view = detail::resample_view_impl_fn<true>{};
+
+namespace views {
+inline const auto resample = resample_view;
+inline const auto resample_drain = resample_drain_view;
+} // views
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // luma_av
+
+#endif // LUMA_AV_RESAMPLE_HPP
@@ -37,7 +37,12 @@ enum class errc : int
   detail_filter_range_end,
   filter_not_found,
   end, // no more data will be sent
-  again // no data yet but if u send again u may get some
+  again, // no data yet but if u send again u may get some
+  // positive so they stay clear of AVERROR codes and the success value
+  detail_tensor_range_end = 2,
+  detail_resample_range_end = 3,
+  detail_rebatch_range_end = 4,
+  detail_process_range_end = 5
 };
 
 using error_code = std::error_code;
@@ -7,22 +7,130 @@ extern "C" {
 }
 
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <concepts>
 #include <functional>
 #include <optional>
+#include <ranges>
+#include <vector>
 
 #include <luma_av/frame.hpp>
 #include <luma_av/result.hpp>
+#include <luma_av/thread_pool.hpp>
 #include <luma_av/util.hpp>
 #include <luma_av/detail/ranges_config.hpp>
 
+// the frame/slice api (ffmpeg 5.0) lets a context scale just a band of the output
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+#define LUMA_AV_SWS_SLICE_API 1
+#else
+#define LUMA_AV_SWS_SLICE_API 0
+#endif
+
 
 namespace luma_av {
 
+/**
+ the scaler, one of the SWS_ algorithm flags. bicubic is what swscale picks when none is given.
+ fast_bilinear is the cheap one for previews/thumbnails, lanczos/spline for quality
+*/
+enum class ScaleAlgorithm : int {
+    fast_bilinear = SWS_FAST_BILINEAR,
+    bilinear = SWS_BILINEAR,
+    bicubic = SWS_BICUBIC,
+    experimental = SWS_X,
+    point = SWS_POINT,
+    area = SWS_AREA,
+    bicublin = SWS_BICUBLIN,
+    gauss = SWS_GAUSS,
+    sinc = SWS_SINC,
+    lanczos = SWS_LANCZOS,
+    spline = SWS_SPLINE
+};
+
+/**
+ pre/post filter for a ScaleContext, what sws_getDefaultFilter makes.
+ blur is a gaussian variance, sharpen a strength (0 is off), the chroma shifts are in pixels.
+ on the source opts it filters the input, on the destination opts the output
+*/
 class ScaleFilter {
+    public:
+    constexpr auto luma_blur() const noexcept -> float {
+        return luma_blur_;
+    }
+    constexpr auto& luma_blur(float variance) noexcept {
+        luma_blur_ = variance;
+        return *this;
+    }
+    constexpr auto chroma_blur() const noexcept -> float {
+        return chroma_blur_;
+    }
+    constexpr auto& chroma_blur(float variance) noexcept {
+        chroma_blur_ = variance;
+        return *this;
+    }
+    constexpr auto luma_sharpen() const noexcept -> float {
+        return luma_sharpen_;
+    }
+    constexpr auto& luma_sharpen(float strength) noexcept {
+        luma_sharpen_ = strength;
+        return *this;
+    }
+    constexpr auto chroma_sharpen() const noexcept -> float {
+        return chroma_sharpen_;
+    }
+    constexpr auto& chroma_sharpen(float strength) noexcept {
+        chroma_sharpen_ = strength;
+        return *this;
+    }
+    constexpr auto chroma_hshift() const noexcept -> float {
+        return chroma_hshift_;
+    }
+    constexpr auto& chroma_hshift(float pixels) noexcept {
+        chroma_hshift_ = pixels;
+        return *this;
+    }
+    constexpr auto chroma_vshift() const noexcept -> float {
+        return chroma_vshift_;
+    }
+    constexpr auto& chroma_vshift(float pixels) noexcept {
+        chroma_vshift_ = pixels;
+        return *this;
+    }
+    private:
+    float luma_blur_{};
+    float chroma_blur_{};
+    float luma_sharpen_{};
+    float chroma_sharpen_{};
+    float chroma_hshift_{};
+    float chroma_vshift_{};
+};
 
+namespace detail {
+struct SwsFilterDeleter {
+    void operator()(SwsFilter* filter) const noexcept {
+        sws_freeFilter(filter);
+    }
 };
 
+using unique_sws_filter = std::unique_ptr<SwsFilter, SwsFilterDeleter>;
+
+inline result<unique_sws_filter> MakeSwsFilter(std::optional<ScaleFilter> const& filter) noexcept {
+    if (!filter) {
+        return unique_sws_filter{};
+    }
+    auto* f = sws_getDefaultFilter(filter->luma_blur(), filter->chroma_blur(),
+                                   filter->luma_sharpen(), filter->chroma_sharpen(),
+                                   filter->chroma_hshift(), filter->chroma_vshift(), 0);
+    if (!f) {
+        return errc::alloc_failure;
+    }
+    return unique_sws_filter{f};
+}
+} // detail
+
 class ScaleOpts {
     public:
     constexpr ScaleOpts() noexcept = default;
@@ -44,11 +152,108 @@ class ScaleOpts {
     constexpr auto format() const noexcept -> AVPixelFormat {
         return format_;
     }
+
+    /**
+     the algorithm, flags and params only count on the destination opts.
+     colorspace, color range and filter are per side: the source ones describe and filter
+     the input, the destination ones the output
+    */
+    constexpr auto algorithm() const noexcept -> ScaleAlgorithm {
+        return algorithm_;
+    }
+    constexpr auto& algorithm(ScaleAlgorithm algo) noexcept {
+        algorithm_ = algo;
+        return *this;
+    }
+
+    constexpr auto flags() const noexcept -> int {
+        return flags_;
+    }
+    /**
+     extra SWS_ flags on top of the algorithm, e.g. SWS_ACCURATE_RND, SWS_FULL_CHR_H_INT,
+     SWS_FULL_CHR_H_INP, SWS_BITEXACT
+    */
+    constexpr auto& flags(int sws_flags) noexcept {
+        flags_ = sws_flags;
+        return *this;
+    }
+
+    constexpr auto params() const noexcept -> std::optional<std::array<double, 2>> {
+        return params_;
+    }
+    /**
+     tuning for the algorithm: b and c for bicubic, the exponent for gauss, taps for lanczos
+    */
+    constexpr auto& params(std::array<double, 2> p) noexcept {
+        params_ = p;
+        return *this;
+    }
+
+    constexpr auto colorspace() const noexcept -> std::optional<AVColorSpace> {
+        return colorspace_;
+    }
+    /**
+     the yuv<->rgb matrix for this side, unset is swscales default (bt601)
+    */
+    constexpr auto& colorspace(AVColorSpace space) noexcept {
+        colorspace_ = space;
+        return *this;
+    }
+
+    constexpr auto color_range() const noexcept -> std::optional<AVColorRange> {
+        return color_range_;
+    }
+    /**
+     AVCOL_RANGE_JPEG for full range, unset is limited range for yuv
+    */
+    constexpr auto& color_range(AVColorRange range) noexcept {
+        color_range_ = range;
+        return *this;
+    }
+
+    constexpr auto filter() const noexcept -> std::optional<ScaleFilter> {
+        return filter_;
+    }
+    constexpr auto& filter(ScaleFilter const& f) noexcept {
+        filter_ = f;
+        return *this;
+    }
+
+    constexpr auto threads() const noexcept -> int {
+        return threads_;
+    }
+    /**
+     max number of bands the output is split into with a pool, 0 for pool size + 1
+    */
+    constexpr auto& threads(int n) noexcept {
+        threads_ = n;
+        return *this;
+    }
+    constexpr auto pool() const noexcept -> ThreadPool* {
+        return pool_;
+    }
+    /**
+     scale horizontal bands of the output in parallel on the pool, each band with its own
+     SwsContext. the output is the same as scaling in one go.
+     needs the swscale slice api (ffmpeg 5.0), with older versions making the context fails 
+     with ENOSYS unless threads is 1. only the destination opts threads/pool count
+    */
+    constexpr auto& pool(ThreadPool& p) noexcept {
+        pool_ = std::addressof(p);
+        return *this;
+    }
     private:
     int width_{};
     int height_{};
     AVPixelFormat format_{};
+    ScaleAlgorithm algorithm_ = ScaleAlgorithm::bicubic;
+    int flags_{};
+    std::optional<std::array<double, 2>> params_;
+    std::optional<AVColorSpace> colorspace_;
+    std::optional<AVColorRange> color_range_;
     std::optional<ScaleFilter> filter_;
+    int threads_{};
+    ThreadPool* pool_ = nullptr;
 };
 
 class ScaleContext {
@@ -61,20 +266,62 @@ class ScaleContext {
 
     using swsctx_ptr = std::unique_ptr<SwsContext, SwsCtxDeleter>;
     swsctx_ptr swsctx_;
+    // bands 1..n when scaling on a pool, band 0 uses swsctx_
+    std::vector<swsctx_ptr> band_ctxs_;
     ScaleOpts dst_opts_;
     ScaleOpts src_opts_;
 
-    static result<swsctx_ptr> AllocContext(const ScaleOpts& src_opts, const ScaleOpts& dst_opts,
-                                     int flags, SwsFilter* srcFilter, SwsFilter* dstFilter,
-                                    const double* param) {
+    /**
+     applies the colorspace/range of either side on top of what the context picked
+    */
+    static void SetColorspaceDetails(SwsContext* ctx, const ScaleOpts& src_opts, 
+                                     const ScaleOpts& dst_opts) noexcept {
+        if (!src_opts.colorspace() && !src_opts.color_range() && 
+            !dst_opts.colorspace() && !dst_opts.color_range()) {
+            return;
+        }
+        int* inv_table = nullptr;
+        int* table = nullptr;
+        int src_range = 0, dst_range = 0, brightness = 0, contrast = 0, saturation = 0;
+        if (sws_getColorspaceDetails(ctx, &inv_table, &src_range, &table, &dst_range,
+                                     &brightness, &contrast, &saturation) < 0) {
+            // rgb->rgb etc, there is no matrix to set
+            return;
+        }
+        const int* src_table = inv_table;
+        const int* dst_table = table;
+        if (auto cs = src_opts.colorspace()) {
+            src_table = sws_getCoefficients(*cs);
+        }
+        if (auto cs = dst_opts.colorspace()) {
+            dst_table = sws_getCoefficients(*cs);
+        }
+        if (auto range = src_opts.color_range()) {
+            src_range = *range == AVCOL_RANGE_JPEG;
+        }
+        if (auto range = dst_opts.color_range()) {
+            dst_range = *range == AVCOL_RANGE_JPEG;
+        }
+        // this reports -1 for yuv output even though the ranges were applied,
+        //  ffmpegs own scale filter ignores it too
+        sws_setColorspaceDetails(ctx, src_table, src_range, dst_table, dst_range,
+                                 brightness, contrast, saturation);
+    }
+
+    static result<swsctx_ptr> AllocContext(const ScaleOpts& src_opts, const ScaleOpts& dst_opts) noexcept {
+        LUMA_AV_OUTCOME_TRY(src_filter, detail::MakeSwsFilter(src_opts.filter()));
+        LUMA_AV_OUTCOME_TRY(dst_filter, detail::MakeSwsFilter(dst_opts.filter()));
+        const auto params = dst_opts.params();
+        const auto flags = static_cast<int>(dst_opts.algorithm()) | dst_opts.flags();
         auto ctx = sws_getContext(src_opts.width(), src_opts.height(), src_opts.format(),
                                   dst_opts.width(), dst_opts.height(), dst_opts.format(), 
-                                  flags, srcFilter, dstFilter, param);
+                                  flags, src_filter.get(), dst_filter.get(), 
+                                  params ? params->data() : nullptr);
         if (!ctx) {
             return errc::scale_init_failure;
-        } else {
-            return swsctx_ptr{ctx};
         }
+        SetColorspaceDetails(ctx, src_opts, dst_opts);
+        return swsctx_ptr{ctx};
     }	
 
     ScaleContext(SwsContext* ctx, ScaleOpts src_opts,
@@ -84,17 +331,94 @@ class ScaleContext {
 
     }
 
+#if LUMA_AV_SWS_SLICE_API
+    result<void> MakeBands() noexcept {
+        auto* pool = dst_opts_.pool();
+        if (!pool) {
+            return luma_av::outcome::success();
+        }
+        // band starts have to be multiples of this, e.g. 2 for 420 output
+        const auto align = static_cast<int>(sws_receive_slice_alignment(swsctx_.get()));
+        const auto max_bands = (dst_opts_.height() + align - 1) / align;
+        const auto wanted = dst_opts_.threads() > 0 ? dst_opts_.threads() 
+                                                    : static_cast<int>(pool->size()) + 1;
+        const auto nb_bands = std::clamp(wanted, 1, std::max(max_bands, 1));
+        try {
+            band_ctxs_.reserve(nb_bands - 1);
+        } catch (...) {
+            return errc::alloc_failure;
+        }
+        for (auto i = 1; i < nb_bands; ++i) {
+            LUMA_AV_OUTCOME_TRY(ctx, AllocContext(src_opts_, dst_opts_));
+            band_ctxs_.push_back(std::move(ctx));
+        }
+        return luma_av::outcome::success();
+    }
+
+    result<void> ScaleBands(Frame const& input_frame, Frame& output_frame) noexcept {
+        const auto nb_bands = static_cast<int>(band_ctxs_.size()) + 1;
+        const auto align = static_cast<int>(sws_receive_slice_alignment(swsctx_.get()));
+        const auto dst_h = dst_opts_.height();
+        const auto units_per_band = ((dst_h + align - 1) / align + nb_bands - 1) / nb_bands;
+        const auto band_rows = units_per_band * align;
+        auto first_error = std::atomic<int>{0};
+        dst_opts_.pool()->ParallelFor(nb_bands, [&](int band) noexcept {
+            const auto first = band * band_rows;
+            if (first >= dst_h) {
+                return;
+            }
+            auto* ctx = band == 0 ? swsctx_.get() : band_ctxs_[band - 1].get();
+            // every band gets the whole source so its rows come out exactly like a full scale
+            auto ec = sws_frame_start(ctx, output_frame.get(), input_frame.get());
+            if (ec >= 0) {
+                ec = sws_send_slice(ctx, 0, src_opts_.height());
+            }
+            if (ec >= 0) {
+                ec = sws_receive_slice(ctx, first, std::min(band_rows, dst_h - first));
+            }
+            sws_frame_end(ctx);
+            if (ec < 0) {
+                auto expected = 0;
+                first_error.compare_exchange_strong(expected, ec);
+            }
+        });
+        LUMA_AV_OUTCOME_TRY_FF(first_error.load());
+        return luma_av::outcome::success();
+    }
+#endif  // LUMA_AV_SWS_SLICE_API
+
     public:
 
     static result<ScaleContext> make(const ScaleOpts& src_opts, const ScaleOpts& dst_opts) noexcept {
-        LUMA_AV_OUTCOME_TRY(ctx, AllocContext(src_opts, dst_opts, 0, nullptr, nullptr, nullptr));
-        return ScaleContext{ctx.release(), src_opts, dst_opts};
+        LUMA_AV_OUTCOME_TRY(ctx, AllocContext(src_opts, dst_opts));
+        auto sws = ScaleContext{ctx.release(), src_opts, dst_opts};
+#if LUMA_AV_SWS_SLICE_API
+        LUMA_AV_OUTCOME_TRY(sws.MakeBands());
+#else
+        // cant split the output without the slice api, dont pretend to
+        if (dst_opts.pool() && dst_opts.threads() != 1) {
+            return errc{AVERROR(ENOSYS)};
+        }
+#endif
+        return std::move(sws);
     };
 
+    /**
+     the number of bands Scale splits the output into, 1 unless scaling on a pool
+    */
+    int nb_bands() const noexcept {
+        return static_cast<int>(band_ctxs_.size()) + 1;
+    }
+
     result<void> Scale(Frame const& input_frame, Frame& output_frame) noexcept {
+#if LUMA_AV_SWS_SLICE_API
+        if (!band_ctxs_.empty()) {
+            return this->ScaleBands(input_frame, output_frame);
+        }
+#endif
         LUMA_AV_OUTCOME_TRY_FF(sws_scale(swsctx_.get(),
                                          input_frame.data(), input_frame.linesize(),
-                                         src_opts_.height(), src_opts_.width(),
+                                         0, src_opts_.height(),
                                          output_frame.data(), output_frame.linesize()));
         return luma_av::outcome::success();
     }
@@ -105,36 +429,78 @@ class ScaleSession {
     Frame out_frame_;
     ScaleOpts dst_opts_;
     std::optional<ScaleContext> ctx_;
-    ScaleSession(Frame out_frame, ScaleOpts dst_opts) : 
-        out_frame_{std::move(out_frame)}, dst_opts_{dst_opts} {
+    // output buffers are only replaced when downstream still holds a ref to the last one
+    FramePool pool_;
+    ScaleSession(Frame out_frame, ScaleOpts dst_opts, FramePool pool) : 
+        out_frame_{std::move(out_frame)}, dst_opts_{dst_opts}, pool_{std::move(pool)} {
 
     }
-    ScaleSession(Frame out_frame, ScaleOpts dst_opts, ScaleContext ctx) : 
+    ScaleSession(Frame out_frame, ScaleOpts dst_opts, ScaleContext ctx, FramePool pool) : 
         out_frame_{std::move(out_frame)}, dst_opts_{dst_opts},
-        ctx_{std::move(ctx)} {
+        ctx_{std::move(ctx)}, pool_{std::move(pool)} {
 
     }
+    /**
+     what the output actually holds: the dst opts, or what swscale does when they dont say.
+     rgb out is rgb. yuv out keeps the source matrix (swscale only converts it to and from rgb),
+     bt601 when coming from rgb. full range for rgb, gray and yuvj formats, limited otherwise
+    */
+    static void TagOutput(NotNull<AVFrame*> out, NotNull<AVFrame const*> src, 
+                          ScaleOpts const& dst_opts) noexcept {
+        const auto* dst_desc = av_pix_fmt_desc_get(dst_opts.format());
+        const auto* src_desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(src->format));
+        const auto dst_rgb = dst_desc && (dst_desc->flags & AV_PIX_FMT_FLAG_RGB);
+        const auto src_rgb = src_desc && (src_desc->flags & AV_PIX_FMT_FLAG_RGB);
+        if (dst_rgb) {
+            out->colorspace = AVCOL_SPC_RGB;
+        } else if (const auto cs = dst_opts.colorspace()) {
+            out->colorspace = *cs;
+        } else {
+            out->colorspace = src_rgb ? AVCOL_SPC_SMPTE170M : src->colorspace;
+        }
+        if (const auto range = dst_opts.color_range()) {
+            out->color_range = *range;
+        } else {
+            const auto fmt = dst_opts.format();
+            const auto full = dst_rgb || (dst_desc && dst_desc->nb_components <= 2) || 
+                fmt == AV_PIX_FMT_YUVJ420P || fmt == AV_PIX_FMT_YUVJ422P || fmt == AV_PIX_FMT_YUVJ444P || 
+                fmt == AV_PIX_FMT_YUVJ440P || fmt == AV_PIX_FMT_YUVJ411P;
+            out->color_range = full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+        }
+    }
+
     public:
     static result<ScaleSession> make(const ScaleOpts& src_opts, const ScaleOpts& dst_opts) noexcept {
         LUMA_AV_OUTCOME_TRY(ctx, ScaleContext::make(src_opts, dst_opts));
         LUMA_AV_OUTCOME_TRY(frame, Frame::make());
-        return ScaleSession{std::move(frame), dst_opts, std::move(ctx)};
+        LUMA_AV_OUTCOME_TRY(pool, FramePool::make(1));
+        return ScaleSession{std::move(frame), dst_opts, std::move(ctx), std::move(pool)};
     };
     static result<ScaleSession> make(const ScaleOpts& dst_opts) noexcept {
         LUMA_AV_OUTCOME_TRY(frame, Frame::make());
-        return ScaleSession{std::move(frame), dst_opts};
+        LUMA_AV_OUTCOME_TRY(pool, FramePool::make(1));
+        return ScaleSession{std::move(frame), dst_opts, std::move(pool)};
     };
 
 
     result<NotNull<Frame*>> Scale(Frame const& src_frame) {
         if (!ctx_) {
-            LUMA_AV_OUTCOME_TRY(ctx, ScaleContext::make(
-                        {src_frame.width(), 
-                        src_frame.height(),
-                        src_frame.pix_fmt()}, dst_opts_));
+            auto src_opts = ScaleOpts{src_frame.width(), src_frame.height(), src_frame.pix_fmt()};
+            // scale with the matrix and range the frame says it has
+            if (const auto cs = src_frame.get()->colorspace; cs != AVCOL_SPC_UNSPECIFIED && cs != AVCOL_SPC_RGB) {
+                src_opts.colorspace(cs);
+            }
+            if (const auto range = src_frame.get()->color_range; range != AVCOL_RANGE_UNSPECIFIED) {
+                src_opts.color_range(range);
+            }
+            LUMA_AV_OUTCOME_TRY(ctx, ScaleContext::make(src_opts, dst_opts_));
             ctx_ = std::move(ctx);
         }
+        LUMA_AV_OUTCOME_TRY(pool_.GetIfNotWritable(out_frame_, VideoParams{.width_ = dst_opts_.width(),
+                                                                           .height_ = dst_opts_.height(),
+                                                                           .format_ = dst_opts_.format()}));
         LUMA_AV_OUTCOME_TRY(ctx_->Scale(src_frame, out_frame_));
+        TagOutput(out_frame_.get(), src_frame.get(), dst_opts_);
         return std::addressof(out_frame_);
     }
 };
@@ -0,0 +1,791 @@
+
+#ifndef LUMA_AV_TENSOR_EXPORT_HPP
+#define LUMA_AV_TENSOR_EXPORT_HPP
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include <luma_av/color_convert.hpp>
+#include <luma_av/frame.hpp>
+#include <luma_av/result.hpp>
+#include <luma_av/thread_pool.hpp>
+#include <luma_av/util.hpp>
+#include <luma_av/detail/ranges_config.hpp>
+
+namespace luma_av {
+
+enum class TensorLayout {
+    nchw,
+    nhwc
+};
+
+enum class TensorDType {
+    f32,
+    // ieee half, stored as uint16_t
+    f16
+};
+
+enum class ChannelOrder {
+    rgb,
+    bgr
+};
+
+namespace detail {
+
+/**
+ round to nearest even float -> half. https://gist.github.com/rygorous/2156668
+*/
+inline uint16_t FloatToHalf(float value) noexcept {
+    constexpr auto f32_infinity = uint32_t{255} << 23;
+    constexpr auto f16_max = uint32_t{127 + 16} << 23;
+    constexpr auto denorm_magic_bits = uint32_t{((127 - 15) + (23 - 10) + 1)} << 23;
+    auto bits = uint32_t{};
+    std::memcpy(&bits, &value, sizeof(bits));
+    const auto sign = bits & 0x80000000u;
+    bits ^= sign;
+    auto out = uint32_t{};
+    if (bits >= f16_max) {
+        // inf or nan
+        out = bits > f32_infinity ? 0x7E00u : 0x7C00u;
+    } else if (bits < (uint32_t{113} << 23)) {
+        // subnormal or zero. the float add lines the 10 mantissa bits up at the bottom
+        auto denorm_magic = float{};
+        std::memcpy(&denorm_magic, &denorm_magic_bits, sizeof(denorm_magic));
+        auto f = float{};
+        std::memcpy(&f, &bits, sizeof(f));
+        f += denorm_magic;
+        std::memcpy(&bits, &f, sizeof(bits));
+        out = bits - denorm_magic_bits;
+    } else {
+        const auto mant_odd = (bits >> 13) & 1u;
+        bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFFu;
+        bits += mant_odd;
+        out = bits >> 13;
+    }
+    return static_cast<uint16_t>(out | (sign >> 16));
+}
+
+/**
+ bilinear taps along one axis, for every output coordinate
+*/
+struct SampleTaps {
+    std::vector<int32_t> i0;
+    std::vector<int32_t> i1;
+    std::vector<float> w;
+
+    /**
+     crop_start/crop_size are in full resolution pixels, shift is the planes subsampling.
+     step multiplies the indices (bytes per pixel for packed formats)
+    */
+    result<void> Build(int out_size, int crop_start, int crop_size, int plane_size,
+                       int shift, int step) noexcept {
+        try {
+            i0.resize(static_cast<std::size_t>(out_size));
+            i1.resize(static_cast<std::size_t>(out_size));
+            w.resize(static_cast<std::size_t>(out_size));
+        } catch (...) {
+            return errc::alloc_failure;
+        }
+        const auto scale = static_cast<double>(crop_size) / out_size;
+        const auto sub = static_cast<double>(1 << shift);
+        for (auto o = 0; o < out_size; ++o) {
+            // pixel centers, the same mapping swscale/opencv use for bilinear
+            const auto full = (o + 0.5) * scale + crop_start;
+            const auto s = std::max(full / sub - 0.5, 0.0);
+            const auto lo = std::min(static_cast<int>(s), plane_size - 1);
+            const auto idx = static_cast<std::size_t>(o);
+            i0[idx] = lo * step;
+            i1[idx] = std::min(lo + 1, plane_size - 1) * step;
+            w[idx] = lo == plane_size - 1 ? 0.f : static_cast<float>(s - lo);
+        }
+        return luma_av::outcome::success();
+    }
+};
+
+enum class TensorSrcKind {
+    yuv_planar,
+    yuv_interleaved,
+    packed_rgb
+};
+
+struct PackedRgbFormat {
+    int r;
+    int g;
+    int b;
+    int px_bytes;
+};
+
+inline std::optional<PackedRgbFormat> GetPackedRgbFormat(AVPixelFormat fmt) noexcept {
+    switch (fmt) {
+        case AV_PIX_FMT_RGB24:
+            return PackedRgbFormat{0, 1, 2, 3};
+        case AV_PIX_FMT_BGR24:
+            return PackedRgbFormat{2, 1, 0, 3};
+        case AV_PIX_FMT_RGBA:
+            return PackedRgbFormat{0, 1, 2, 4};
+        case AV_PIX_FMT_BGRA:
+            return PackedRgbFormat{2, 1, 0, 4};
+        default:
+            return std::nullopt;
+    }
+}
+
+[[gnu::always_inline]] inline float Bilinear(const uint8_t* row0, const uint8_t* row1,
+                                             int32_t i0, int32_t i1, float wx, float wy) noexcept {
+    const auto top = row0[i0] + (static_cast<float>(row0[i1]) - row0[i0]) * wx;
+    const auto bottom = row1[i0] + (static_cast<float>(row1[i1]) - row1[i0]) * wx;
+    return top + (bottom - top) * wy;
+}
+
+} // detail
+
+class TensorExportOpts {
+    public:
+    int width() const noexcept {
+        return width_;
+    }
+    auto& width(int w) noexcept {
+        width_ = w;
+        return *this;
+    }
+    int height() const noexcept {
+        return height_;
+    }
+    auto& height(int h) noexcept {
+        height_ = h;
+        return *this;
+    }
+
+    std::optional<ImageRect> crop() const noexcept {
+        return crop_;
+    }
+    /**
+     region of the source to export, resized to width x height. unset is the whole frame
+    */
+    auto& crop(ImageRect r) noexcept {
+        crop_ = r;
+        return *this;
+    }
+
+    TensorLayout layout() const noexcept {
+        return layout_;
+    }
+    auto& layout(TensorLayout l) noexcept {
+        layout_ = l;
+        return *this;
+    }
+
+    TensorDType dtype() const noexcept {
+        return dtype_;
+    }
+    auto& dtype(TensorDType t) noexcept {
+        dtype_ = t;
+        return *this;
+    }
+
+    ChannelOrder channel_order() const noexcept {
+        return order_;
+    }
+    auto& channel_order(ChannelOrder o) noexcept {
+        order_ = o;
+        return *this;
+    }
+
+    std::array<float, 3> const& mean() const noexcept {
+        return mean_;
+    }
+    std::array<float, 3> const& stddev() const noexcept {
+        return stddev_;
+    }
+    /**
+     per channel in the output channel order, on values scaled to [0, 1].
+     out = (value - mean) / stddev
+    */
+    auto& normalize(std::array<float, 3> const& mean, std::array<float, 3> const& stddev) noexcept {
+        mean_ = mean;
+        stddev_ = stddev;
+        return *this;
+    }
+
+    std::optional<ColorMatrix> matrix() const noexcept {
+        return matrix_;
+    }
+    auto& matrix(ColorMatrix m) noexcept {
+        matrix_ = m;
+        return *this;
+    }
+    std::optional<ColorRange> range() const noexcept {
+        return range_;
+    }
+    auto& range(ColorRange r) noexcept {
+        range_ = r;
+        return *this;
+    }
+
+    ThreadPool* pool() const noexcept {
+        return pool_;
+    }
+    auto& pool(ThreadPool& p) noexcept {
+        pool_ = std::addressof(p);
+        return *this;
+    }
+
+    private:
+    int width_{};
+    int height_{};
+    std::optional<ImageRect> crop_;
+    TensorLayout layout_ = TensorLayout::nchw;
+    TensorDType dtype_ = TensorDType::f32;
+    ChannelOrder order_ = ChannelOrder::rgb;
+    std::array<float, 3> mean_{0.f, 0.f, 0.f};
+    std::array<float, 3> stddev_{1.f, 1.f, 1.f};
+    std::optional<ColorMatrix> matrix_;
+    std::optional<ColorRange> range_;
+    ThreadPool* pool_ = nullptr;
+};
+
+/**
+ frame -> normalized float tensor in one pass over the source.
+ crop, bilinear resize, yuv -> rgb, mean/std normalization and the layout change all happen
+ per output pixel, nothing is staged in between.
+ sources: the ColorConvert yuv formats plus rgb24, bgr24, rgba, bgra.
+ the sampling tables are rebuilt (allocated) only when the source size or format changes
+*/
+class TensorExport {
+    public:
+    static bool Supports(AVPixelFormat src) noexcept {
+        return detail::GetYuvSrcFormat(src).has_value() || detail::GetPackedRgbFormat(src).has_value();
+    }
+
+    static result<TensorExport> make(TensorExportOpts const& opts) noexcept {
+        if (opts.width() <= 0 || opts.height() <= 0) {
+            return errc{AVERROR(EINVAL)};
+        }
+        for (auto s : opts.stddev()) {
+            if (s == 0.f) {
+                return errc{AVERROR(EINVAL)};
+            }
+        }
+        return TensorExport{opts};
+    }
+
+    std::size_t element_count() const noexcept {
+        return std::size_t{3} * static_cast<std::size_t>(opts_.width())
+               * static_cast<std::size_t>(opts_.height());
+    }
+
+    /**
+     bytes one exported frame takes in the destination
+    */
+    std::size_t frame_bytes() const noexcept {
+        return this->element_count() * (opts_.dtype() == TensorDType::f32 ? sizeof(float) : sizeof(uint16_t));
+    }
+
+    TensorExportOpts const& opts() const noexcept {
+        return opts_;
+    }
+
+    /**
+     export one frame to the start of dst. dst needs frame_bytes() and should be aligned for
+     the element type
+    */
+    result<void> Export(Frame const& src, std::span<uint8_t> dst) noexcept {
+        if (dst.size() < this->frame_bytes()) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto* f = src.get();
+        if (!f->data[0] || f->width <= 0 || f->height <= 0) {
+            return errc{AVERROR(EINVAL)};
+        }
+        const auto par = VideoParams{.width_ = f->width, .height_ = f->height,
+                                     .format_ = static_cast<AVPixelFormat>(f->format)};
+        if (!src_params_ || *src_params_ != par) {
+            LUMA_AV_OUTCOME_TRY(this->Configure(par));
+        }
+        const auto coeffs = this->Coeffs(f);
+        switch (kind_) {
+            case detail::TensorSrcKind::yuv_planar:
+                return this->ExportAs<detail::TensorSrcKind::yuv_planar>(f, dst, coeffs);
+            case detail::TensorSrcKind::yuv_interleaved:
+                return this->ExportAs<detail::TensorSrcKind::yuv_interleaved>(f, dst, coeffs);
+            case detail::TensorSrcKind::packed_rgb:
+                return this->ExportAs<detail::TensorSrcKind::packed_rgb>(f, dst, coeffs);
+        }
+        return errc{AVERROR(EINVAL)};
+    }
+
+    private:
+    explicit TensorExport(TensorExportOpts const& opts) noexcept : opts_{opts} {
+        for (std::size_t c = 0; c < 3; ++c) {
+            scale_[c] = 1.f / opts.stddev()[c];
+            bias_[c] = -opts.mean()[c] / opts.stddev()[c];
+        }
+    }
+
+    result<void> Configure(VideoParams const& par) noexcept {
+        src_params_.reset();
+        const auto crop = opts_.crop().value_or(ImageRect{0, 0, par.width(), par.height()});
+        if (crop.x < 0 || crop.y < 0 || crop.width <= 0 || crop.height <= 0
+            || crop.x + crop.width > par.width() || crop.y + crop.height > par.height()) {
+            return errc{AVERROR(EINVAL)};
+        }
+        if (const auto yuv = detail::GetYuvSrcFormat(par.format())) {
+            kind_ = yuv->chroma == detail::ChromaLayout::planar
+                    ? detail::TensorSrcKind::yuv_planar : detail::TensorSrcKind::yuv_interleaved;
+            yuv_ = *yuv;
+            const auto chroma_w = AV_CEIL_RSHIFT(par.width(), 1);
+            const auto chroma_h = AV_CEIL_RSHIFT(par.height(), yuv->log2_chroma_h);
+            LUMA_AV_OUTCOME_TRY(x_.Build(opts_.width(), crop.x, crop.width, par.width(), 0, 1));
+            LUMA_AV_OUTCOME_TRY(y_.Build(opts_.height(), crop.y, crop.height, par.height(), 0, 1));
+            // interleaved uv: index the u byte, v is the next one
+            const auto uv_step = kind_ == detail::TensorSrcKind::yuv_interleaved ? 2 : 1;
+            LUMA_AV_OUTCOME_TRY(cx_.Build(opts_.width(), crop.x, crop.width, chroma_w, 1, uv_step));
+            LUMA_AV_OUTCOME_TRY(cy_.Build(opts_.height(), crop.y, crop.height, chroma_h,
+                                          yuv->log2_chroma_h, 1));
+        } else if (const auto rgb = detail::GetPackedRgbFormat(par.format())) {
+            kind_ = detail::TensorSrcKind::packed_rgb;
+            rgb_ = *rgb;
+            LUMA_AV_OUTCOME_TRY(x_.Build(opts_.width(), crop.x, crop.width, par.width(), 0, rgb->px_bytes));
+            LUMA_AV_OUTCOME_TRY(y_.Build(opts_.height(), crop.y, crop.height, par.height(), 0, 1));
+        } else {
+            return errc{AVERROR(EINVAL)};
+        }
+        src_params_ = par;
+        return luma_av::outcome::success();
+    }
+
+    detail::YuvCoeffs Coeffs(const AVFrame* f) const noexcept {
+        if (kind_ == detail::TensorSrcKind::packed_rgb) {
+            return {};
+        }
+        const auto matrix = opts_.matrix().value_or(
+            f->colorspace == AVCOL_SPC_BT709 ? ColorMatrix::bt709 : ColorMatrix::bt601);
+        const auto frame_range = f->color_range == AVCOL_RANGE_JPEG
+                                 || (f->color_range == AVCOL_RANGE_UNSPECIFIED && yuv_.full_range)
+                                 ? ColorRange::full : ColorRange::limited;
+        return detail::MakeYuvCoeffs(matrix, opts_.range().value_or(frame_range));
+    }
+
+    template <detail::TensorSrcKind K>
+    result<void> ExportAs(const AVFrame* f, std::span<uint8_t> dst, detail::YuvCoeffs const& k) noexcept {
+        const auto nchw = opts_.layout() == TensorLayout::nchw;
+        const auto f16 = opts_.dtype() == TensorDType::f16;
+        if (nchw && !f16) {
+            this->RunRows<K, TensorLayout::nchw, TensorDType::f32>(f, dst, k);
+        } else if (nchw) {
+            this->RunRows<K, TensorLayout::nchw, TensorDType::f16>(f, dst, k);
+        } else if (!f16) {
+            this->RunRows<K, TensorLayout::nhwc, TensorDType::f32>(f, dst, k);
+        } else {
+            this->RunRows<K, TensorLayout::nhwc, TensorDType::f16>(f, dst, k);
+        }
+        return luma_av::outcome::success();
+    }
+
+    template <detail::TensorSrcKind K, TensorLayout L, TensorDType T>
+    void RunRows(const AVFrame* f, std::span<uint8_t> dst, detail::YuvCoeffs const& k) noexcept {
+        const auto height = opts_.height();
+        if (!opts_.pool()) {
+            this->ExportRows<K, L, T>(f, dst.data(), k, 0, height);
+            return;
+        }
+        const auto num_bands = std::clamp(height / 16, 1, static_cast<int>(opts_.pool()->size()) + 1);
+        const auto rows_per_band = (height + num_bands - 1) / num_bands;
+        opts_.pool()->ParallelFor(num_bands, [&](int band) noexcept {
+            const auto first = band * rows_per_band;
+            this->ExportRows<K, L, T>(f, dst.data(), k, first, std::min(first + rows_per_band, height));
+        });
+    }
+
+    template <detail::TensorSrcKind K, TensorLayout L, TensorDType T>
+    void ExportRows(const AVFrame* f, uint8_t* dst, detail::YuvCoeffs const& k,
+                    int first_row, int last_row) const noexcept {
+        using elem_t = std::conditional_t<T == TensorDType::f32, float, uint16_t>;
+        const auto width = opts_.width();
+        const auto plane_size = static_cast<std::ptrdiff_t>(width) * opts_.height();
+        // output channel -> r/g/b
+        const auto swap = opts_.channel_order() == ChannelOrder::bgr;
+        const auto scale = scale_;
+        const auto bias = bias_;
+        const auto store = [&](std::ptrdiff_t idx, int c, float v) noexcept {
+            const auto n = v * scale[static_cast<std::size_t>(c)] + bias[static_cast<std::size_t>(c)];
+            const auto pos = L == TensorLayout::nchw ? c * plane_size + idx : idx * 3 + c;
+            auto* out = dst + pos * static_cast<std::ptrdiff_t>(sizeof(elem_t));
+            if constexpr (T == TensorDType::f32) {
+                std::memcpy(out, &n, sizeof(n));
+            } else {
+                const auto h = detail::FloatToHalf(n);
+                std::memcpy(out, &h, sizeof(h));
+            }
+        };
+        for (auto oy = first_row; oy < last_row; ++oy) {
+            const auto row = static_cast<std::size_t>(oy);
+            const auto* y0 = f->data[0] + static_cast<std::ptrdiff_t>(y_.i0[row]) * f->linesize[0];
+            const auto* y1 = f->data[0] + static_cast<std::ptrdiff_t>(y_.i1[row]) * f->linesize[0];
+            const auto wy = y_.w[row];
+            const uint8_t* u0 = nullptr;
+            const uint8_t* u1 = nullptr;
+            const uint8_t* v0 = nullptr;
+            const uint8_t* v1 = nullptr;
+            auto cwy = 0.f;
+            if constexpr (K != detail::TensorSrcKind::packed_rgb) {
+                u0 = f->data[1] + static_cast<std::ptrdiff_t>(cy_.i0[row]) * f->linesize[1];
+                u1 = f->data[1] + static_cast<std::ptrdiff_t>(cy_.i1[row]) * f->linesize[1];
+                if constexpr (K == detail::TensorSrcKind::yuv_planar) {
+                    v0 = f->data[2] + static_cast<std::ptrdiff_t>(cy_.i0[row]) * f->linesize[2];
+                    v1 = f->data[2] + static_cast<std::ptrdiff_t>(cy_.i1[row]) * f->linesize[2];
+                } else {
+                    v0 = u0 + 1;
+                    v1 = u1 + 1;
+                }
+                cwy = cy_.w[row];
+            }
+            for (auto ox = 0; ox < width; ++ox) {
+                const auto col = static_cast<std::size_t>(ox);
+                float rgb[3];
+                if constexpr (K == detail::TensorSrcKind::packed_rgb) {
+                    const auto i0 = x_.i0[col];
+                    const auto i1 = x_.i1[col];
+                    const auto wx = x_.w[col];
+                    rgb[0] = detail::Bilinear(y0 + rgb_.r, y1 + rgb_.r, i0, i1, wx, wy) * (1.f / 255.f);
+                    rgb[1] = detail::Bilinear(y0 + rgb_.g, y1 + rgb_.g, i0, i1, wx, wy) * (1.f / 255.f);
+                    rgb[2] = detail::Bilinear(y0 + rgb_.b, y1 + rgb_.b, i0, i1, wx, wy) * (1.f / 255.f);
+                } else {
+                    // the matrix is affine so sampling in yuv then converting is the same as
+                    // converting then sampling (up to clamping)
+                    const auto luma = detail::Bilinear(y0, y1, x_.i0[col], x_.i1[col], x_.w[col], wy);
+                    const auto cu = detail::Bilinear(u0, u1, cx_.i0[col], cx_.i1[col], cx_.w[col], cwy) - 128.f;
+                    const auto cv = detail::Bilinear(v0, v1, cx_.i0[col], cx_.i1[col], cx_.w[col], cwy) - 128.f;
+                    const auto yy = k.fy_mul * (luma - static_cast<float>(k.y_off));
+                    rgb[0] = detail::ClampUnit(yy + k.frv * cv);
+                    rgb[1] = detail::ClampUnit(yy - k.fgu * cu - k.fgv * cv);
+                    rgb[2] = detail::ClampUnit(yy + k.fbu * cu);
+                }
+                const auto idx = static_cast<std::ptrdiff_t>(oy) * width + ox;
+                store(idx, 0, swap ? rgb[2] : rgb[0]);
+                store(idx, 1, rgb[1]);
+                store(idx, 2, swap ? rgb[0] : rgb[2]);
+            }
+        }
+    }
+
+    TensorExportOpts opts_;
+    std::array<float, 3> scale_{};
+    std::array<float, 3> bias_{};
+    std::optional<VideoParams> src_params_;
+    detail::TensorSrcKind kind_{};
+    detail::YuvSrcFormat yuv_{};
+    detail::PackedRgbFormat rgb_{};
+    detail::SampleTaps x_;
+    detail::SampleTaps y_;
+    detail::SampleTaps cx_;
+    detail::SampleTaps cy_;
+};
+
+/**
+ batch of up to capacity exported frames back to back in caller owned storage
+ (N x C x H x W for nchw). the storage has to outlive the batch
+*/
+class TensorBatch {
+    TensorExport* exporter_;
+    std::span<uint8_t> storage_;
+    int capacity_;
+    int size_ = 0;
+
+    TensorBatch(TensorExport& exporter, std::span<uint8_t> storage, int capacity) noexcept
+        : exporter_{std::addressof(exporter)}, storage_{storage}, capacity_{capacity} {}
+
+    public:
+    static result<TensorBatch> make(TensorExport& exporter, std::span<uint8_t> storage,
+                                    int capacity) noexcept {
+        if (capacity <= 0 || storage.size() < exporter.frame_bytes() * static_cast<std::size_t>(capacity)) {
+            return errc{AVERROR(EINVAL)};
+        }
+        return TensorBatch{exporter, storage, capacity};
+    }
+
+    result<void> Add(Frame const& frame) noexcept {
+        if (this->full()) {
+            return errc{AVERROR(ENOSPC)};
+        }
+        const auto offset = exporter_->frame_bytes() * static_cast<std::size_t>(size_);
+        LUMA_AV_OUTCOME_TRY(exporter_->Export(frame, storage_.subspan(offset)));
+        size_ += 1;
+        return luma_av::outcome::success();
+    }
+
+    void Clear() noexcept {
+        size_ = 0;
+    }
+
+    int size() const noexcept {
+        return size_;
+    }
+    int capacity() const noexcept {
+        return capacity_;
+    }
+    bool full() const noexcept {
+        return size_ == capacity_;
+    }
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    /**
+     the exported frames, size() * frame_bytes() bytes
+    */
+    std::span<uint8_t> data() const noexcept {
+        return storage_.first(exporter_->frame_bytes() * static_cast<std::size_t>(size_));
+    }
+
+    TensorExport& exporter() const noexcept {
+        return *exporter_;
+    }
+};
+
+namespace detail {
+
+struct AddTensorClosure {
+    TensorBatch& batch;
+    result<void> operator()(result<NotNull<Frame*>> const& frame_res) noexcept {
+        LUMA_AV_OUTCOME_TRY(frame, frame_res);
+        return batch.Add(*frame);
+    }
+    result<void> operator()(Frame const& frame) noexcept {
+        return batch.Add(frame);
+    }
+};
+
+#ifdef LUMA_AV_ENABLE_RANGES
+
+template <std::ranges::view R>
+class tensor_batch_view_impl : public std::ranges::view_interface<tensor_batch_view_impl<R>> {
+public:
+tensor_batch_view_impl() noexcept = default;
+explicit tensor_batch_view_impl(R base, TensorBatch& batch)
+    : base_{std::move(base)}, batch_{std::addressof(batch)} {
+
+}
+
+auto base() const noexcept -> R {
+    return base_;
+}
+auto batch() const noexcept -> TensorBatch& {
+    return *batch_;
+}
+
+auto begin() {
+    return iterator<false>{*this};
+}
+
+auto end() {
+    return std::ranges::end(base_);
+}
+
+private:
+R base_{};
+TensorBatch* batch_ = nullptr;
+
+template <bool is_const>
+class iterator;
+
+};
+
+template <std::ranges::viewable_range R>
+tensor_batch_view_impl(R&&, TensorBatch&) -> tensor_batch_view_impl<std::ranges::views::all_t<R>>;
+
+
+template <std::ranges::view R>
+template <bool is_const>
+class tensor_batch_view_impl<R>::iterator {
+    using output_type = result<NotNull<TensorBatch*>>;
+    using parent_t = detail::MaybeConst_t<is_const, tensor_batch_view_impl<R>>;
+    using base_t = detail::MaybeConst_t<is_const, R>;
+    friend iterator<not is_const>;
+
+    parent_t* parent_ = nullptr;
+    mutable std::ranges::iterator_t<base_t> current_{};
+    mutable bool flushed_ = false;
+    mutable bool reached_end_ = false;
+    // a batch was handed out, start the next one from empty
+    mutable bool clear_next_ = true;
+    mutable std::ptrdiff_t skip_count_{0};
+    mutable std::optional<output_type> cached_batch_;
+
+public:
+
+using difference_type = std::ptrdiff_t;
+using value_type = output_type;
+
+iterator() = default;
+
+explicit iterator(parent_t& parent)
+ : parent_{std::addressof(parent)},
+    current_{std::ranges::begin(parent.base_)} {
+}
+
+std::ranges::iterator_t<base_t> base() const {
+    return current_;
+}
+
+/**
+ yields the batch every time it fills up, then the last partial batch (if any) at the end
+ of the input. the batch memory is reused, consume it before incrementing
+*/
+output_type operator*() const {
+    LUMA_AV_ASSERT(!reached_end_);
+    LUMA_AV_ASSERT(skip_count_ >= -1);
+    if ((skip_count_== -1) && (cached_batch_)) {
+        return *cached_batch_;
+    }
+    auto& batch = parent_->batch();
+    for(;current_!=std::ranges::end(parent_->base_); ++current_) {
+        if (clear_next_) {
+            batch.Clear();
+            clear_next_ = false;
+        }
+        if (auto res = detail::AddTensorClosure{batch}(*current_); !res) {
+            ++current_;
+            auto out = output_type{res.error()};
+            cached_batch_ = out;
+            skip_count_ = -1;
+            return out;
+        }
+        if (batch.full()) {
+            clear_next_ = true;
+            if (skip_count_ <= 0) {
+                auto out = output_type{std::addressof(batch)};
+                cached_batch_ = out;
+                skip_count_ = -1;
+                ++current_;
+                return out;
+            } else {
+                skip_count_ -= 1;
+                continue;
+            }
+        }
+    }
+    if (!flushed_ && !clear_next_ && !batch.empty()) {
+        flushed_ = true;
+        clear_next_ = true;
+        if (skip_count_ <= 0) {
+            auto out = output_type{std::addressof(batch)};
+            cached_batch_ = out;
+            skip_count_ = -1;
+            return out;
+        }
+        skip_count_ -= 1;
+    }
+    reached_end_ = true;
+    return errc::detail_tensor_range_end;
+}
+
+iterator& operator++() {
+    skip_count_ += 1;
+    return *this;
+}
+
+void operator++(int) {
+    ++*this;
+}
+
+iterator operator++(int)
+requires std::ranges::forward_range<base_t> {
+    auto temp = *this;
+    ++*this;
+    return temp;
+}
+
+bool operator==(std::ranges::sentinel_t<base_t> const& other) const {
+    return reached_end_;
+}
+
+bool operator==(iterator const& other) const
+requires std::equality_comparable<std::ranges::iterator_t<base_t>> {
+    auto batch_or_null = [](auto parent) -> TensorBatch* {
+        if (parent) {
+            return parent->batch_;
+        } else {
+            return nullptr;
+        }
+    };
+    return batch_or_null(parent_) == batch_or_null(other.parent_) &&
+        current_ == other.current_ &&
+        flushed_ == other.flushed_ &&
+        reached_end_ == other.reached_end_ &&
+        skip_count_ == other.skip_count_ &&
+        cached_batch_.has_value() == other.cached_batch_.has_value();
+}
+
+};
+
+inline const auto tensor_range_end_view = std::views::filter([](const auto& res){
+    if (res) {
+        return true;
+    } else if (res.error() == errc::detail_tensor_range_end) {
+        return false;
+    } else {
+        return true;
+    }
+});
+
+class tensor_batch_view_impl_range_adaptor_closure {
+    TensorBatch* batch_;
+    public:
+    explicit tensor_batch_view_impl_range_adaptor_closure(TensorBatch& batch)
+        : batch_{std::addressof(batch)} {
+
+    }
+    template <std::ranges::viewable_range R>
+    auto operator()(R&& r) const {
+        return tensor_batch_view_impl{std::views::all(std::forward<R>(r)), *batch_}
+                | tensor_range_end_view;
+    }
+};
+
+template <std::ranges::viewable_range R>
+decltype(auto) operator|(R&& r, tensor_batch_view_impl_range_adaptor_closure const& closure) {
+    return closure(std::forward<R>(r));
+}
+
+class tensor_batch_view_impl_fn {
+public:
+template <class R>
+auto operator()(R&& r, TensorBatch& batch) const {
+    return tensor_batch_view_impl_range_adaptor_closure{batch}(std::forward<R>(r));
+}
+auto operator()(TensorBatch& batch) const {
+    return tensor_batch_view_impl_range_adaptor_closure{batch};
+}
+};
+
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // detail
+
+#ifdef LUMA_AV_ENABLE_RANGES
+/**
+ frames | views::tensor_export(batch) yields result<NotNull<TensorBatch*>> per filled batch
+*/
+inline const auto tensor_export_view = detail::tensor_batch_view_impl_fn{};
+
+namespace views {
+inline const auto tensor_export = tensor_export_view;
+} // views
+#endif  // LUMA_AV_ENABLE_RANGES
+
+} // luma_av
+
+#endif // LUMA_AV_TENSOR_EXPORT_HPP
@@ -0,0 +1,163 @@
+
+#ifndef LUMA_AV_THREAD_POOL_HPP
+#define LUMA_AV_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <luma_av/result.hpp>
+#include <luma_av/util.hpp>
+
+namespace luma_av {
+
+/**
+ small fixed size pool of worker threads for splitting up per frame work
+ (plane copies, slices, filter jobs). the pool can be shared between
+ sessions, ParallelFor can be called from any thread including the workers
+*/
+class ThreadPool {
+    struct State {
+        std::mutex mut;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> jobs;
+        bool stop = false;
+        std::vector<std::thread> workers;
+
+        void Run() noexcept {
+            while (true) {
+                auto job = std::function<void()>{};
+                {
+                    auto lock = std::unique_lock{mut};
+                    cv.wait(lock, [&]{ return stop || !jobs.empty(); });
+                    if (jobs.empty()) {
+                        return;
+                    }
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                job();
+            }
+        }
+
+        ~State() {
+            {
+                auto lock = std::lock_guard{mut};
+                stop = true;
+            }
+            cv.notify_all();
+            for (auto& w : workers) {
+                w.join();
+            }
+        }
+    };
+
+    /**
+     one ParallelFor call. shared with the helper jobs so a helper that only gets
+     scheduled after the call returned finds no work left and exits
+    */
+    struct Batch {
+        std::function<void(int)> fn;
+        int num_tasks{};
+        std::atomic<int> next{0};
+        std::mutex mut;
+        std::condition_variable cv;
+        int done{};
+
+        void Work() noexcept {
+            auto finished = 0;
+            for (auto i = next.fetch_add(1); i < num_tasks; i = next.fetch_add(1)) {
+                fn(i);
+                ++finished;
+            }
+            if (finished > 0) {
+                auto lock = std::lock_guard{mut};
+                done += finished;
+                if (done == num_tasks) {
+                    cv.notify_all();
+                }
+            }
+        }
+    };
+
+    explicit ThreadPool(std::unique_ptr<State> state) noexcept : state_{std::move(state)} {}
+
+    std::unique_ptr<State> state_;
+
+    public:
+    static result<ThreadPool> make(std::size_t num_threads = std::thread::hardware_concurrency()) noexcept {
+        auto state = std::unique_ptr<State>{new (std::nothrow) State{}};
+        if (!state) {
+            return errc::alloc_failure;
+        }
+        try {
+            state->workers.reserve(num_threads);
+            for (std::size_t i = 0; i < num_threads; ++i) {
+                state->workers.emplace_back([s = state.get()]{ s->Run(); });
+            }
+        } catch (std::system_error const& e) {
+            return errc{AVERROR(e.code().value())};
+        } catch (...) {
+            return errc::alloc_failure;
+        }
+        return ThreadPool{std::move(state)};
+    }
+
+    std::size_t size() const noexcept {
+        return state_->workers.size();
+    }
+
+    /**
+     run f(i) for every i in [0, num_tasks) and wait for all of them.
+     the calling thread works on the tasks too, so this makes progress
+     even if every worker is busy. f must not throw
+    */
+    template <class F>
+    void ParallelFor(int num_tasks, F&& f) noexcept {
+        if (num_tasks <= 0) {
+            return;
+        }
+        if (num_tasks == 1 || this->size() == 0) {
+            for (auto i = 0; i < num_tasks; ++i) {
+                f(i);
+            }
+            return;
+        }
+        auto batch = std::shared_ptr<Batch>{};
+        try {
+            batch = std::make_shared<Batch>();
+            batch->fn = [&f](int i){ f(i); };
+            batch->num_tasks = num_tasks;
+            const auto num_helpers = std::min(this->size(), static_cast<std::size_t>(num_tasks - 1));
+            {
+                auto lock = std::lock_guard{state_->mut};
+                for (std::size_t i = 0; i < num_helpers; ++i) {
+                    state_->jobs.emplace_back([batch]{ batch->Work(); });
+                }
+            }
+            state_->cv.notify_all();
+        } catch (...) {
+            // couldnt hand out any work, do it all here
+            if (!batch) {
+                for (auto i = 0; i < num_tasks; ++i) {
+                    f(i);
+                }
+                return;
+            }
+        }
+        batch->Work();
+        auto lock = std::unique_lock{batch->mut};
+        batch->cv.wait(lock, [&]{ return batch->done == num_tasks; });
+    }
+};
+
+} // luma_av
+
+#endif // LUMA_AV_THREAD_POOL_HPP
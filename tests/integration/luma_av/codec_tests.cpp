@@ -1,6 +1,9 @@
 
 
+#include <algorithm>
 #include <array>
+#include <filesystem>
+#include <fstream>
 #include <future>
 #include <queue>
 #include <vector>
@@ -30,6 +33,47 @@ static result<Encoder> DefaultEncoder(std::string const& codec_name) {
     return Encoder::make(std::move(ctx));
 }
 
+/**
+ a raw mpeg1 elementary stream on disk, i.e. what a parser gets fed. 
+ the picture changes every frame so the sizes vary
+*/
+static std::filesystem::path WriteElementaryStream(std::filesystem::path const& path, int nb_frames) {
+    auto ctx = CodecContext::make("mpeg1video"_cstr).value();
+    auto* c = ctx.get();
+    c->width = 64;
+    c->height = 48;
+    c->pix_fmt = AV_PIX_FMT_YUV420P;
+    c->time_base = AVRational{1, 25};
+    c->framerate = AVRational{25, 1};
+    c->gop_size = 4;
+    auto enc = Encoder::make(std::move(ctx)).value();
+    std::ofstream out{path, std::ios::binary};
+    auto write_ready = [&]() {
+        while (enc.recieve_packet()) {
+            auto const* pkt = enc.view_packet().get();
+            out.write(reinterpret_cast<const char*>(pkt->data), pkt->size);
+        }
+    };
+    for (auto i = 0; i < nb_frames; ++i) {
+        auto frame = Frame::make(VideoParams{.width_ = 64, .height_ = 48, 
+                                             .format_ = AV_PIX_FMT_YUV420P}).value();
+        for (auto plane = 0; plane < 3; ++plane) {
+            auto view = frame.Plane<uint8_t>(plane).value();
+            for (auto y = 0; y < view.height(); ++y) {
+                for (auto x = 0; x < view.width(); ++x) {
+                    view(x, y) = static_cast<uint8_t>(x * 3 + y * 5 + i * 11 + plane * 40);
+                }
+            }
+        }
+        frame.get()->pts = i;
+        enc.send_frame(frame).value();
+        write_ready();
+    }
+    enc.start_draining().value();
+    write_ready();
+    return path;
+}
+
 TEST(codec, encode_vector) {
     std::vector<AVFrame*> frames(5); 
 
@@ -448,4 +492,46 @@ TEST(codec, ParseyUwU) {
     }
 }
 
+TEST(codec, parse_mapped_elementary_stream) {
+    const auto path = WriteElementaryStream(
+        std::filesystem::temp_directory_path() / "luma_av_parse_mapped.m1v", 24);
+    // smaller than an intra frame, so some pictures straddle two chunks and get reassembled
+    constexpr auto kChunk = std::size_t{64};
+
+    auto pkts = std::vector<Packet>{};
+    auto contents = std::vector<std::vector<uint8_t>>{};
+    auto mapped = 0;
+    auto copied = 0;
+    {
+        auto buff = MappedFileBuff::make(cstr_view{path.c_str()}).value();
+        auto parser = Parser::make("mpeg1video"_cstr, buff.region()).value();
+        auto chunks = std::vector<std::span<const uint8_t>>{};
+        const auto file = std::as_const(buff).span();
+        for (std::size_t pos = 0; pos < file.size(); pos += kChunk) {
+            chunks.push_back(file.subspan(pos, std::min(kChunk, file.size() - pos)));
+        }
+        for (auto&& res : chunks | parse_packets(parser)) {
+            auto const* pkt = res.value()->get();
+            if (pkt->data >= file.data() && pkt->data < file.data() + file.size()) {
+                // a ref to the mapping, not a copy of it
+                ASSERT_EQ(pkt->buf->data, file.data());
+                ++mapped;
+            } else {
+                ASSERT_FALSE(pkt->buf->data >= file.data() && pkt->buf->data < file.data() + file.size());
+                ++copied;
+            }
+            contents.emplace_back(pkt->data, pkt->data + pkt->size);
+            pkts.push_back(Packet::make(*res.value()).value());
+        }
+    }
+    std::filesystem::remove(path);
+    ASSERT_GT(mapped, 0);
+    ASSERT_GT(copied, 0);
+    // the mapping outlives the MappedFileBuff and the Parser
+    ASSERT_EQ(pkts.size(), contents.size());
+    for (std::size_t i = 0; i < pkts.size(); ++i) {
+        ASSERT_TRUE(std::ranges::equal(pkts[i].span(), contents[i])) << "packet " << i;
+    }
+}
+
 #endif  // LUMA_AV_ENABLE_RANGES
\ No newline at end of file
@@ -0,0 +1,297 @@
+
+#include <numeric>
+#include <vector>
+
+#include <luma_av/filter.hpp>
+#include <luma_av/process.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace luma_av;
+using namespace luma_av_literals;
+
+namespace {
+
+constexpr auto kWidth = 64;
+constexpr auto kHeight = 48;
+
+FilterGraphArgs VideoArgs() {
+    return FilterGraphArgs{}
+        .VideoSize(kWidth, kHeight)
+        .PixFormat(AV_PIX_FMT_YUV420P)
+        .TimeBase(AVRational{1, 25})
+        .AspectRatio(AVRational{1, 1});
+}
+
+std::vector<Frame> GrayFrames(int count) {
+    auto frames = std::vector<Frame>{};
+    for (auto i = 0; i < count; ++i) {
+        auto frame = Frame::make(VideoParams{.width_ = kWidth, .height_ = kHeight, 
+                                             .format_ = AV_PIX_FMT_YUV420P}).value();
+        for (auto plane = 0; plane < 3; ++plane) {
+            for (auto row : frame.Plane<uint8_t>(plane).value().rows()) {
+                std::ranges::fill(row, uint8_t{128});
+            }
+        }
+        frame.get()->pts = i;
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+AudioParams StereoParams(int nb_samples) {
+    return AudioParams{}.nb_samples(nb_samples).channel_layout(AV_CH_LAYOUT_STEREO)
+                        .format(AV_SAMPLE_FMT_FLTP).sample_rate(48000);
+}
+
+std::vector<Frame> SilentFrames(int count, int nb_samples) {
+    auto frames = std::vector<Frame>{};
+    for (auto i = 0; i < count; ++i) {
+        auto frame = Frame::make(StereoParams(nb_samples)).value();
+        for (auto ch = 0; ch < 2; ++ch) {
+            std::fill_n(reinterpret_cast<float*>(frame.get()->extended_data[ch]), nb_samples, 0.f);
+        }
+        frame.get()->pts = i * nb_samples;
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+} // anon
+
+TEST(filter_graph, named_pads) {
+    auto graph = FilterGraph::make().value();
+    const auto* src = FindFilter("buffer"_cstr).value();
+    const auto* sink = FindFilter("buffersink"_cstr).value();
+    graph.CreateSrcFilter(src, "main"_cstr, VideoArgs()).value();
+    graph.CreateSrcFilter(src, "logo"_cstr, VideoArgs()).value();
+    graph.CreateSinkFilter(sink, "out"_cstr).value();
+    graph.FinalizeConfig("[logo]scale=16:16[small];[main][small]overlay=8:8[out]"_cstr).value();
+    ASSERT_EQ(graph.nb_srcs(), 2);
+    ASSERT_EQ(graph.src_index("logo"_cstr).value(), 1);
+    ASSERT_FALSE(graph.sink_index("nope"_cstr));
+
+    auto session = FilterSession::make(std::move(graph)).value();
+    auto main = GrayFrames(2);
+    auto logo = GrayFrames(2);
+    auto outputs = 0;
+    for (auto i = 0; i < 2; ++i) {
+        session.AddSrcFrame("main"_cstr, main[i]).value();
+        session.AddSrcFrame("logo"_cstr, logo[i]).value();
+        while (auto frame = session.GetSinkFrame("out"_cstr)) {
+            ASSERT_EQ(frame.value()->get()->width, kWidth);
+            ++outputs;
+        }
+    }
+    session.MarkEOF().value();
+    while (auto frame = session.GetSinkFrame()) {
+        ++outputs;
+    }
+    ASSERT_EQ(outputs, 2);
+}
+
+TEST(filter_graph, unlabeled_description) {
+    auto make_graph = [](const cstr_view src_name, const cstr_view sink_name) {
+        auto graph = FilterGraph::make().value();
+        graph.CreateSrcFilter(FindFilter("buffer"_cstr).value(), src_name, VideoArgs()).value();
+        graph.CreateSinkFilter(FindFilter("buffersink"_cstr).value(), sink_name).value();
+        return graph;
+    };
+    // ffmpeg only fills in [in] and [out], other names have to be written out
+    ASSERT_FALSE(make_graph("src"_cstr, "out"_cstr).FinalizeConfig("scale=32:24"_cstr));
+    ASSERT_FALSE(make_graph("in"_cstr, "dst"_cstr).FinalizeConfig("scale=32:24"_cstr));
+    ASSERT_TRUE(make_graph("src"_cstr, "dst"_cstr).FinalizeConfig("[src]scale=32:24[dst]"_cstr));
+
+    auto graph = make_graph("in"_cstr, "out"_cstr);
+    graph.FinalizeConfig("scale=32:24"_cstr).value();
+    auto session = FilterSession::make(std::move(graph)).value();
+    auto frames = GrayFrames(1);
+    session.AddSrcFrame(frames[0]).value();
+    ASSERT_EQ(session.GetSinkFrame().value()->get()->width, kWidth / 2);
+
+    const auto srcs = std::vector<FilterPadSpec>{{.name = "in", .filter = FindFilter("buffer"_cstr).value()}};
+    const auto dst = std::vector<FilterPadSpec>{{.name = "dst", .filter = FindFilter("buffersink"_cstr).value()}};
+    ASSERT_FALSE(FilterGraphTemplate::make("scale=32:24", srcs, dst));
+}
+
+TEST(filter_graph, move_frames_in) {
+    auto graph = FilterGraph::make().value();
+    graph.CreateSrcFilter(FindFilter("buffer"_cstr).value(), "in"_cstr, VideoArgs()).value();
+    graph.CreateSinkFilter(FindFilter("buffersink"_cstr).value(), "out"_cstr).value();
+    graph.FinalizeConfig("[in]null[out]"_cstr).value();
+    auto session = FilterSession::make(std::move(graph)).value();
+    session.fixed_src_params(true);
+
+    auto frames = GrayFrames(2);
+    const auto* data = frames[0].get()->data[0];
+    session.AddSrcFrame(std::move(frames[0])).value();
+    ASSERT_EQ(frames[0].get()->buf[0], nullptr);
+    auto out = session.GetSinkFrame().value();
+    ASSERT_EQ(out->get()->data[0], data);
+
+    session.AddSrcFrame(frames[1]).value();
+    ASSERT_NE(frames[1].get()->buf[0], nullptr);
+    ASSERT_TRUE(session.GetSinkFrame());
+}
+
+TEST(filter_graph, slices_on_shared_pool) {
+    auto pool = ThreadPool::make(3).value();
+    auto session_for = [&](cstr_view filters) {
+        auto graph = FilterGraph::make(FilterGraphOpts{}.threads(4).pool(pool)).value();
+        graph.CreateSrcFilter(FindFilter("buffer"_cstr).value(), "in"_cstr, VideoArgs()).value();
+        graph.CreateSinkFilter(FindFilter("buffersink"_cstr).value(), "out"_cstr).value();
+        graph.FinalizeConfig(filters).value();
+        return FilterSession::make(std::move(graph)).value();
+    };
+    auto sharp = session_for("[in]unsharp[out]"_cstr);
+    auto scaled = session_for("[in]scale=32:24[out]"_cstr);
+    ASSERT_EQ(sharp.graph().get()->nb_threads, 4);
+
+    auto frames = GrayFrames(3);
+    auto outputs = 0;
+    for (auto& frame : frames) {
+        sharp.AddSrcFrame(frame).value();
+        scaled.AddSrcFrame(frame).value();
+        while (auto out = sharp.GetSinkFrame()) {
+            ASSERT_EQ(out.value()->get()->width, kWidth);
+            ++outputs;
+        }
+        while (auto out = scaled.GetSinkFrame()) {
+            ASSERT_EQ(out.value()->get()->width, kWidth / 2);
+            ++outputs;
+        }
+    }
+    ASSERT_EQ(outputs, 6);
+}
+
+TEST(filter_graph, template_instances) {
+    const auto srcs = std::vector<FilterPadSpec>{{.name = "in", .filter = FindFilter("buffer"_cstr).value()}};
+    const auto sinks = std::vector<FilterPadSpec>{{.name = "out", .filter = FindFilter("buffersink"_cstr).value(),
+                                                   .pix_fmts = {AV_PIX_FMT_GRAY8}}};
+    ASSERT_FALSE(FilterGraphTemplate::make("[in]scale=32:24[nope]", srcs, sinks));
+    auto tmpl = FilterGraphTemplate::make("[in]scale=32:24[out]", srcs, sinks).value();
+
+    for (auto i = 0; i < 2; ++i) {
+        auto session = FilterSession::make(tmpl.Instantiate(VideoArgs()).value()).value();
+        auto frames = GrayFrames(1);
+        session.AddSrcFrame(frames[0]).value();
+        auto out = session.GetSinkFrame().value();
+        ASSERT_EQ(out->get()->width, kWidth / 2);
+        ASSERT_EQ(out->get()->format, AV_PIX_FMT_GRAY8);
+    }
+
+    ASSERT_FALSE(tmpl.Instantiate(VideoArgs().VideoSize(0, 0)));
+    // bad opts fail that one graph, not the params
+    ASSERT_FALSE(tmpl.Instantiate(VideoArgs(), FilterGraphOpts{}.threads(-1)));
+    ASSERT_TRUE(tmpl.Instantiate(VideoArgs()));
+}
+
+#ifdef LUMA_AV_ENABLE_RANGES
+TEST(filter_graph, every_output_per_push) {
+    auto session_for = [] {
+        auto graph = FilterGraph::make().value();
+        graph.CreateSrcFilter(FindFilter("buffer"_cstr).value(), "in"_cstr, VideoArgs()).value();
+        graph.CreateSinkFilter(FindFilter("buffersink"_cstr).value(), "out"_cstr).value();
+        graph.FinalizeConfig("[in]fps=50[out]"_cstr).value();
+        return FilterSession::make(std::move(graph)).value();
+    };
+    auto count = [](auto&& outputs) {
+        auto n = 0;
+        for (auto&& res : outputs) {
+            EXPECT_EQ(res.value()->get()->width, kWidth);
+            ++n;
+        }
+        return n;
+    };
+    auto frames = GrayFrames(5);
+    auto session = session_for();
+    const auto pushed = count(frames | views::filter_graph(session));
+    auto drained_frames = GrayFrames(5);
+    auto drained_session = session_for();
+    const auto drained = count(drained_frames | views::filter_graph_drain(drained_session));
+    // double rate, fps holds back the last input until it sees the next one or eof
+    ASSERT_GE(pushed, 8);
+    ASSERT_GT(drained, pushed);
+}
+
+TEST(filter_graph, audio_fixed_frame_size) {
+    auto graph = FilterGraph::make().value();
+    graph.CreateSrcFilter(FindFilter("abuffer"_cstr).value(), "in"_cstr, 
+                          FilterGraphArgs{}.Audio(StereoParams(0)).TimeBase(AVRational{1, 48000})).value();
+    graph.CreateSinkFilter(FindFilter("abuffersink"_cstr).value(), "out"_cstr).value();
+    const auto fmts = std::vector<AVSampleFormat>{AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE};
+    graph.SetSinkSampleFormats(0, fmts).value();
+    graph.FinalizeConfig("[in]volume=0.5[out]"_cstr).value();
+    graph.SetSinkFrameSize(0, 256).value();
+    auto session = FilterSession::make(std::move(graph)).value();
+
+    auto frames = SilentFrames(3, 1000);
+    auto sizes = std::vector<int>{};
+    for (auto&& res : frames | views::filter_graph_drain(session)) {
+        auto* out = res.value()->get();
+        ASSERT_EQ(out->format, AV_SAMPLE_FMT_S16);
+        sizes.push_back(out->nb_samples);
+    }
+    ASSERT_EQ(std::accumulate(sizes.begin(), sizes.end(), 0), 3000);
+    sizes.pop_back();
+    ASSERT_EQ(sizes, std::vector<int>(sizes.size(), 256));
+}
+
+TEST(filter_graph, split_renditions_in_one_pass) {
+    auto graph = FilterGraph::make().value();
+    graph.CreateSrcFilter(FindFilter("buffer"_cstr).value(), "in"_cstr, VideoArgs()).value();
+    const auto* sink = FindFilter("buffersink"_cstr).value();
+    graph.CreateSinkFilter(sink, "full"_cstr).value();
+    graph.CreateSinkFilter(sink, "half"_cstr).value();
+    graph.FinalizeConfig("[in]split[a][b];[a]null[full];[b]scale=32:24[half]"_cstr).value();
+    auto session = FilterSession::make(std::move(graph)).value();
+
+    auto frames = GrayFrames(5);
+    auto widths = std::vector<std::vector<int>>(2);
+    for (auto&& res : frames | views::filter_graph_outputs_drain(session)) {
+        auto out = res.value();
+        widths[out.sink].push_back(out.frame->get()->width);
+    }
+    ASSERT_EQ(widths[0], std::vector<int>(5, kWidth));
+    ASSERT_EQ(widths[1], std::vector<int>(5, kWidth / 2));
+}
+
+TEST(filter_graph, processed_frames_stay_with_caller) {
+    auto session_for = [] {
+        auto graph = FilterGraph::make().value();
+        graph.CreateSrcFilter(FindFilter("buffer"_cstr).value(), "in"_cstr, VideoArgs()).value();
+        graph.CreateSinkFilter(FindFilter("buffersink"_cstr).value(), "out"_cstr).value();
+        graph.FinalizeConfig("[in]null[out]"_cstr).value();
+        return FilterSession::make(std::move(graph)).value();
+    };
+    auto shift = InPlaceProcessor{[](Frame& f) -> result<bool> {
+        f.get()->pts += 100;
+        return true;
+    }};
+    // the processor hands out pointers into the vector, the graph only gets refs
+    auto frames = GrayFrames(3);
+    auto session = session_for();
+    auto pts = std::vector<int64_t>{};
+    for (auto&& res : frames | views::process(shift) | views::filter_graph(session)) {
+        pts.push_back(res.value()->get()->pts);
+    }
+    ASSERT_EQ(pts, (std::vector<int64_t>{100, 101, 102}));
+    for (auto& frame : frames) {
+        ASSERT_NE(frame.get()->buf[0], nullptr);
+    }
+
+    // asking for a move hands the buffers over
+    auto moved_frames = GrayFrames(3);
+    auto moved_session = session_for();
+    auto outputs = 0;
+    for (auto&& res : moved_frames | views::process(shift) 
+                                   | views::filter_graph(moved_session, FrameHandoff::move)) {
+        ASSERT_TRUE(res);
+        ++outputs;
+    }
+    ASSERT_EQ(outputs, 3);
+    for (auto& frame : moved_frames) {
+        ASSERT_EQ(frame.get()->buf[0], nullptr);
+    }
+}
+#endif // LUMA_AV_ENABLE_RANGES
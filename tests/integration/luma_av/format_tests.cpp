@@ -0,0 +1,141 @@
+
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <luma_av/codec.hpp>
+
+#include <gtest/gtest.h>
+
+#include <luma_av/format.hpp>
+
+using namespace luma_av;
+using namespace std::chrono_literals;
+using namespace luma_av_literals;
+
+static const auto kFileName = "./test_vids/fortnite_uwu.mp4";
+
+namespace {
+// fifo that gets cleaned up at the end of the test
+struct ScopedFifo {
+    std::filesystem::path path;
+    explicit ScopedFifo(std::filesystem::path p) : path{std::move(p)} {
+        std::filesystem::remove(path);
+        if (mkfifo(path.c_str(), 0600) != 0) {
+            throw std::system_error{errno, std::generic_category()};
+        }
+    }
+    ~ScopedFifo() {
+        std::filesystem::remove(path);
+    }
+};
+
+/**
+ the test clip remuxed to mpegts, which is what actually gets streamed live. 
+ an mp4 over a pipe only works when the moov happens to come first
+*/
+std::filesystem::path RemuxToTs(std::filesystem::path const& out_path) {
+    auto in = format_context::open_input(cstr_view{kFileName}).value();
+    in.FindStreamInfo().value();
+    AVFormatContext* out = nullptr;
+    if (avformat_alloc_output_context2(&out, nullptr, "mpegts", out_path.c_str()) < 0) {
+        throw std::runtime_error{"no mpegts muxer"};
+    }
+    auto out_ptr = std::unique_ptr<AVFormatContext, decltype(&avformat_free_context)>{
+        out, &avformat_free_context};
+    for (auto i = 0u; i < in.get()->nb_streams; ++i) {
+        auto* st = avformat_new_stream(out, nullptr);
+        if (!st || avcodec_parameters_copy(st->codecpar, in.get()->streams[i]->codecpar) < 0) {
+            throw std::runtime_error{"cant copy stream"};
+        }
+        st->codecpar->codec_tag = 0;
+    }
+    if (avio_open(&out->pb, out_path.c_str(), AVIO_FLAG_WRITE) < 0 || 
+        avformat_write_header(out, nullptr) < 0) {
+        throw std::runtime_error{"cant start ts output"};
+    }
+    auto pkt = Packet::make().value();
+    while (in.read_frame(pkt)) {
+        auto* p = pkt.get();
+        av_packet_rescale_ts(p, in.get()->streams[p->stream_index]->time_base, 
+                             out->streams[p->stream_index]->time_base);
+        p->pos = -1;
+        if (av_interleaved_write_frame(out, p) < 0) {
+            throw std::runtime_error{"cant write ts packet"};
+        }
+    }
+    av_write_trailer(out);
+    avio_closep(&out->pb);
+    return out_path;
+}
+} // anon
+
+/**
+a producer streams a file through a fifo and the live reader keeps up with it
+*/
+TEST(live_input, fifo_producer) {
+    const auto ts = RemuxToTs(std::filesystem::temp_directory_path() / "luma_av_live_input.ts");
+    const auto fifo = ScopedFifo{std::filesystem::temp_directory_path() / "luma_av_live_input"};
+
+    auto producer = std::async(std::launch::async, [&]() {
+        std::ifstream in{ts, std::ios::binary};
+        std::ofstream out{fifo.path, std::ios::binary};
+        std::copy(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{},
+                  std::ostreambuf_iterator<char>{out});
+    });
+
+    const auto opts = LiveInputOpts{}.read_timeout(2s);
+    auto reader = Reader::make(cstr_view{fifo.path.c_str()}, opts).value();
+
+    std::vector<Packet> pkts;
+    while (true) {
+        if (auto pkt = reader.ReadFrame()) {
+            pkts.push_back(std::move(pkt).value());
+        } else if (pkt.error().value() == AVERROR(EAGAIN)) {
+            continue;
+        } else if (pkt.error().value() == AVERROR_EOF) {
+            break;
+        } else {
+            throw std::system_error{pkt.error()};
+        }
+    }
+    producer.get();
+    std::filesystem::remove(ts);
+    ASSERT_FALSE(pkts.empty());
+}
+
+/**
+the interrupt callback aborts a read instead of waiting on a stalled producer
+*/
+TEST(live_input, interrupt_stalled_producer) {
+    const auto fifo = ScopedFifo{std::filesystem::temp_directory_path() / "luma_av_live_stall"};
+
+    auto done = std::promise<void>{};
+    auto producer = std::async(std::launch::async, [&]() {
+        // open the write end so the reader can open but never send anything
+        std::ofstream out{fifo.path, std::ios::binary};
+        done.get_future().wait();
+    });
+
+    const auto opts = LiveInputOpts{}.interrupt([]() { return true; });
+    auto fctx = format_context::open_input(cstr_view{fifo.path.c_str()}, opts);
+    done.set_value();
+    producer.get();
+    ASSERT_FALSE(fctx);
+    ASSERT_EQ(fctx.error().value(), AVERROR_EXIT);
+}
+
+TEST(live_input, low_delay_decoder) {
+    auto ctx = CodecContext::make("h264"_cstr).value();
+    ctx.EnableLowDelay();
+    ASSERT_TRUE(ctx.get()->flags & AV_CODEC_FLAG_LOW_DELAY);
+    auto dec = Decoder::make(std::move(ctx)).value();
+}
@@ -0,0 +1,129 @@
+
+#include <vector>
+
+#include <luma_av/swscale.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace luma_av;
+using namespace luma_av_literals;
+
+namespace {
+
+Frame PatternFrame(int width, int height, AVPixelFormat fmt) {
+    auto frame = Frame::make(VideoParams{.width_ = width, .height_ = height, .format_ = fmt}).value();
+    auto* f = frame.get();
+    for (auto plane = 0; plane < 3; ++plane) {
+        const auto rows = plane == 0 ? height : height / 2;
+        const auto cols = plane == 0 ? width : width / 2;
+        for (auto y = 0; y < rows; ++y) {
+            for (auto x = 0; x < cols; ++x) {
+                f->data[plane][y * f->linesize[plane] + x] = static_cast<uint8_t>(x * 7 + y * 13 + plane * 50);
+            }
+        }
+    }
+    return frame;
+}
+
+Frame Scaled(ScaleOpts const& dst, Frame const& src) {
+    auto sws = ScaleSession::make(dst).value();
+    auto out = sws.Scale(src).value();
+    return Frame::make(out->get()).value();
+}
+
+void ExpectSamePixels(Frame const& a, Frame const& b, int width, int height) {
+    for (auto plane = 0; plane < 3; ++plane) {
+        const auto rows = plane == 0 ? height : height / 2;
+        const auto cols = plane == 0 ? width : width / 2;
+        for (auto y = 0; y < rows; ++y) {
+            const auto* ra = a.get()->data[plane] + y * a.get()->linesize[plane];
+            const auto* rb = b.get()->data[plane] + y * b.get()->linesize[plane];
+            ASSERT_TRUE(std::equal(ra, ra + cols, rb)) << "plane " << plane << " row " << y;
+        }
+    }
+}
+
+bool SamePlane0(Frame const& a, Frame const& b, int width, int height) {
+    for (auto y = 0; y < height; ++y) {
+        const auto* ra = a.get()->data[0] + y * a.get()->linesize[0];
+        const auto* rb = b.get()->data[0] + y * b.get()->linesize[0];
+        if (!std::equal(ra, ra + width, rb)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anon
+
+TEST(swscale, bands_on_pool_match_single_thread) {
+#if !LUMA_AV_SWS_SLICE_API
+    GTEST_SKIP() << "banded scaling needs the swscale slice api";
+#endif
+    auto pool = ThreadPool::make(3).value();
+    const auto src = PatternFrame(3840, 2160, AV_PIX_FMT_YUV420P);
+    for (auto [w, h] : {std::pair{1920, 1080}, std::pair{1280, 722}}) {
+        const auto single = Scaled(ScaleOpts{w, h, AV_PIX_FMT_YUV420P}, src);
+        const auto banded = Scaled(ScaleOpts{w, h, AV_PIX_FMT_YUV420P}.pool(pool), src);
+        ExpectSamePixels(single, banded, w, h);
+    }
+}
+
+TEST(swscale, band_count) {
+    auto pool = ThreadPool::make(3).value();
+    const auto src = ScaleOpts{64, 64, AV_PIX_FMT_YUV420P};
+    auto ctx = ScaleContext::make(src, ScaleOpts{32, 32, AV_PIX_FMT_YUV420P}.threads(2).pool(pool));
+#if LUMA_AV_SWS_SLICE_API
+    ASSERT_EQ(ctx.value().nb_bands(), 2);
+#else
+    ASSERT_EQ(ctx.error().value(), AVERROR(ENOSYS));
+    ASSERT_FALSE(ScaleContext::make(src, ScaleOpts{32, 32, AV_PIX_FMT_YUV420P}.pool(pool)));
+#endif
+    ASSERT_EQ(ScaleContext::make(src, ScaleOpts{32, 32, AV_PIX_FMT_YUV420P}.threads(1).pool(pool))
+              .value().nb_bands(), 1);
+    ASSERT_EQ(ScaleContext::make(src, ScaleOpts{32, 32, AV_PIX_FMT_YUV420P}).value().nb_bands(), 1);
+}
+
+TEST(swscale, algorithm_flags_and_filter) {
+    const auto src = PatternFrame(320, 240, AV_PIX_FMT_YUV420P);
+    const auto dst = ScaleOpts{160, 120, AV_PIX_FMT_YUV420P};
+    const auto plain = Scaled(dst, src);
+    // bicubic is what swscale picked before there was a choice
+    ASSERT_TRUE(SamePlane0(plain, Scaled(ScaleOpts{dst}.algorithm(ScaleAlgorithm::bicubic), src), 160, 120));
+    const auto fast = Scaled(ScaleOpts{dst}.algorithm(ScaleAlgorithm::fast_bilinear), src);
+    const auto point = Scaled(ScaleOpts{dst}.algorithm(ScaleAlgorithm::point), src);
+    ASSERT_FALSE(SamePlane0(fast, point, 160, 120));
+    const auto lanczos = Scaled(ScaleOpts{dst}.algorithm(ScaleAlgorithm::lanczos)
+                                    .flags(SWS_ACCURATE_RND | SWS_FULL_CHR_H_INT).params({3, 0}), src);
+    ASSERT_FALSE(SamePlane0(plain, lanczos, 160, 120));
+    const auto blurred = Scaled(ScaleOpts{dst}.filter(ScaleFilter{}.luma_blur(2.f)), src);
+    ASSERT_FALSE(SamePlane0(plain, blurred, 160, 120));
+}
+
+TEST(swscale, color_range_and_matrix) {
+    auto src = PatternFrame(64, 64, AV_PIX_FMT_YUV420P);
+    const auto dst = ScaleOpts{64, 64, AV_PIX_FMT_RGB24};
+    const auto limited = Scaled(dst, src);
+    src.get()->color_range = AVCOL_RANGE_JPEG;
+    const auto full = Scaled(dst, src);
+    ASSERT_FALSE(SamePlane0(limited, full, 64 * 3, 64));
+    src.get()->color_range = AVCOL_RANGE_UNSPECIFIED;
+    src.get()->colorspace = AVCOL_SPC_BT709;
+    const auto bt709 = Scaled(dst, src);
+    ASSERT_FALSE(SamePlane0(limited, bt709, 64 * 3, 64));
+}
+
+TEST(swscale, output_color_tags) {
+    auto src = PatternFrame(64, 64, AV_PIX_FMT_YUV420P);
+    src.get()->colorspace = AVCOL_SPC_BT709;
+    src.get()->color_range = AVCOL_RANGE_JPEG;
+    // full range in, limited out unless the dst says otherwise. the matrix stays
+    const auto yuv = Scaled(ScaleOpts{32, 32, AV_PIX_FMT_YUV420P}, src);
+    ASSERT_EQ(yuv.get()->colorspace, AVCOL_SPC_BT709);
+    ASSERT_EQ(yuv.get()->color_range, AVCOL_RANGE_MPEG);
+    const auto full = Scaled(ScaleOpts{32, 32, AV_PIX_FMT_YUV420P}.color_range(AVCOL_RANGE_JPEG), src);
+    ASSERT_EQ(full.get()->color_range, AVCOL_RANGE_JPEG);
+    const auto rgb = Scaled(ScaleOpts{32, 32, AV_PIX_FMT_RGB24}, src);
+    ASSERT_EQ(rgb.get()->colorspace, AVCOL_SPC_RGB);
+    ASSERT_EQ(rgb.get()->color_range, AVCOL_RANGE_JPEG);
+}
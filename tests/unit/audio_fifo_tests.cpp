@@ -0,0 +1,118 @@
+
+#include <luma_av/audio_fifo.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace luma_av;
+
+namespace {
+
+/**
+ fltp stereo, each sample holds its index in the stream so reordering or loss shows up
+*/
+Frame MakeFrame(int nb_samples, int first, int64_t pts) {
+  auto par = AudioParams{};
+  par.channel_layout(AV_CH_LAYOUT_STEREO).nb_samples(nb_samples).format(AV_SAMPLE_FMT_FLTP).sample_rate(48000);
+  auto f = Frame::make(par).value();
+  auto a = AudioFrame::make(f).value();
+  for (auto ch = 0; ch < 2; ++ch) {
+    auto samples = a.Channel<float>(ch).value().span();
+    for (auto i = 0; i < nb_samples; ++i) {
+      samples[i] = static_cast<float>(first + i);
+    }
+  }
+  f.get()->pts = pts;
+  return f;
+}
+
+} // namespace
+
+TEST(audio_fifo, fixed_size_frames) {
+  auto fifo = AudioFifo::make(AudioFifoOpts{}.frame_size(1024)).value();
+  ASSERT_EQ(fifo.Read().error(), errc::again);
+  auto written = 0;
+  auto expected_first = 0;
+  for (auto size : {700, 300, 1500, 100}) {
+    fifo.Write(MakeFrame(size, written, 1000 + written)).value();
+    written += size;
+    while (fifo.ready()) {
+      auto out = fifo.Read().value();
+      auto a = AudioFrame::make(*out).value();
+      ASSERT_EQ(a.nb_samples(), 1024);
+      ASSERT_EQ(a.Channel<float>(1).value()[0], expected_first);
+      ASSERT_EQ(a.Channel<float>(0).value()[1023], expected_first + 1023);
+      // pts counts samples from the first input
+      ASSERT_EQ(out->get()->pts, 1000 + expected_first);
+      expected_first += 1024;
+    }
+  }
+  ASSERT_EQ(fifo.size(), 2600 - 2048);
+  auto last = fifo.Flush().value();
+  ASSERT_EQ(last->get()->nb_samples, 2600 - 2048);
+  ASSERT_EQ(last->get()->pts, 1000 + 2048);
+  ASSERT_EQ(fifo.Flush().error(), errc::end);
+}
+
+TEST(audio_fifo, time_base_and_mismatch) {
+  auto fifo = AudioFifo::make(AudioFifoOpts{}.frame_size(480).time_base(AVRational{1, 1000})).value();
+  fifo.Write(MakeFrame(960, 0, 5000)).value();
+  ASSERT_EQ(fifo.Read().value()->get()->pts, 5000);
+  // 480 samples at 48k is 10ms
+  ASSERT_EQ(fifo.Read().value()->get()->pts, 5010);
+
+  auto par = AudioParams{};
+  par.channel_layout(AV_CH_LAYOUT_MONO).nb_samples(100).format(AV_SAMPLE_FMT_FLTP).sample_rate(48000);
+  auto mono = Frame::make(par).value();
+  ASSERT_FALSE(fifo.Write(mono));
+  ASSERT_FALSE(AudioFifo::make(AudioFifoOpts{}.frame_size(0)));
+}
+
+TEST(audio_fifo, short_flush_frame) {
+  auto fifo = AudioFifo::make(AudioFifoOpts{}.frame_size(256)).value();
+  fifo.Write(MakeFrame(300, 0, 0)).value();
+  ASSERT_EQ(fifo.Read().value()->get()->nb_samples, 256);
+  // the rest gets a buffer of its own size, not the full one with nb_samples cut down
+  auto last = fifo.Flush().value();
+  ASSERT_EQ(last->get()->nb_samples, 44);
+  ASSERT_LT(last->get()->linesize[0], 256 * static_cast<int>(sizeof(float)));
+  ASSERT_EQ(AudioFrame::make(*last).value().Channel<float>(0).value()[43], 299.f);
+}
+
+#ifdef LUMA_AV_ENABLE_RANGES
+TEST(audio_fifo, view_rebatches) {
+  auto frames = std::vector<Frame>{};
+  auto written = 0;
+  for (auto size : {1000, 1000, 1000, 200}) {
+    frames.push_back(MakeFrame(size, written, written));
+    written += size;
+  }
+  auto sizes = std::vector<int>{};
+  for (auto&& res : frames | views::rebatch_audio(1024)) {
+    sizes.push_back(res.value()->get()->nb_samples);
+  }
+  ASSERT_EQ(sizes, (std::vector<int>{1024, 1024, 1024, 128}));
+
+  auto fifo = AudioFifo::make(AudioFifoOpts{}.frame_size(2000)).value();
+  auto pts = std::vector<int64_t>{};
+  for (auto&& res : frames | views::rebatch_audio(fifo)) {
+    pts.push_back(res.value()->get()->pts);
+  }
+  ASSERT_EQ(pts, (std::vector<int64_t>{0, 2000}));
+}
+
+TEST(audio_fifo, view_bad_frame_size) {
+  auto frames = std::vector<Frame>{};
+  frames.push_back(MakeFrame(100, 0, 0));
+  for (auto size : {0, -1}) {
+    auto errors = 0;
+    for (auto&& res : frames | views::rebatch_audio(size)) {
+      ASSERT_FALSE(res);
+      ASSERT_EQ(res.error(), errc{AVERROR(EINVAL)});
+      errors += 1;
+    }
+    ASSERT_EQ(errors, 1);
+  }
+}
+#endif // LUMA_AV_ENABLE_RANGES
@@ -0,0 +1,165 @@
+
+#include <luma_av/color_convert.hpp>
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace luma_av;
+
+namespace {
+
+/**
+ luma ramp with the same chroma everywhere, so the result doesnt depend on how
+ the chroma gets upsampled and only the matrix math is compared
+*/
+Frame MakeYuv(AVPixelFormat fmt, int width, int height, uint8_t u, uint8_t v) {
+  auto f = Frame::make(VideoParams{.width_ = width, .height_ = height, .format_ = fmt}).value();
+  auto luma = f.Plane<uint8_t>(0).value();
+  for (auto y = 0; y < luma.height(); ++y) {
+    for (auto x = 0; x < luma.width(); ++x) {
+      luma(x, y) = static_cast<uint8_t>(x + 7 * y);
+    }
+  }
+  if (fmt == AV_PIX_FMT_NV12) {
+    auto uv = f.Plane<uint8_t>(1).value();
+    for (auto row : uv.rows()) {
+      for (std::size_t i = 0; i < row.size(); i += 2) {
+        row[i] = u;
+        row[i + 1] = v;
+      }
+    }
+  } else {
+    for (auto row : f.Plane<uint8_t>(1).value().rows()) {
+      std::ranges::fill(row, u);
+    }
+    for (auto row : f.Plane<uint8_t>(2).value().rows()) {
+      std::ranges::fill(row, v);
+    }
+  }
+  return f;
+}
+
+Frame SwsReference(Frame const& src, AVPixelFormat dst_fmt, int colorspace, int src_range) {
+  auto* ctx = sws_getContext(src.width(), src.height(), src.pix_fmt(),
+                             src.width(), src.height(), dst_fmt,
+                             SWS_POINT | SWS_ACCURATE_RND | SWS_FULL_CHR_H_INT | SWS_FULL_CHR_H_INP,
+                             nullptr, nullptr, nullptr);
+  EXPECT_NE(ctx, nullptr);
+  const auto* coeffs = sws_getCoefficients(colorspace);
+  sws_setColorspaceDetails(ctx, coeffs, src_range, coeffs, 1, 0, 1 << 16, 1 << 16);
+  auto dst = Frame::make(VideoParams{.width_ = src.width(), .height_ = src.height(), .format_ = dst_fmt}).value();
+  sws_scale(ctx, src.get()->data, src.get()->linesize, 0, src.height(),
+            dst.get()->data, dst.get()->linesize);
+  sws_freeContext(ctx);
+  return dst;
+}
+
+int MaxDiff(Frame const& lhs, Frame const& rhs, int row_bytes) {
+  auto max_diff = 0;
+  for (auto y = 0; y < lhs.height(); ++y) {
+    const auto* l = lhs.get()->data[0] + y * lhs.get()->linesize[0];
+    const auto* r = rhs.get()->data[0] + y * rhs.get()->linesize[0];
+    for (auto x = 0; x < row_bytes; ++x) {
+      max_diff = std::max(max_diff, std::abs(l[x] - r[x]));
+    }
+  }
+  return max_diff;
+}
+
+/**
+ the image with tightly packed rows, so only the pixels get compared and not the row padding
+*/
+std::vector<uint8_t> PackedPixels(Frame const& f) {
+  auto packed = std::vector<uint8_t>(f.ImageBufferSize(1).value());
+  f.CopyToImageBuffer(packed, ImageCopyOpts{}.align(1)).value();
+  return packed;
+}
+
+} // namespace
+
+TEST(color_convert, supported_formats) {
+  ASSERT_TRUE(ColorConvert::Supports(AV_PIX_FMT_YUV420P, AV_PIX_FMT_RGB24));
+  ASSERT_TRUE(ColorConvert::Supports(AV_PIX_FMT_NV12, AV_PIX_FMT_BGRA));
+  ASSERT_TRUE(ColorConvert::Supports(AV_PIX_FMT_YUV422P, AV_PIX_FMT_GBRPF32));
+  ASSERT_FALSE(ColorConvert::Supports(AV_PIX_FMT_YUV444P, AV_PIX_FMT_RGB24));
+  ASSERT_FALSE(ColorConvert::make(ColorConvertOpts{}.dst_format(AV_PIX_FMT_YUV420P)));
+}
+
+TEST(color_convert, matches_swscale) {
+  for (auto src_fmt : {AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_NV12}) {
+    for (auto [dst_fmt, px_bytes] : {std::pair{AV_PIX_FMT_RGB24, 3}, std::pair{AV_PIX_FMT_BGRA, 4}}) {
+      for (auto matrix : {ColorMatrix::bt601, ColorMatrix::bt709}) {
+        for (auto range : {ColorRange::limited, ColorRange::full}) {
+          auto conv = ColorConvert::make(ColorConvertOpts{}.dst_format(dst_fmt)
+                                         .matrix(matrix).range(range)).value();
+          const auto cs = matrix == ColorMatrix::bt709 ? SWS_CS_ITU709 : SWS_CS_ITU601;
+          const auto sws_range = range == ColorRange::full ? 1 : 0;
+          for (auto [u, v] : {std::pair{128, 128}, std::pair{16, 240}, std::pair{200, 60}, std::pair{0, 255}}) {
+            auto src = MakeYuv(src_fmt, 130, 34, static_cast<uint8_t>(u), static_cast<uint8_t>(v));
+            auto expected = SwsReference(src, dst_fmt, cs, sws_range);
+            auto out = conv.Convert(src).value();
+            ASSERT_LE(MaxDiff(*out, expected, src.width() * px_bytes), 1);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(color_convert, simd_levels_identical) {
+  const auto levels = {SimdLevel::generic, SimdLevel::sse41, SimdLevel::avx2, SimdLevel::avx512};
+  for (auto src_fmt : {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12}) {
+    for (auto dst_fmt : {AV_PIX_FMT_RGB24, AV_PIX_FMT_BGRA, AV_PIX_FMT_GBRPF32}) {
+      // odd size to go through the partial block path
+      auto src = MakeYuv(src_fmt, 199, 21, 90, 170);
+      auto reference = std::vector<std::vector<uint8_t>>{};
+      for (auto level : levels) {
+        auto conv = ColorConvert::make(ColorConvertOpts{}.dst_format(dst_fmt).max_simd(level)).value();
+        auto out = conv.Convert(src).value();
+        auto pixels = PackedPixels(*out);
+        if (!reference.empty()) {
+          ASSERT_EQ(pixels, reference.front());
+        }
+        reference.push_back(std::move(pixels));
+      }
+    }
+  }
+}
+
+TEST(color_convert, float_matches_rgb24) {
+  auto src = MakeYuv(AV_PIX_FMT_YUV420P, 64, 16, 100, 180);
+  auto rgb_conv = ColorConvert::make().value();
+  auto float_conv = ColorConvert::make(ColorConvertOpts{}.dst_format(AV_PIX_FMT_GBRPF32)).value();
+  auto rgb = rgb_conv.Convert(src).value();
+  auto planar = float_conv.Convert(src).value();
+  auto rgb_view = rgb->Plane<uint8_t>(0).value();
+  // gbr plane order
+  auto g = planar->Plane<float>(0).value();
+  auto b = planar->Plane<float>(1).value();
+  auto r = planar->Plane<float>(2).value();
+  for (auto y = 0; y < 16; ++y) {
+    for (auto x = 0; x < 64; ++x) {
+      ASSERT_NEAR(r(x, y) * 255.f, rgb_view(3 * x, y), 0.51f);
+      ASSERT_NEAR(g(x, y) * 255.f, rgb_view(3 * x + 1, y), 0.51f);
+      ASSERT_NEAR(b(x, y) * 255.f, rgb_view(3 * x + 2, y), 0.51f);
+    }
+  }
+}
+
+TEST(color_convert, parallel_rows) {
+  auto pool = ThreadPool::make(3).value();
+  auto src = MakeYuv(AV_PIX_FMT_YUV420P, 96, 90, 30, 220);
+  auto serial = ColorConvert::make().value();
+  auto parallel = ColorConvert::make(ColorConvertOpts{}.pool(pool).min_band_rows(8)).value();
+  auto expected = serial.Convert(src).value()->CopyToImageBuffer().value();
+  auto out = parallel.Convert(src).value()->CopyToImageBuffer().value();
+  ASSERT_TRUE(std::ranges::equal(out.view(), expected.view()));
+}
@@ -0,0 +1,86 @@
+
+#include <luma_av/format.hpp>
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <vector>
+
+using namespace luma_av;
+
+namespace {
+std::vector<uint8_t> Concat(std::vector<std::span<const uint8_t>> const& chunks) {
+  std::vector<uint8_t> out;
+  for (auto const& chunk : chunks) {
+    out.insert(out.end(), chunk.begin(), chunk.end());
+  }
+  return out;
+}
+}  // namespace
+
+/**
+writes that span several chunks come back out in order
+*/
+TEST(memory_arena, write_across_chunks) {
+  auto arena = MemoryArena::make(4).value();
+  std::vector<uint8_t> data(10);
+  std::iota(data.begin(), data.end(), uint8_t{0});
+  arena.Write(data).value();
+  ASSERT_EQ(arena.size(), 10);
+  ASSERT_EQ(arena.capacity(), 12);
+  const auto chunks = arena.Chunks();
+  ASSERT_EQ(chunks.size(), 3);
+  ASSERT_EQ(chunks.back().size(), 2);
+  ASSERT_EQ(Concat(chunks), data);
+}
+
+/**
+seeking back overwrites in place, seeking past the end zero fills
+*/
+TEST(memory_arena, seek_and_patch) {
+  auto arena = MemoryArena::make(4).value();
+  const auto data = std::vector<uint8_t>{1, 2, 3, 4, 5, 6};
+  arena.Write(data).value();
+  arena.SeekTo(3);
+  const auto patch = std::vector<uint8_t>{9, 9};
+  arena.Write(patch).value();
+  ASSERT_EQ(arena.size(), 6);
+  arena.SeekTo(8);
+  arena.Write(patch).value();
+  const auto expected = std::vector<uint8_t>{1, 2, 3, 9, 9, 6, 0, 0, 9, 9};
+  ASSERT_EQ(Concat(arena.Chunks()), expected);
+}
+
+/**
+reset keeps the memory around for the next segment
+*/
+TEST(memory_arena, reset_keeps_capacity) {
+  auto arena = MemoryArena::make(4, 16).value();
+  ASSERT_EQ(arena.capacity(), 16);
+  const auto data = std::vector<uint8_t>{1, 2, 3, 4, 5};
+  arena.Write(data).value();
+  arena.Reset();
+  ASSERT_EQ(arena.size(), 0);
+  ASSERT_TRUE(arena.Chunks().empty());
+  ASSERT_EQ(arena.capacity(), 16);
+  arena.ShrinkToFit();
+  ASSERT_EQ(arena.capacity(), 0);
+}
+
+TEST(memory_output_io, write_seek_recycle) {
+  auto ioc = MemoryOutputIOContext::make(8).value();
+  const auto data = std::vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  avio_write(ioc.get(), data.data(), static_cast<int>(data.size()));
+  ASSERT_EQ(avio_seek(ioc.get(), 1, SEEK_SET), 1);
+  const auto patch = std::vector<uint8_t>{0, 0};
+  avio_write(ioc.get(), patch.data(), static_cast<int>(patch.size()));
+  ASSERT_EQ(ioc.size().value(), 10);
+  const auto expected = std::vector<uint8_t>{1, 0, 0, 4, 5, 6, 7, 8, 9, 10};
+  ASSERT_EQ(Concat(ioc.Chunks().value()), expected);
+
+  ioc.Recycle().value();
+  ASSERT_EQ(ioc.size().value(), 0);
+  avio_write(ioc.get(), patch.data(), static_cast<int>(patch.size()));
+  ASSERT_EQ(Concat(ioc.Chunks().value()), patch);
+  ASSERT_EQ(ioc.arena().capacity(), 16);
+}
@@ -4,6 +4,10 @@
 #include <luma_av/codec.hpp>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <vector>
+
 using namespace luma_av;
 
 
@@ -20,6 +24,366 @@ TEST(frame, default_move) {
   auto f2 = Frame{std::move(f)};
 }
 
+TEST(frame_pool, video_get) {
+  auto pool = FramePool::make().value();
+  auto par = VideoParams{.width_ = 1920, .height_ = 1080, .format_ = AV_PIX_FMT_YUV420P};
+  auto f = pool.Get(par).value();
+  ASSERT_EQ(f.width(), 1920);
+  ASSERT_EQ(f.height(), 1080);
+  ASSERT_EQ(f.pix_fmt(), AV_PIX_FMT_YUV420P);
+  ASSERT_TRUE(f.IsWritable());
+  for (auto i = 0; i < 3; ++i) {
+    ASSERT_NE(f.get()->data[i], nullptr);
+    ASSERT_EQ(f.get()->linesize[i] % Frame::default_alignment, 0);
+  }
+  ASSERT_EQ(f.get()->data[3], nullptr);
+}
+
+TEST(frame_pool, reuse_after_release) {
+  auto pool = FramePool::make().value();
+  auto par = VideoParams{.width_ = 640, .height_ = 480, .format_ = AV_PIX_FMT_RGB24};
+  auto f = pool.Get(par).value();
+  auto* first = f.get()->data[0];
+  pool.Get(f, par).value();
+  // the first buffer was released by Get before taking one from the pool
+  ASSERT_EQ(f.get()->data[0], first);
+  ASSERT_EQ(pool.stats().buffers, 1);
+
+  auto f2 = pool.Get(par).value();
+  ASSERT_NE(f2.get()->data[0], first);
+  ASSERT_EQ(pool.stats().buffers, 2);
+  ASSERT_EQ(pool.stats().pools, 1);
+}
+
+TEST(frame_pool, get_if_not_writable) {
+  auto pool = FramePool::make().value();
+  auto par = VideoParams{.width_ = 32, .height_ = 32, .format_ = AV_PIX_FMT_GRAY8};
+  auto f = Frame::make().value();
+  pool.GetIfNotWritable(f, par).value();
+  auto* first = f.get()->data[0];
+  first[0] = 7;
+  // only owner and same params, the buffer is kept as is
+  pool.GetIfNotWritable(f, par).value();
+  ASSERT_EQ(f.get()->data[0], first);
+  ASSERT_EQ(f.get()->data[0][0], 7);
+
+  // a ref elsewhere, new buffer and the holder keeps its pixels
+  auto held = Frame::make(f.get()).value();
+  pool.GetIfNotWritable(f, par).value();
+  ASSERT_NE(f.get()->data[0], first);
+  ASSERT_EQ(held.get()->data[0], first);
+  ASSERT_EQ(held.get()->data[0][0], 7);
+
+  // other params, new buffer
+  auto* second = f.get()->data[0];
+  pool.GetIfNotWritable(f, VideoParams{.width_ = 64, .height_ = 32, .format_ = AV_PIX_FMT_GRAY8}).value();
+  ASSERT_NE(f.get()->data[0], second);
+  ASSERT_EQ(f.width(), 64);
+}
+
+TEST(frame_pool, lru_and_trim) {
+  auto pool = FramePool::make(2).value();
+  auto small = VideoParams{.width_ = 64, .height_ = 64, .format_ = AV_PIX_FMT_GRAY8};
+  auto medium = VideoParams{.width_ = 128, .height_ = 128, .format_ = AV_PIX_FMT_GRAY8};
+  auto large = VideoParams{.width_ = 256, .height_ = 256, .format_ = AV_PIX_FMT_GRAY8};
+  static_cast<void>(pool.Get(small).value());
+  static_cast<void>(pool.Get(medium).value());
+  ASSERT_EQ(pool.stats().pools, 2);
+  static_cast<void>(pool.Get(large).value());
+  ASSERT_EQ(pool.stats().pools, 2);
+  // small was evicted and its idle buffer freed with it
+  ASSERT_EQ(pool.stats().buffers, 2);
+
+  auto held = pool.Get(large).value();
+  auto high_water = pool.stats().high_water_bytes;
+  ASSERT_GE(high_water, pool.stats().bytes);
+  pool.Trim();
+  ASSERT_EQ(pool.stats().pools, 0);
+  // the held buffer stays alive until the frame lets go of it
+  ASSERT_EQ(pool.stats().buffers, 1);
+  ASSERT_TRUE(held.IsWritable());
+  held = Frame::make().value();
+  ASSERT_EQ(pool.stats().buffers, 0);
+  ASSERT_EQ(pool.stats().bytes, 0);
+  ASSERT_EQ(pool.stats().high_water_bytes, high_water);
+}
+
+TEST(frame_pool, audio_get) {
+  auto pool = FramePool::make().value();
+  auto par = AudioParams{};
+  par.channel_layout(AV_CH_LAYOUT_STEREO).nb_samples(1024).format(AV_SAMPLE_FMT_FLTP);
+  auto f = pool.Get(par).value();
+  ASSERT_EQ(f.get()->nb_samples, 1024);
+  ASSERT_EQ(f.get()->channels, 2);
+  ASSERT_NE(f.get()->extended_data[0], nullptr);
+  ASSERT_NE(f.get()->extended_data[1], nullptr);
+  ASSERT_NE(f.get()->buf[1], nullptr);
+}
+
+TEST(typed_frame, video_view) {
+  auto f = Frame::make(VideoParams{.width_ = 320, .height_ = 240, .format_ = AV_PIX_FMT_YUV420P}).value();
+  auto v = VideoFrame::make(f).value();
+  ASSERT_EQ(v.width(), 320);
+  ASSERT_EQ(v.height(), 240);
+  ASSERT_EQ(v.pix_fmt(), AV_PIX_FMT_YUV420P);
+  ASSERT_EQ(v.nb_planes(), 3);
+  for (auto i = 0; i < v.nb_planes(); ++i) {
+    ASSERT_EQ(v.data(i), f.get()->data[i]);
+    ASSERT_EQ(v.linesize(i), f.get()->linesize[i]);
+  }
+  ASSERT_EQ(v.row(1, 2), f.get()->data[1] + 2 * f.get()->linesize[1]);
+  ASSERT_FALSE(AudioFrame::make(f));
+}
+
+TEST(typed_frame, audio_view) {
+  auto par = AudioParams{};
+  par.channel_layout(AV_CH_LAYOUT_STEREO).nb_samples(512).format(AV_SAMPLE_FMT_S16P);
+  auto f = Frame::make(par).value();
+  auto a = AudioFrame::make(f).value();
+  ASSERT_EQ(a.nb_samples(), 512);
+  ASSERT_EQ(a.channels(), 2);
+  ASSERT_TRUE(a.is_planar());
+  ASSERT_EQ(a.nb_planes(), 2);
+  ASSERT_EQ(a.bytes_per_sample(), 2);
+  ASSERT_EQ(a.data(1), f.get()->extended_data[1]);
+  ASSERT_FALSE(VideoFrame::make(f));
+}
+
+TEST(typed_frame, audio_channels) {
+  auto par = AudioParams{};
+  par.channel_layout(AV_CH_LAYOUT_STEREO).nb_samples(64).format(AV_SAMPLE_FMT_S16).sample_rate(44100);
+  auto f = Frame::make(par).value();
+  ASSERT_EQ(f.audio_params(), par);
+  ASSERT_EQ(f.get()->sample_rate, 44100);
+  auto a = AudioFrame::make(f).value();
+  ASSERT_EQ(a.sample_rate(), 44100);
+  auto left = a.Channel<int16_t>(0).value();
+  auto right = a.Channel<int16_t>(1).value();
+  ASSERT_FALSE(right.contiguous());
+  ASSERT_EQ(right.step(), 2);
+  for (auto i = 0; i < left.size(); ++i) {
+    left[i] = static_cast<int16_t>(i);
+    right[i] = static_cast<int16_t>(-i);
+  }
+  // interleaved l r l r
+  const auto* raw = reinterpret_cast<const int16_t*>(f.get()->data[0]);
+  ASSERT_EQ(raw[6], 3);
+  ASSERT_EQ(raw[7], -3);
+  auto sum = 0;
+  for (auto s : right) {
+    sum += s;
+  }
+  ASSERT_EQ(sum, -(63 * 64) / 2);
+  ASSERT_FALSE(a.Channel<float>(0));
+  ASSERT_FALSE(a.Channel<int16_t>(2));
+
+  par.format(AV_SAMPLE_FMT_FLTP);
+  auto planar = Frame::make(par).value();
+  auto pa = AudioFrame::make(planar).value();
+  auto span = pa.Channel<float>(1).value().span();
+  ASSERT_EQ(span.data(), reinterpret_cast<float*>(planar.get()->extended_data[1]));
+  ASSERT_EQ(span.size(), 64);
+}
+
+TEST(typed_frame, empty_frame) {
+  auto f = Frame::make().value();
+  ASSERT_FALSE(VideoFrame::make(f));
+  ASSERT_FALSE(AudioFrame::make(f));
+}
+
+static_assert(std::forward_iterator<PlaneView<uint8_t>::RowIterator>);
+static_assert(std::forward_iterator<ChannelView<float>::Iterator>);
+
+TEST(plane_view, rows_and_crop) {
+  // 6x4 image with 2 bytes of padding per row
+  constexpr auto stride = 8;
+  auto buff = std::vector<uint8_t>(stride * 4);
+  auto plane = PlaneView<uint8_t>{buff.data(), 6, 4, stride};
+  auto y = 0;
+  for (auto row : plane.rows()) {
+    ASSERT_EQ(row.size(), 6);
+    for (auto& px : row) {
+      px = static_cast<uint8_t>(y);
+    }
+    ++y;
+  }
+  ASSERT_EQ(y, 4);
+  ASSERT_EQ(buff[stride * 2 + 5], 2);
+  // padding untouched
+  ASSERT_EQ(buff[stride * 2 + 6], 0);
+
+  auto crop = plane.Crop(1, 2, 3, 2);
+  ASSERT_EQ(crop.width(), 3);
+  ASSERT_EQ(crop.height(), 2);
+  ASSERT_EQ(&crop(0, 0), &buff[stride * 2 + 1]);
+  crop(2, 1) = 42;
+  ASSERT_EQ(plane(3, 3), 42);
+  PlaneView<const uint8_t> const_crop = crop;
+  ASSERT_EQ(const_crop.row(1)[2], 42);
+}
+
+TEST(plane_view, flipped_stride) {
+  auto buff = std::vector<uint16_t>{0, 1, 2, 3, 4, 5};
+  // bottom row first
+  auto plane = PlaneView<uint16_t>{buff.data() + 4, 2, 3, -4};
+  ASSERT_EQ(plane(0, 0), 4);
+  ASSERT_EQ(plane(1, 2), 1);
+}
+
+TEST(plane_view, frame_planes) {
+  auto f = Frame::make(VideoParams{.width_ = 63, .height_ = 31, .format_ = AV_PIX_FMT_YUV420P}).value();
+  auto luma = f.Plane<uint8_t>(0).value();
+  ASSERT_EQ(luma.width(), 63);
+  ASSERT_EQ(luma.height(), 31);
+  ASSERT_EQ(luma.stride(), f.get()->linesize[0]);
+  auto chroma = f.Plane<uint8_t>(2).value();
+  ASSERT_EQ(chroma.width(), 32);
+  ASSERT_EQ(chroma.height(), 16);
+  ASSERT_FALSE(f.Plane<uint8_t>(3));
+  // 2 byte elements dont tile 1 byte pixels
+  ASSERT_FALSE(f.Plane<uint16_t>(0));
+
+  auto rgb = Frame::make(VideoParams{.width_ = 10, .height_ = 4, .format_ = AV_PIX_FMT_RGB24}).value();
+  ASSERT_EQ(rgb.Plane<uint8_t>(0).value().width(), 30);
+  using Rgb = std::array<uint8_t, 3>;
+  auto v = VideoFrame::make(rgb).value();
+  ASSERT_EQ(v.Plane<Rgb>(0).value().width(), 10);
+}
+
+TEST(frame, copy_to_caller_buffer) {
+  auto f = Frame::make(VideoParams{.width_ = 101, .height_ = 300, .format_ = AV_PIX_FMT_YUV420P}).value();
+  for (auto plane = 0; plane < 3; ++plane) {
+    auto view = f.Plane<uint8_t>(plane).value();
+    for (auto y = 0; y < view.height(); ++y) {
+      for (auto x = 0; x < view.width(); ++x) {
+        view(x, y) = static_cast<uint8_t>(plane * 50 + x + y);
+      }
+    }
+  }
+  auto pool = ThreadPool::make(3).value();
+  auto packed_size = f.ImageBufferSize(1).value();
+  auto serial = std::vector<uint8_t>(packed_size);
+  auto parallel = std::vector<uint8_t>(packed_size);
+  f.CopyToImageBuffer(serial, ImageCopyOpts{}.align(1)).value();
+  f.CopyToImageBuffer(parallel, ImageCopyOpts{}.align(1).pool(pool).min_band_rows(16)).value();
+  ASSERT_EQ(serial, parallel);
+  // packed luma rows
+  ASSERT_EQ(parallel[101 * 7 + 3], 10);
+
+  // row padding is left untouched, so compare against a serial copy into the same zeroed storage
+  auto aligned_size = f.ImageBufferSize().value();
+  auto aligned_serial = std::vector<uint8_t>(aligned_size);
+  auto aligned_parallel = std::vector<uint8_t>(aligned_size);
+  f.CopyToImageBuffer(aligned_serial).value();
+  f.CopyToImageBuffer(aligned_parallel, ImageCopyOpts{}.pool(pool)).value();
+  ASSERT_EQ(aligned_serial, aligned_parallel);
+
+  auto too_small = std::vector<uint8_t>(packed_size - 1);
+  ASSERT_FALSE(f.CopyToImageBuffer(too_small, ImageCopyOpts{}.align(1)));
+}
+
+TEST(frame, wrap_external_memory) {
+  // nv12 with a gap between the planes, they dont need to be contiguous
+  auto storage = std::vector<uint8_t>(64 * 8 + 100 + 64 * 4);
+  auto released = 0;
+  auto planes = std::array<uint8_t*, 2>{storage.data(), storage.data() + 64 * 8 + 100};
+  auto strides = std::array<int, 2>{64, 64};
+  auto par = VideoParams{.width_ = 60, .height_ = 8, .format_ = AV_PIX_FMT_NV12};
+  {
+    auto f = Frame::Wrap(par, planes, strides, [&]{ ++released; }).value();
+    ASSERT_EQ(f.video_params(), par);
+    ASSERT_TRUE(f.IsWritable());
+    f.Plane<uint8_t>(1).value()(1, 3) = 42;
+    ASSERT_EQ(storage[64 * 8 + 100 + 64 * 3 + 1], 42);
+
+    auto ref = Frame::make().value();
+    f.RefTo(ref).value();
+    ASSERT_FALSE(f.IsWritable());
+    auto moved = Frame::make().value();
+    ref.MoveRefTo(moved);
+    ASSERT_EQ(moved.get()->data[0], storage.data());
+    { auto drop = std::move(f); }
+    ASSERT_EQ(released, 0);
+  }
+  ASSERT_EQ(released, 1);
+
+  // make writable copies out instead of writing into read only memory
+  auto f = Frame::Wrap(par, planes, strides, [&]{ ++released; }, true).value();
+  ASSERT_FALSE(f.IsWritable());
+  f.MakeWritable().value();
+  ASSERT_EQ(released, 2);
+  ASSERT_NE(f.get()->data[0], storage.data());
+  ASSERT_EQ(f.Plane<uint8_t>(1).value()(1, 3), 42);
+}
+
+TEST(frame, crop_shares_buffers) {
+  auto f = Frame::make(VideoParams{.width_ = 64, .height_ = 32, .format_ = AV_PIX_FMT_YUV420P}).value();
+  for (auto plane = 0; plane < 3; ++plane) {
+    auto view = f.Plane<uint8_t>(plane).value();
+    for (auto y = 0; y < view.height(); ++y) {
+      for (auto x = 0; x < view.width(); ++x) {
+        view(x, y) = static_cast<uint8_t>(plane * 100 + x + y);
+      }
+    }
+  }
+  auto roi = f.Crop(10, 6, 21, 9).value();
+  ASSERT_EQ(roi.width(), 21);
+  ASSERT_EQ(roi.height(), 9);
+  ASSERT_EQ(roi.get()->buf[0]->buffer, f.get()->buf[0]->buffer);
+  ASSERT_EQ(roi.Plane<uint8_t>(0).value()(0, 0), 16);
+  // chroma starts at 5, 3 and covers ceil(21 / 2) columns
+  auto u = roi.Plane<uint8_t>(1).value();
+  ASSERT_EQ(u.width(), 11);
+  ASSERT_EQ(u(0, 0), 108);
+  ASSERT_EQ(roi.Plane<uint8_t>(2).value()(10, 4), 200 + 15 + 7);
+
+  // odd offsets would split a chroma sample
+  ASSERT_FALSE(f.Crop(3, 0, 8, 8));
+  ASSERT_FALSE(f.Crop(0, 30, 8, 4));
+  // crops of crops
+  auto inner = roi.Crop(2, 2, 4, 4).value();
+  ASSERT_EQ(inner.Plane<uint8_t>(0).value()(0, 0), 20);
+
+  // the parent still holds a ref, so this copies out just the region
+  inner.MakeWritable().value();
+  ASSERT_NE(inner.get()->buf[0]->buffer, f.get()->buf[0]->buffer);
+  ASSERT_EQ(inner.Plane<uint8_t>(0).value()(3, 3), 26);
+}
+
+TEST(frame, tiles) {
+  auto f = Frame::make(VideoParams{.width_ = 100, .height_ = 50, .format_ = AV_PIX_FMT_NV12}).value();
+  auto tiles = f.Tiles(3, 2).value();
+  ASSERT_EQ(tiles.size(), 6);
+  auto total = 0;
+  for (auto const& tile : tiles) {
+    total += tile.width() * tile.height();
+    ASSERT_EQ(tile.get()->buf[0]->buffer, f.get()->buf[0]->buffer);
+  }
+  ASSERT_EQ(total, 100 * 50);
+  // edges rounded down to even, last column takes the rest
+  ASSERT_EQ(tiles[0].width(), 32);
+  ASSERT_EQ(tiles[1].width(), 34);
+  ASSERT_EQ(tiles[2].width(), 34);
+  ASSERT_EQ(tiles[3].height(), 26);
+  ASSERT_EQ(tiles[4].get()->data[0], f.get()->data[0] + 24 * f.get()->linesize[0] + 32);
+  ASSERT_EQ(tiles[4].get()->data[1], f.get()->data[1] + 12 * f.get()->linesize[1] + 32);
+  ASSERT_FALSE(f.Tiles(51, 1));
+}
+
+TEST(frame, wrap_rejects_bad_planes) {
+  auto storage = std::vector<uint8_t>(64 * 8);
+  auto released = false;
+  auto planes = std::array<uint8_t*, 1>{storage.data()};
+  auto strides = std::array<int, 1>{32};
+  // stride smaller than a row
+  ASSERT_FALSE(Frame::Wrap(VideoParams{.width_ = 16, .height_ = 8, .format_ = AV_PIX_FMT_RGB24}, 
+                           planes, strides, [&]{ released = true; }));
+  // not enough planes
+  ASSERT_FALSE(Frame::Wrap(VideoParams{.width_ = 16, .height_ = 8, .format_ = AV_PIX_FMT_YUV420P}, 
+                           planes, strides, [&]{ released = true; }));
+  ASSERT_FALSE(released);
+}
+
 // /**
 // memory safe construct, buffer aloc, and destruct
 // */
@@ -0,0 +1,124 @@
+
+#include <luma_av/packet_log.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace luma_av;
+
+namespace {
+
+std::string LogPath(const char* name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+Packet MakePacket(int size, int64_t pts, int stream) {
+  auto pkt = Packet::make(size).value();
+  std::iota(pkt.span().begin(), pkt.span().end(), static_cast<uint8_t>(pts));
+  pkt.get()->pts = pts;
+  pkt.get()->dts = pts - 1;
+  pkt.get()->duration = 1;
+  pkt.get()->stream_index = stream;
+  pkt.get()->flags = pts == 0 ? AV_PKT_FLAG_KEY : 0;
+  return pkt;
+}
+
+bool PaddingZeroed(Packet const& pkt) {
+  const auto* pad = pkt.get()->data + pkt.get()->size;
+  return std::all_of(pad, pad + AV_INPUT_BUFFER_PADDING_SIZE, [](auto b) { return b == 0; });
+}
+
+} // namespace
+
+TEST(packet_log, round_trip) {
+  const auto path = LogPath("luma_av_packet_log_round_trip.plog");
+  const auto streams = std::vector<PacketLogStream>{
+      {.type = AVMEDIA_TYPE_VIDEO, .codec_id = AV_CODEC_ID_H264, .time_base = {1, 90000},
+       .extradata = {1, 2, 3}},
+      {.type = AVMEDIA_TYPE_VIDEO, .codec_id = AV_CODEC_ID_MPEG1VIDEO, .time_base = {1, 25},
+       .extradata = {}}};
+  auto sizes = std::vector<int>{100, 1, 4000, 63, 64};
+  {
+    auto writer = PacketLogWriter::make(path, streams).value();
+    for (auto i = 0; i < static_cast<int>(sizes.size()); ++i) {
+      auto pkt = MakePacket(sizes[i], i, i % 2);
+      if (i == 2) {
+        auto sd = av_packet_new_side_data(pkt.get(), AV_PKT_DATA_PALETTE, 5);
+        std::fill(sd, sd + 5, uint8_t{7});
+      }
+      writer.Write(pkt).value();
+    }
+    auto bad = MakePacket(10, 0, 2);
+    ASSERT_FALSE(writer.Write(bad));
+    ASSERT_EQ(writer.packets_written(), sizes.size());
+    writer.Close().value();
+  }
+
+  auto reader = PacketLogReader::make(path).value();
+  ASSERT_EQ(reader.streams().size(), 2);
+  ASSERT_EQ(reader.streams()[0].codec_id, AV_CODEC_ID_H264);
+  ASSERT_EQ(reader.streams()[0].extradata, (std::vector<uint8_t>{1, 2, 3}));
+  ASSERT_EQ(reader.streams()[1].time_base.den, 25);
+  for (auto pass = 0; pass < 2; ++pass) {
+    for (auto i = 0; i < static_cast<int>(sizes.size()); ++i) {
+      reader.ReadFrameInPlace().value();
+      const auto& pkt = reader.view_packet();
+      const auto expected = MakePacket(sizes[i], i, i % 2);
+      ASSERT_TRUE(std::ranges::equal(pkt.span(), expected.span()));
+      ASSERT_EQ(pkt.get()->pts, i);
+      ASSERT_EQ(pkt.get()->dts, i - 1);
+      ASSERT_EQ(pkt.get()->stream_index, i % 2);
+      ASSERT_EQ(pkt.get()->flags, expected.get()->flags);
+      ASSERT_EQ(pkt.get()->side_data_elems, i == 2 ? 1 : 0);
+      // points into the mapping, and the log supplies the padding
+      ASSERT_FALSE(pkt.is_writable());
+      ASSERT_TRUE(PaddingZeroed(pkt));
+    }
+    ASSERT_EQ(reader.ReadFrameInPlace().error().value(), AVERROR_EOF);
+    reader.Rewind();
+  }
+  std::filesystem::remove(path);
+}
+
+TEST(packet_log, truncated_log_replays_complete_packets) {
+  const auto path = LogPath("luma_av_packet_log_truncated.plog");
+  auto full_size = std::size_t{};
+  {
+    auto writer = PacketLogWriter::make(path).value();
+    writer.Write(MakePacket(10, 0, 0)).value();
+    writer.Write(MakePacket(500, 1, 0)).value();
+    full_size = writer.bytes_written();
+    writer.Close().value();
+  }
+  std::filesystem::resize_file(path, full_size - 100);
+  auto reader = PacketLogReader::make(path).value();
+  auto pkt = reader.ReadFrame().value();
+  ASSERT_EQ(pkt.get()->size, 10);
+  ASSERT_EQ(reader.ReadFrameInPlace().error().value(), AVERROR_EOF);
+  std::filesystem::remove(path);
+  ASSERT_FALSE(PacketLogReader::make(path));
+}
+
+#ifdef LUMA_AV_ENABLE_RANGES
+TEST(packet_log, read_input_view) {
+  const auto path = LogPath("luma_av_packet_log_view.plog");
+  {
+    auto writer = PacketLogWriter::make(path).value();
+    for (auto i = 0; i < 3; ++i) {
+      writer.Write(MakePacket(32, i, 0)).value();
+    }
+  }
+  auto reader = PacketLogReader::make(path).value();
+  auto pts = std::vector<int64_t>{};
+  for (auto&& res : views::read_input(reader)) {
+    pts.push_back(res.value()->get()->pts);
+  }
+  ASSERT_EQ(pts, (std::vector<int64_t>{0, 1, 2}));
+  std::filesystem::remove(path);
+}
+#endif // LUMA_AV_ENABLE_RANGES
@@ -0,0 +1,116 @@
+
+#include <luma_av/packet.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+using namespace luma_av;
+
+namespace {
+bool PaddingZeroed(Packet const& pkt) {
+  const auto* pad = pkt.get()->data + pkt.get()->size;
+  return std::all_of(pad, pad + AV_INPUT_BUFFER_PADDING_SIZE, [](auto b) { return b == 0; });
+}
+}  // namespace
+
+TEST(packet_buffer_pool, size_classes) {
+  auto pool = PacketBufferPool::make().value();
+  auto* small = pool.Get(10).value();
+  ASSERT_EQ(small->size, 256);
+  auto* mid = pool.Get(1000).value();
+  ASSERT_EQ(mid->size, 2048);
+  // payload plus padding fits exactly
+  auto* exact = pool.Get(1024 - AV_INPUT_BUFFER_PADDING_SIZE).value();
+  ASSERT_EQ(exact->size, 1024);
+  ASSERT_EQ(pool.stats().pools, 3);
+  ASSERT_EQ(pool.stats().buffers, 3);
+  ASSERT_EQ(pool.stats().bytes, 256 + 2048 + 1024);
+  av_buffer_unref(&small);
+  av_buffer_unref(&mid);
+  av_buffer_unref(&exact);
+  // idle buffers stay allocated for the next Get
+  ASSERT_EQ(pool.stats().buffers, 3);
+  auto* again = pool.Get(100).value();
+  ASSERT_EQ(pool.stats().buffers, 3);
+  av_buffer_unref(&again);
+  ASSERT_FALSE(pool.Get(-1));
+}
+
+TEST(packet_buffer_pool, reset_buffer_copy) {
+  auto pool = PacketBufferPool::make().value();
+  auto pkt = Packet::make().value();
+  auto data = std::vector<uint8_t>(300);
+  std::iota(data.begin(), data.end(), uint8_t{1});
+  pkt.reset_buffer_copy(data, pool).value();
+  ASSERT_TRUE(std::ranges::equal(pkt.span(), data));
+  ASSERT_TRUE(PaddingZeroed(pkt));
+  ASSERT_EQ(pool.stats().buffers, 1);
+
+  // unshared and big enough, copied in place
+  const auto* first = pkt.get()->buf->data;
+  data.resize(100);
+  pkt.reset_buffer_copy(data, pool).value();
+  ASSERT_EQ(pkt.get()->buf->data, first);
+  ASSERT_EQ(pkt.span().size(), 100);
+  ASSERT_TRUE(PaddingZeroed(pkt));
+
+  // someone else holds a ref, so it cant be written over
+  auto held = Packet::make(pkt).value();
+  pkt.reset_buffer_copy(data, pool).value();
+  ASSERT_NE(pkt.get()->buf->data, first);
+  ASSERT_TRUE(std::ranges::equal(held.span(), pkt.span()));
+  ASSERT_EQ(pool.stats().buffers, 2);
+}
+
+TEST(packet_buffer_pool, new_buffer) {
+  auto pool = PacketBufferPool::make().value();
+  auto pkt = Packet::make().value();
+  pkt.new_buffer(5000, pool).value();
+  ASSERT_EQ(pkt.get()->size, 5000);
+  ASSERT_TRUE(pkt.is_writable());
+  ASSERT_TRUE(PaddingZeroed(pkt));
+  ASSERT_EQ(pool.stats().bytes, 8192);
+  // default pool
+  auto other = Packet::make(64).value();
+  ASSERT_TRUE(PaddingZeroed(other));
+}
+
+TEST(packet, wrap_mapped) {
+  auto* owner = av_buffer_alloc(1000);
+  std::iota(owner->data, owner->data + 1000, uint8_t{0});
+  const auto mapping = MappedRegion{owner, {owner->data, 1000}};
+
+  // far enough from the end, no copy
+  auto pkt = Packet::WrapMapped(mapping, {owner->data + 100, 200}).value();
+  ASSERT_EQ(pkt.get()->data, owner->data + 100);
+  ASSERT_EQ(pkt.get()->size, 200);
+  ASSERT_EQ(pkt.get()->buf->buffer, owner->buffer);
+  ASSERT_FALSE(pkt.is_writable());
+
+  // the packet keeps the memory alive
+  av_buffer_unref(&owner);
+  ASSERT_EQ(pkt.span()[0], 100);
+
+  auto copy = Packet::make(pkt).value();
+  copy.make_writable().value();
+  ASSERT_NE(copy.get()->data, pkt.get()->data);
+  ASSERT_TRUE(std::ranges::equal(copy.span(), pkt.span()));
+}
+
+TEST(packet, wrap_mapped_tail_is_copied) {
+  auto* owner = av_buffer_alloc(1000);
+  std::iota(owner->data, owner->data + 1000, uint8_t{0});
+  const auto mapping = MappedRegion{owner, {owner->data, 1000}};
+  auto pkt = Packet::WrapMapped(mapping, {owner->data + 950, 50}).value();
+  ASSERT_NE(pkt.get()->data, owner->data + 950);
+  ASSERT_EQ(pkt.span()[0], 950 % 256);
+  ASSERT_TRUE(PaddingZeroed(pkt));
+
+  ASSERT_FALSE(Packet::WrapMapped(mapping, {owner->data + 950, 100}));
+  auto other = std::vector<uint8_t>(10);
+  ASSERT_FALSE(Packet::WrapMapped(mapping, other));
+  av_buffer_unref(&owner);
+}
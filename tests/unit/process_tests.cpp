@@ -0,0 +1,165 @@
+
+#include <luma_av/process.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace luma_av;
+
+namespace {
+
+std::vector<Frame> MakeFrames(int count) {
+  auto frames = std::vector<Frame>{};
+  for (auto i = 0; i < count; ++i) {
+    auto f = Frame::make(VideoParams{.width_ = 16, .height_ = 8, .format_ = AV_PIX_FMT_GRAY8}).value();
+    f.get()->data[0][0] = static_cast<uint8_t>(i);
+    f.get()->pts = i;
+    frames.push_back(std::move(f));
+  }
+  return frames;
+}
+
+/**
+ each input comes out once as is and then once more as a pooled copy
+*/
+class Repeat {
+  FramePool pool_ = FramePool::make().value();
+  Frame copy_ = Frame::make().value();
+  Frame* input_ = nullptr;
+  int pending_ = 0;
+
+  public:
+  result<void> SendFrame(Frame& frame) noexcept {
+    input_ = std::addressof(frame);
+    pending_ = 2;
+    return luma_av::outcome::success();
+  }
+  result<NotNull<Frame*>> ReceiveFrame() noexcept {
+    if (pending_ == 2) {
+      pending_ = 1;
+      return input_;
+    } else if (pending_ == 1) {
+      pending_ = 0;
+      LUMA_AV_OUTCOME_TRY(pool_.Get(copy_, VideoParams{.width_ = 16, .height_ = 8,
+                                                       .format_ = AV_PIX_FMT_GRAY8}));
+      LUMA_AV_OUTCOME_TRY_FF(av_frame_copy(copy_.get(), input_->get()));
+      LUMA_AV_OUTCOME_TRY_FF(av_frame_copy_props(copy_.get(), input_->get()));
+      return std::addressof(copy_);
+    }
+    return errc{AVERROR(EAGAIN)};
+  }
+  result<void> Flush() noexcept {
+    return luma_av::outcome::success();
+  }
+};
+
+/**
+ holds each input back until the next one, so the last one only comes out on flush
+*/
+class Delay {
+  std::optional<Frame> held_;
+  std::optional<Frame> ready_;
+  bool flushed_ = false;
+
+  public:
+  result<void> SendFrame(Frame& frame) noexcept {
+    ready_ = std::move(held_);
+    LUMA_AV_OUTCOME_TRY(ref, Frame::make(frame.get()));
+    held_ = std::move(ref);
+    return luma_av::outcome::success();
+  }
+  result<NotNull<Frame*>> ReceiveFrame() noexcept {
+    if (ready_) {
+      // the frame handed out has to live until the next call
+      out_ = std::move(ready_);
+      ready_.reset();
+      return std::addressof(*out_);
+    }
+    return flushed_ ? errc{AVERROR_EOF} : errc{AVERROR(EAGAIN)};
+  }
+  result<void> Flush() noexcept {
+    flushed_ = true;
+    ready_ = std::move(held_);
+    held_.reset();
+    return luma_av::outcome::success();
+  }
+
+  private:
+  std::optional<Frame> out_;
+};
+
+static_assert(FrameProcessor<Repeat>);
+static_assert(FrameProcessor<Delay>);
+
+} // namespace
+
+TEST(process, in_place_edit_and_drop) {
+  auto frames = MakeFrames(4);
+  auto drop_odd = InPlaceProcessor{[](Frame& f) -> result<bool> {
+    if (f.get()->pts % 2) {
+      return false;
+    }
+    f.get()->pts *= 10;
+    return true;
+  }};
+  static_assert(FrameProcessor<decltype(drop_odd)>);
+  drop_odd.SendFrame(frames[0]).value();
+  auto out = drop_odd.ReceiveFrame().value();
+  // no copy, the output is the input
+  ASSERT_EQ(out, &frames[0]);
+  ASSERT_EQ(drop_odd.ReceiveFrame().error(), errc::again);
+  drop_odd.SendFrame(frames[1]).value();
+  ASSERT_EQ(drop_odd.ReceiveFrame().error(), errc::again);
+  drop_odd.Flush().value();
+  ASSERT_EQ(drop_odd.ReceiveFrame().error(), errc::end);
+}
+
+#ifdef LUMA_AV_ENABLE_RANGES
+TEST(process, view_many_outputs_per_input) {
+  auto frames = MakeFrames(3);
+  auto repeat = Repeat{};
+  auto pts = std::vector<int64_t>{};
+  auto first_pixel = std::vector<int>{};
+  for (auto&& res : frames | views::process(repeat)) {
+    auto out = res.value();
+    pts.push_back(out->get()->pts);
+    first_pixel.push_back(out->get()->data[0][0]);
+  }
+  ASSERT_EQ(pts, (std::vector<int64_t>{0, 0, 1, 1, 2, 2}));
+  ASSERT_EQ(first_pixel, (std::vector<int>{0, 0, 1, 1, 2, 2}));
+}
+
+TEST(process, view_drain_flushes_held_frames) {
+  auto frames = MakeFrames(3);
+  auto delay = Delay{};
+  auto pts = std::vector<int64_t>{};
+  for (auto&& res : frames | views::process(delay)) {
+    pts.push_back(res.value()->get()->pts);
+  }
+  ASSERT_EQ(pts, (std::vector<int64_t>{0, 1}));
+
+  auto drained = Delay{};
+  pts.clear();
+  for (auto&& res : frames | views::process_drain(drained)) {
+    pts.push_back(res.value()->get()->pts);
+  }
+  ASSERT_EQ(pts, (std::vector<int64_t>{0, 1, 2}));
+}
+
+TEST(process, view_chains_in_place_stages) {
+  auto frames = MakeFrames(4);
+  auto drop_odd = InPlaceProcessor{[](Frame& f) -> result<bool> {
+    return f.get()->pts % 2 == 0;
+  }};
+  auto shift = InPlaceProcessor{[](Frame& f) -> result<bool> {
+    f.get()->pts += 100;
+    return true;
+  }};
+  auto pts = std::vector<int64_t>{};
+  for (auto&& res : frames | views::process(drop_odd) | views::process_drain(shift)) {
+    pts.push_back(res.value()->get()->pts);
+  }
+  ASSERT_EQ(pts, (std::vector<int64_t>{100, 102}));
+}
+#endif // LUMA_AV_ENABLE_RANGES
@@ -0,0 +1,145 @@
+
+#include <luma_av/queue.hpp>
+#include <luma_av/packet.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace luma_av;
+
+TEST(queue, spsc_try_push_pop) {
+  auto q = SpscQueue<std::unique_ptr<int>>::make(3).value();
+  ASSERT_EQ(q.capacity(), 4);
+  ASSERT_EQ(q.TryPop().error(), errc::again);
+  for (auto i = 0; i < 4; ++i) {
+    q.TryPush(std::make_unique<int>(i)).value();
+  }
+  auto extra = std::make_unique<int>(4);
+  ASSERT_EQ(q.TryPush(std::move(extra)).error(), errc::again);
+  // a failed push doesnt consume its argument
+  ASSERT_TRUE(extra);
+  ASSERT_EQ(q.size(), 4);
+  for (auto i = 0; i < 4; ++i) {
+    ASSERT_EQ(*q.TryPop().value(), i);
+  }
+  ASSERT_EQ(q.TryPop().error(), errc::again);
+  ASSERT_FALSE(SpscQueue<int>::make(0));
+}
+
+TEST(queue, close_drains_then_ends) {
+  auto q = MpmcQueue<std::unique_ptr<int>>::make(8).value();
+  q.Push(std::make_unique<int>(1)).value();
+  q.Push(std::make_unique<int>(2)).value();
+  q.Close();
+  ASSERT_TRUE(q.closed());
+  auto late = std::make_unique<int>(3);
+  ASSERT_EQ(q.Push(std::move(late)).error(), errc::end);
+  ASSERT_TRUE(late);
+  ASSERT_EQ(*q.Pop().value(), 1);
+  ASSERT_EQ(*q.Pop().value(), 2);
+  ASSERT_EQ(q.Pop().error(), errc::end);
+  ASSERT_EQ(q.TryPop().error(), errc::end);
+}
+
+TEST(queue, batches) {
+  auto q = SpscQueue<int>::make(8).value();
+  auto in = std::vector<int>(12);
+  std::iota(in.begin(), in.end(), 0);
+  ASSERT_EQ(q.TryPushBatch(in).value(), 8);
+  auto out = std::vector<int>{};
+  ASSERT_EQ(q.TryPopBatch(std::back_inserter(out), 5).value(), 5);
+  ASSERT_EQ(q.TryPushBatch(std::span{in}.subspan(8)).value(), 4);
+  ASSERT_EQ(q.PopBatch(std::back_inserter(out), 100).value(), 7);
+  ASSERT_EQ(out, in);
+}
+
+TEST(queue, blocked_pop_wakes_on_close) {
+  auto q = SpscQueue<int>::make(2).value();
+  auto res = result<int>{errc::again};
+  auto consumer = std::thread{[&] { res = q.Pop(); }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  q.Close();
+  consumer.join();
+  ASSERT_EQ(res.error(), errc::end);
+}
+
+TEST(queue, spsc_threads_keep_order) {
+  constexpr auto n = 100000;
+  auto q = SpscQueue<int>::make(64).value();
+  auto producer = std::thread{[&] {
+    for (auto i = 0; i < n; ++i) {
+      auto v = i;
+      q.Push(std::move(v)).value();
+    }
+    q.Close();
+  }};
+  auto expected = 0;
+  while (auto v = q.Pop()) {
+    ASSERT_EQ(v.value(), expected);
+    ++expected;
+  }
+  producer.join();
+  ASSERT_EQ(expected, n);
+}
+
+TEST(queue, mpmc_threads_deliver_everything_once) {
+  constexpr auto producers = 4;
+  constexpr auto consumers = 4;
+  constexpr auto per_producer = 20000;
+  auto q = MpmcQueue<int>::make(32).value();
+  auto seen = std::vector<std::atomic<int>>(producers * per_producer);
+  auto threads = std::vector<std::thread>{};
+  auto producers_left = std::atomic<int>{producers};
+  for (auto p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      auto batch = std::vector<int>{};
+      for (auto i = 0; i < per_producer; ++i) {
+        batch.push_back(p * per_producer + i);
+        if (batch.size() == 7 || i + 1 == per_producer) {
+          ASSERT_EQ(q.PushBatch(batch).value(), batch.size());
+          batch.clear();
+        }
+      }
+      if (--producers_left == 0) {
+        q.Close();
+      }
+    });
+  }
+  for (auto c = 0; c < consumers; ++c) {
+    threads.emplace_back([&] {
+      auto out = std::vector<int>{};
+      while (true) {
+        out.clear();
+        auto res = q.PopBatch(std::back_inserter(out), 5);
+        if (!res) {
+          ASSERT_EQ(res.error(), errc::end);
+          return;
+        }
+        for (auto v : out) {
+          seen[v] += 1;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (auto const& s : seen) {
+    ASSERT_EQ(s.load(), 1);
+  }
+}
+
+TEST(queue, packets) {
+  auto q = MpmcQueue<Packet>::make(4).value();
+  q.Push(Packet::make(100).value()).value();
+  auto pkt = q.Pop().value();
+  ASSERT_EQ(pkt.get()->size, 100);
+  // anything left is freed with the queue
+  q.Push(Packet::make(100).value()).value();
+}
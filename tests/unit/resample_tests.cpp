@@ -0,0 +1,119 @@
+
+#include <luma_av/resample.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace luma_av;
+
+namespace {
+
+/**
+ s16 stereo ramp, left counts up and right counts down from where the last frame stopped
+*/
+Frame MakeStereoS16(int nb_samples, int rate, int first = 0) {
+  auto par = AudioParams{};
+  par.channel_layout(AV_CH_LAYOUT_STEREO).nb_samples(nb_samples).format(AV_SAMPLE_FMT_S16).sample_rate(rate);
+  auto f = Frame::make(par).value();
+  auto a = AudioFrame::make(f).value();
+  auto left = a.Channel<int16_t>(0).value();
+  auto right = a.Channel<int16_t>(1).value();
+  for (auto i = 0; i < nb_samples; ++i) {
+    left[i] = static_cast<int16_t>(first + i);
+    right[i] = static_cast<int16_t>(-(first + i));
+  }
+  return f;
+}
+
+} // namespace
+
+TEST(resample, format_only) {
+  auto swr = SwrSession::make(ResampleOpts{}.format(AV_SAMPLE_FMT_FLTP)).value();
+  auto src = MakeStereoS16(256, 48000);
+  auto out = swr.Resample(src).value();
+  ASSERT_EQ(out->audio_params().format(), AV_SAMPLE_FMT_FLTP);
+  ASSERT_EQ(out->audio_params().sample_rate(), 48000);
+  ASSERT_EQ(out->audio_params().channel_layout(), AV_CH_LAYOUT_STEREO);
+  auto a = AudioFrame::make(*out).value();
+  ASSERT_EQ(a.nb_samples(), 256);
+  auto right = a.Channel<float>(1).value().span();
+  ASSERT_FLOAT_EQ(right[100], -100.f / 32768.f);
+}
+
+TEST(resample, rate_change_and_flush) {
+  auto swr = SwrSession::make(ResampleOpts{}.sample_rate(16000).format(AV_SAMPLE_FMT_FLT)).value();
+  auto total = 0;
+  for (auto i = 0; i < 10; ++i) {
+    auto src = MakeStereoS16(480, 48000, 480 * i);
+    if (auto res = swr.Resample(src)) {
+      ASSERT_EQ(res.value()->audio_params().sample_rate(), 16000);
+      total += res.value()->get()->nb_samples;
+    } else {
+      ASSERT_EQ(res.error(), errc::again);
+    }
+  }
+  ASSERT_LT(total, 1600);
+  while (auto res = swr.Flush()) {
+    total += res.value()->get()->nb_samples;
+  }
+  ASSERT_NEAR(total, 1600, 2);
+  ASSERT_EQ(swr.Flush().error(), errc::end);
+}
+
+TEST(resample, shorter_output_keeps_capacity) {
+  auto swr = SwrSession::make(ResampleOpts{}.channel_layout(AV_CH_LAYOUT_MONO)).value();
+  auto* first = swr.Resample(MakeStereoS16(1000, 48000)).value()->get()->extended_data[0];
+  // fewer samples fit in the buffer sized for the bigger frame
+  auto next = swr.Resample(MakeStereoS16(200, 48000)).value();
+  ASSERT_EQ(next->get()->extended_data[0], first);
+  ASSERT_EQ(next->get()->nb_samples, 200);
+  ASSERT_EQ(next->audio_params().channels(), 1);
+}
+
+TEST(resample, props_dont_pile_up) {
+  auto swr = SwrSession::make(ResampleOpts{}.format(AV_SAMPLE_FMT_FLT)).value();
+  for (auto i = 0; i < 4; ++i) {
+    auto src = MakeStereoS16(256, 48000, 256 * i);
+    ASSERT_TRUE(av_frame_new_side_data(src.get(), AV_FRAME_DATA_REPLAYGAIN, 8));
+    ASSERT_EQ(av_dict_set_int(&src.get()->metadata, "index", i, 0), 0);
+    auto out = swr.Resample(src).value();
+    // the kept output buffer only carries the props of the latest input
+    ASSERT_EQ(out->get()->nb_side_data, 1);
+    ASSERT_EQ(av_dict_count(out->get()->metadata), 1);
+    ASSERT_EQ(out->get()->pts, src.get()->pts);
+  }
+}
+
+TEST(resample, input_params_change) {
+  auto swr = SwrSession::make(ResampleOpts{}.format(AV_SAMPLE_FMT_S16P)).value();
+  swr.Resample(MakeStereoS16(128, 48000)).value();
+  auto par = AudioParams{};
+  par.channel_layout(AV_CH_LAYOUT_MONO).nb_samples(128).format(AV_SAMPLE_FMT_FLT).sample_rate(22050);
+  auto mono = Frame::make(par).value();
+  auto out = swr.Resample(mono).value();
+  // unset opts follow the input
+  ASSERT_EQ(out->audio_params().channel_layout(), AV_CH_LAYOUT_MONO);
+  ASSERT_EQ(out->audio_params().sample_rate(), 22050);
+  ASSERT_EQ(out->audio_params().format(), AV_SAMPLE_FMT_S16P);
+}
+
+#ifdef LUMA_AV_ENABLE_RANGES
+TEST(resample, view_drains) {
+  auto frames = std::vector<Frame>{};
+  for (auto i = 0; i < 10; ++i) {
+    frames.push_back(MakeStereoS16(480, 48000, 480 * i));
+  }
+  auto count = [](auto&& range) {
+    auto total = 0;
+    for (auto&& res : range) {
+      total += res.value()->get()->nb_samples;
+    }
+    return total;
+  };
+  auto swr = SwrSession::make(ResampleOpts{}.sample_rate(16000)).value();
+  ASSERT_LT(count(frames | views::resample(swr)), 1600);
+  auto drained = SwrSession::make(ResampleOpts{}.sample_rate(16000)).value();
+  ASSERT_NEAR(count(frames | views::resample_drain(drained)), 1600, 2);
+}
+#endif // LUMA_AV_ENABLE_RANGES
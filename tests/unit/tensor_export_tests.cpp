@@ -0,0 +1,155 @@
+
+#include <luma_av/tensor_export.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace luma_av;
+
+namespace {
+
+Frame MakeRgb(int width, int height) {
+  auto f = Frame::make(VideoParams{.width_ = width, .height_ = height, .format_ = AV_PIX_FMT_RGB24}).value();
+  auto plane = f.Plane<uint8_t>(0).value();
+  for (auto y = 0; y < height; ++y) {
+    for (auto x = 0; x < width; ++x) {
+      plane(3 * x, y) = static_cast<uint8_t>(x);
+      plane(3 * x + 1, y) = static_cast<uint8_t>(y);
+      plane(3 * x + 2, y) = static_cast<uint8_t>(x + y);
+    }
+  }
+  return f;
+}
+
+float At(std::vector<float> const& t, std::size_t i) {
+  return t[i];
+}
+
+float HalfToFloat(uint16_t h) {
+  const auto sign = (h & 0x8000u) ? -1.f : 1.f;
+  const auto exp = (h >> 10) & 0x1F;
+  const auto mant = h & 0x3FF;
+  if (exp == 0) {
+    return sign * std::ldexp(static_cast<float>(mant), -24);
+  }
+  if (exp == 31) {
+    return mant ? NAN : sign * INFINITY;
+  }
+  return sign * std::ldexp(static_cast<float>(mant | 0x400), exp - 25);
+}
+
+} // namespace
+
+TEST(tensor_export, float_to_half) {
+  ASSERT_EQ(detail::FloatToHalf(0.f), 0x0000);
+  ASSERT_EQ(detail::FloatToHalf(-0.f), 0x8000);
+  ASSERT_EQ(detail::FloatToHalf(1.f), 0x3C00);
+  ASSERT_EQ(detail::FloatToHalf(-2.f), 0xC000);
+  ASSERT_EQ(detail::FloatToHalf(65504.f), 0x7BFF);
+  ASSERT_EQ(detail::FloatToHalf(1e6f), 0x7C00);
+  // smallest subnormal
+  ASSERT_EQ(detail::FloatToHalf(std::ldexp(1.f, -24)), 0x0001);
+  for (auto v : {0.1f, 0.485f, -1.7f, 3.14159f, 1000.5f}) {
+    ASSERT_NEAR(HalfToFloat(detail::FloatToHalf(v)), v, std::abs(v) / 1024.f);
+  }
+}
+
+TEST(tensor_export, rgb_identity_nchw_and_nhwc) {
+  auto src = MakeRgb(8, 4);
+  auto nchw = TensorExport::make(TensorExportOpts{}.width(8).height(4)).value();
+  auto nhwc = TensorExport::make(TensorExportOpts{}.width(8).height(4).layout(TensorLayout::nhwc)).value();
+  ASSERT_EQ(nchw.frame_bytes(), 3 * 8 * 4 * sizeof(float));
+  auto a = std::vector<float>(nchw.element_count());
+  auto b = std::vector<float>(nhwc.element_count());
+  nchw.Export(src, {reinterpret_cast<uint8_t*>(a.data()), nchw.frame_bytes()}).value();
+  nhwc.Export(src, {reinterpret_cast<uint8_t*>(b.data()), nhwc.frame_bytes()}).value();
+  for (std::size_t y = 0; y < 4; ++y) {
+    for (std::size_t x = 0; x < 8; ++x) {
+      const auto px = y * 8 + x;
+      ASSERT_FLOAT_EQ(At(a, px), x / 255.f);
+      ASSERT_FLOAT_EQ(At(a, 32 + px), y / 255.f);
+      ASSERT_FLOAT_EQ(At(a, 64 + px), (x + y) / 255.f);
+      for (std::size_t c = 0; c < 3; ++c) {
+        ASSERT_FLOAT_EQ(At(b, px * 3 + c), At(a, c * 32 + px));
+      }
+    }
+  }
+}
+
+TEST(tensor_export, crop_resize_normalize_bgr) {
+  auto src = MakeRgb(16, 16);
+  auto opts = TensorExportOpts{}.width(2).height(2).crop(ImageRect{4, 4, 4, 4})
+              .channel_order(ChannelOrder::bgr)
+              .normalize({0.5f, 0.5f, 0.5f}, {0.25f, 0.25f, 0.25f});
+  auto exp = TensorExport::make(opts).value();
+  auto out = std::vector<float>(exp.element_count());
+  exp.Export(src, {reinterpret_cast<uint8_t*>(out.data()), exp.frame_bytes()}).value();
+  // output pixel 0 covers source 4..5, its center lands halfway between the centers of 4 and 5
+  const auto norm = [](float v) { return (v / 255.f - 0.5f) / 0.25f; };
+  // channel 0 is blue (x + y), channel 2 is red (x)
+  ASSERT_NEAR(out[0], norm(4.5f + 4.5f), 1e-4f);
+  ASSERT_NEAR(out[2 * 4 + 3], norm(6.5f), 1e-4f);
+  ASSERT_NEAR(out[1 * 4 + 2], norm(6.5f), 1e-4f);
+}
+
+TEST(tensor_export, bad_crop) {
+  auto src = MakeRgb(8, 8);
+  auto exp = TensorExport::make(TensorExportOpts{}.width(4).height(4).crop(ImageRect{6, 0, 4, 4})).value();
+  auto out = std::vector<float>(exp.element_count());
+  ASSERT_FALSE(exp.Export(src, {reinterpret_cast<uint8_t*>(out.data()), exp.frame_bytes()}));
+}
+
+TEST(tensor_export, yuv_matches_color_convert) {
+  auto src = Frame::make(VideoParams{.width_ = 32, .height_ = 16, .format_ = AV_PIX_FMT_YUV420P}).value();
+  for (auto plane = 0; plane < 3; ++plane) {
+    for (auto row : src.Plane<uint8_t>(plane).value().rows()) {
+      std::ranges::fill(row, static_cast<uint8_t>(60 + 50 * plane));
+    }
+  }
+  auto conv = ColorConvert::make(ColorConvertOpts{}.dst_format(AV_PIX_FMT_GBRPF32)).value();
+  auto reference = conv.Convert(src).value();
+  auto exp = TensorExport::make(TensorExportOpts{}.width(32).height(16)).value();
+  auto out = std::vector<float>(exp.element_count());
+  exp.Export(src, {reinterpret_cast<uint8_t*>(out.data()), exp.frame_bytes()}).value();
+  ASSERT_NEAR(out[0], reference->Plane<float>(2).value()(0, 0), 1e-5f);
+  ASSERT_NEAR(out[512], reference->Plane<float>(0).value()(0, 0), 1e-5f);
+  ASSERT_NEAR(out[1024], reference->Plane<float>(1).value()(0, 0), 1e-5f);
+}
+
+TEST(tensor_export, batch) {
+  auto exp = TensorExport::make(TensorExportOpts{}.width(4).height(4).dtype(TensorDType::f16)).value();
+  auto storage = std::vector<uint8_t>(exp.frame_bytes() * 2);
+  ASSERT_FALSE(TensorBatch::make(exp, storage, 3));
+  auto batch = TensorBatch::make(exp, storage, 2).value();
+  auto src = MakeRgb(4, 4);
+  batch.Add(src).value();
+  ASSERT_EQ(batch.data().size(), exp.frame_bytes());
+  batch.Add(src).value();
+  ASSERT_TRUE(batch.full());
+  ASSERT_FALSE(batch.Add(src));
+  ASSERT_TRUE(std::equal(storage.begin(), storage.begin() + exp.frame_bytes(),
+                         storage.begin() + exp.frame_bytes()));
+  uint16_t last = 0;
+  std::memcpy(&last, storage.data() + exp.frame_bytes() - 2, 2);
+  ASSERT_NEAR(HalfToFloat(last), 6.f / 255.f, 1e-3f);
+}
+
+#ifdef LUMA_AV_ENABLE_RANGES
+TEST(tensor_export, view_batches_and_flushes) {
+  auto exp = TensorExport::make(TensorExportOpts{}.width(4).height(4)).value();
+  auto storage = std::vector<uint8_t>(exp.frame_bytes() * 2);
+  auto batch = TensorBatch::make(exp, storage, 2).value();
+  auto frames = std::vector<Frame>{};
+  for (auto i = 0; i < 5; ++i) {
+    frames.push_back(MakeRgb(4, 4));
+  }
+  auto sizes = std::vector<int>{};
+  for (auto&& res : frames | views::tensor_export(batch)) {
+    sizes.push_back(res.value()->size());
+  }
+  ASSERT_EQ(sizes, (std::vector<int>{2, 2, 1}));
+}
+#endif // LUMA_AV_ENABLE_RANGES
@@ -0,0 +1,39 @@
+
+#include <luma_av/thread_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+using namespace luma_av;
+
+TEST(thread_pool, parallel_for_runs_every_task) {
+  auto pool = ThreadPool::make(4).value();
+  ASSERT_EQ(pool.size(), 4);
+  auto hits = std::vector<std::atomic<int>>(1000);
+  pool.ParallelFor(1000, [&](int i) noexcept { hits[i] += 1; });
+  for (auto const& h : hits) {
+    ASSERT_EQ(h.load(), 1);
+  }
+}
+
+TEST(thread_pool, no_workers) {
+  auto pool = ThreadPool::make(0).value();
+  auto sum = 0;
+  pool.ParallelFor(10, [&](int i) noexcept { sum += i; });
+  ASSERT_EQ(sum, 45);
+}
+
+/**
+ every worker is stuck in an outer task that starts an inner ParallelFor,
+ the callers have to be able to finish the inner work themselves
+*/
+TEST(thread_pool, nested) {
+  auto pool = ThreadPool::make(2).value();
+  auto count = std::atomic<int>{};
+  pool.ParallelFor(8, [&](int) noexcept {
+    pool.ParallelFor(8, [&](int) noexcept { count += 1; });
+  });
+  ASSERT_EQ(count.load(), 64);
+}